@@ -0,0 +1,557 @@
+#include "tree_generator.hpp"
+
+#include "config.hpp"
+#include "delete_engine.hpp"
+#include "latency_histogram.hpp"
+#include "native_delete.hpp"
+#include "paths.hpp"
+#include "uring_delete.hpp"
+#include "work_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #define NOMINMAX
+  #include <windows.h>
+  #include <psapi.h>
+#else
+  #include <sys/resource.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace exterminate::bench {
+
+namespace {
+
+enum class Strategy {
+    Filesystem,
+    Parallel,
+    Uring,
+    Pipeline,
+};
+
+struct BenchOptions {
+    fs::path directory;
+    double scale = 1.0;
+    int repeat = 3;
+    bool repeat_set = false;
+    bool startup = false;
+    fs::path executable;
+    std::string baseline_path;
+    std::string save_baseline_path;
+    double tolerance = 25.0;
+    double floor_us = 20.0;
+    std::uint64_t seed = 1;
+    int threads = 0;
+    std::string config_path;
+    std::vector<TreeShape> shapes;
+    std::vector<Strategy> strategies;
+};
+
+struct RunResult {
+    bool complete = false;
+    double seconds = 0.0;
+    std::uint64_t latency_samples = 0;
+    std::chrono::nanoseconds p50{0};
+    std::chrono::nanoseconds p99{0};
+    std::uint64_t peak_rss = 0;
+};
+
+const std::vector<Strategy>& all_strategies() {
+    static const std::vector<Strategy> strategies = {
+        Strategy::Filesystem,
+        Strategy::Parallel,
+        Strategy::Uring,
+        Strategy::Pipeline,
+    };
+    return strategies;
+}
+
+std::string strategy_name(Strategy strategy) {
+    switch (strategy) {
+        case Strategy::Filesystem:
+            return "filesystem";
+        case Strategy::Parallel:
+            return "parallel";
+        case Strategy::Uring:
+            return "uring";
+        case Strategy::Pipeline:
+            return "pipeline";
+    }
+    return "unknown";
+}
+
+bool parse_strategy(const std::string& name, Strategy& out_strategy) {
+    for (const Strategy strategy : all_strategies()) {
+        if (strategy_name(strategy) == name) {
+            out_strategy = strategy;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<std::string> split_list(const std::string& value) {
+    std::vector<std::string> items;
+    std::stringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+void print_usage() {
+    std::cout << "Usage: exterminate_bench [options]\n"
+              << "  --dir <path>            Scratch directory for generated trees (default: system temp)\n"
+              << "  --scale <factor>        Multiplies every tree's size (default: 1)\n"
+              << "  --repeat <n>            Runs per shape and strategy; the median is reported (default: 3)\n"
+              << "  --seed <n>              Seed for the tree generator (default: 1)\n"
+              << "  --threads <n>           Worker threads, 0 = hardware concurrency (default: 0)\n"
+              << "  --config <path>         Config used by the pipeline strategy (default: built-in defaults)\n"
+              << "  --shapes <a,b,...>      wide-flat, deep-narrow, many-tiny-files, few-huge-files, mixed\n"
+              << "  --strategies <a,b,...>  filesystem, parallel, uring, pipeline\n"
+              << "\nStartup mode (time from main to the first unlink of a single file):\n"
+              << "  --startup               Run exterminate --profile-startup repeatedly (default --repeat: 25)\n"
+              << "  --exe <path>            exterminate binary (default: next to this benchmark)\n"
+              << "  --save-baseline <file>  Write the median of every phase to a baseline file\n"
+              << "  --baseline <file>       Fail when a phase median grew past the baseline\n"
+              << "  --tolerance <percent>   Allowed growth per phase (default: 25)\n"
+              << "  --floor <us>            Growth below this many microseconds is ignored (default: 20)\n";
+}
+
+bool parse_options(int argc, char* argv[], BenchOptions& options, std::string& error) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            print_usage();
+            std::exit(0);
+        }
+        if (arg == "--startup") {
+            options.startup = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            error = "missing value for " + arg;
+            return false;
+        }
+
+        const std::string value = argv[++i];
+        if (arg == "--dir") {
+            options.directory = value;
+        } else if (arg == "--scale") {
+            options.scale = std::atof(value.c_str());
+            if (options.scale <= 0.0) {
+                error = "--scale must be positive";
+                return false;
+            }
+        } else if (arg == "--repeat") {
+            options.repeat = std::max(1, std::atoi(value.c_str()));
+            options.repeat_set = true;
+        } else if (arg == "--seed") {
+            options.seed = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "--threads") {
+            options.threads = std::max(0, std::atoi(value.c_str()));
+        } else if (arg == "--config") {
+            options.config_path = value;
+        } else if (arg == "--exe") {
+            options.executable = value;
+        } else if (arg == "--baseline") {
+            options.baseline_path = value;
+        } else if (arg == "--save-baseline") {
+            options.save_baseline_path = value;
+        } else if (arg == "--tolerance") {
+            options.tolerance = std::max(0.0, std::atof(value.c_str()));
+        } else if (arg == "--floor") {
+            options.floor_us = std::max(0.0, std::atof(value.c_str()));
+        } else if (arg == "--shapes") {
+            options.shapes.clear();
+            for (const auto& name : split_list(value)) {
+                TreeShape shape;
+                if (!parse_tree_shape(name, shape)) {
+                    error = "unknown shape: " + name;
+                    return false;
+                }
+                options.shapes.push_back(shape);
+            }
+        } else if (arg == "--strategies") {
+            options.strategies.clear();
+            for (const auto& name : split_list(value)) {
+                Strategy strategy;
+                if (!parse_strategy(name, strategy)) {
+                    error = "unknown strategy: " + name;
+                    return false;
+                }
+                options.strategies.push_back(strategy);
+            }
+        } else {
+            error = "unknown option: " + arg;
+            return false;
+        }
+    }
+
+    if (options.directory.empty()) options.directory = fs::temp_directory_path() / "exterminate-bench";
+    if (options.shapes.empty()) options.shapes = all_tree_shapes();
+    if (options.strategies.empty()) options.strategies = all_strategies();
+    if (options.startup && !options.repeat_set) options.repeat = 25;
+    if (options.startup && options.executable.empty()) {
+#ifdef _WIN32
+        options.executable = get_executable_path().parent_path() / "exterminate.exe";
+#else
+        options.executable = get_executable_path().parent_path() / "exterminate";
+#endif
+    }
+    return true;
+}
+
+// Linux lets the high-water mark be reset between runs; elsewhere the peak
+// only ever grows, so later runs report at least the earlier ones' peak.
+void reset_peak_rss() {
+#ifdef __linux__
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    if (clear_refs) clear_refs << "5";
+#endif
+}
+
+std::uint64_t peak_rss_bytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return counters.PeakWorkingSetSize;
+#else
+  #ifdef __linux__
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmHWM:", 0) == 0) {
+            return std::strtoull(line.c_str() + 6, nullptr, 10) * 1024;
+        }
+    }
+  #endif
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+  #ifdef __APPLE__
+    return static_cast<std::uint64_t>(usage.ru_maxrss);
+  #else
+    return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;
+  #endif
+#endif
+}
+
+// Latency is only available for the engines that expose per-entry hooks; the
+// filesystem and pipeline strategies are timed as a whole.
+RunResult run_strategy(Strategy strategy, const fs::path& root, WorkPool& pool, const AppConfig& config) {
+    RunResult result;
+    LatencyHistogram latency;
+    TreeDeleteOptions options;
+    options.latency = &latency;
+
+    reset_peak_rss();
+    const auto started = std::chrono::steady_clock::now();
+    switch (strategy) {
+        case Strategy::Filesystem: {
+            std::error_code ec;
+            fs::remove_all(root, ec);
+            break;
+        }
+        case Strategy::Parallel:
+            delete_tree_parallel(root, pool, options);
+            break;
+        case Strategy::Uring: {
+            NativeDeleteStats stats;
+            delete_tree_uring(root, stats, options);
+            break;
+        }
+        case Strategy::Pipeline:
+            delete_target(root, config, pool);
+            break;
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    result.peak_rss = peak_rss_bytes();
+
+    std::error_code ec;
+    result.complete = !fs::exists(fs::symlink_status(root, ec));
+    result.latency_samples = latency.count();
+    result.p50 = latency.percentile(0.50);
+    result.p99 = latency.percentile(0.99);
+    return result;
+}
+
+std::string format_rate(double value, const char* unit) {
+    static const char* const prefixes[] = {"", "K", "M", "G", "T"};
+    size_t prefix = 0;
+    while (value >= 1000.0 && prefix + 1 < sizeof(prefixes) / sizeof(prefixes[0])) {
+        value /= 1000.0;
+        ++prefix;
+    }
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.1f %s%s/s", value, prefixes[prefix], unit);
+    return buffer;
+}
+
+std::string format_latency(std::chrono::nanoseconds value, std::uint64_t samples) {
+    if (samples == 0) return "-";
+    char buffer[32];
+    const double micros = static_cast<double>(value.count()) / 1000.0;
+    std::snprintf(buffer, sizeof(buffer), "%.1f us", micros);
+    return buffer;
+}
+
+std::string format_mib(std::uint64_t bytes) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.1f MiB", static_cast<double>(bytes) / (1024.0 * 1024.0));
+    return buffer;
+}
+
+void print_header() {
+    std::printf("%-16s %-11s %9s %11s %9s %13s %13s %10s %10s %11s\n", "shape", "strategy", "files", "bytes",
+                "seconds", "files/s", "bytes/s", "p50", "p99", "peak RSS");
+}
+
+void print_row(TreeShape shape, Strategy strategy, const GeneratedTree& tree, const RunResult& run) {
+    const double seconds = std::max(run.seconds, 1e-9);
+    std::printf("%-16s %-11s %9llu %11s %9.3f %13s %13s %10s %10s %11s%s\n", tree_shape_name(shape).c_str(),
+                strategy_name(strategy).c_str(), static_cast<unsigned long long>(tree.files),
+                format_mib(tree.bytes).c_str(), run.seconds,
+                format_rate(static_cast<double>(tree.files) / seconds, "").c_str(),
+                format_rate(static_cast<double>(tree.bytes) / seconds, "B").c_str(),
+                format_latency(run.p50, run.latency_samples).c_str(),
+                format_latency(run.p99, run.latency_samples).c_str(), format_mib(run.peak_rss).c_str(),
+                run.complete ? "" : "  (incomplete)");
+    std::fflush(stdout);
+}
+
+std::string quote_argument(const std::string& value) {
+#ifdef _WIN32
+    return "\"" + value + "\"";
+#else
+    std::string quoted = "'";
+    for (const char c : value) {
+        if (c == '\'') {
+            quoted += "'\\''";
+        } else {
+            quoted.push_back(c);
+        }
+    }
+    return quoted + "'";
+#endif
+}
+
+using PhaseTimes = std::vector<std::pair<std::string, double>>;
+
+// Runs one profiled delete of `target` and returns the microseconds per
+// phase, in report order, from the "Startup profile:" block exterminate
+// prints on stderr.
+bool profile_startup_once(const BenchOptions& options, const fs::path& target, PhaseTimes& out) {
+    std::string command = quote_argument(options.executable.string()) + " --profile-startup --confirmed";
+    if (!options.config_path.empty()) command += " --config " + quote_argument(options.config_path);
+    command += " " + quote_argument(target.string()) + " 2>&1";
+#ifdef _WIN32
+    // cmd /c strips one pair of outer quotes.
+    command = "\"" + command + "\"";
+    FILE* pipe = _popen(command.c_str(), "r");
+#else
+    FILE* pipe = popen(command.c_str(), "r");
+#endif
+    if (!pipe) return false;
+
+    std::string output;
+    char buffer[4096];
+    size_t got = 0;
+    while ((got = std::fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, got);
+    }
+#ifdef _WIN32
+    const int status = _pclose(pipe);
+#else
+    const int status = pclose(pipe);
+#endif
+    if (status != 0) return false;
+
+    std::istringstream lines(output);
+    std::string line;
+    bool in_profile = false;
+    while (std::getline(lines, line)) {
+        if (line.rfind("Startup profile:", 0) == 0) {
+            in_profile = true;
+            continue;
+        }
+        if (!in_profile || line.rfind("  ", 0) != 0) continue;
+
+        std::istringstream fields(line);
+        std::string phase;
+        double micros = 0.0;
+        if (fields >> phase >> micros) out.emplace_back(phase, micros);
+    }
+    return !out.empty();
+}
+
+double percentile_of(std::vector<double> values, double fraction) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    const size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * static_cast<double>(values.size())));
+    return values[index];
+}
+
+bool read_baseline(const std::string& path, std::map<std::string, double>& out) {
+    std::ifstream in(path);
+    if (!in.is_open()) return false;
+    std::string phase;
+    double micros = 0.0;
+    while (in >> phase >> micros) {
+        out[phase] = micros;
+    }
+    return true;
+}
+
+int run_startup_bench(const BenchOptions& options) {
+    std::error_code ec;
+    fs::create_directories(options.directory, ec);
+    if (ec) {
+        std::cerr << "Could not create scratch directory " << options.directory.string() << ": " << ec.message()
+                  << "\n";
+        return 1;
+    }
+
+    std::map<std::string, double> baseline;
+    if (!options.baseline_path.empty() && !read_baseline(options.baseline_path, baseline)) {
+        std::cerr << "Could not read baseline " << options.baseline_path << "\n";
+        return 1;
+    }
+
+    // Phases are listed in the order the first run reported them.
+    std::vector<std::string> order;
+    std::map<std::string, std::vector<double>> samples;
+    const fs::path target = options.directory / "startup-target";
+    for (int run = 0; run < options.repeat; ++run) {
+        std::ofstream(target, std::ios::binary | std::ios::trunc) << "x";
+        PhaseTimes phases;
+        if (!profile_startup_once(options, target, phases)) {
+            std::cerr << "Profiled run failed: " << options.executable.string() << "\n";
+            fs::remove(target, ec);
+            return 1;
+        }
+        for (const auto& phase : phases) {
+            if (samples.find(phase.first) == samples.end()) order.push_back(phase.first);
+            samples[phase.first].push_back(phase.second);
+        }
+    }
+    fs::remove(target, ec);
+
+    std::cout << "Startup: " << options.executable.string() << "  runs: " << options.repeat << "\n";
+    std::printf("%-18s %12s %12s %12s %9s\n", "phase", "median", "p90", "baseline", "change");
+
+    int exit_code = 0;
+    std::ofstream save;
+    if (!options.save_baseline_path.empty()) save.open(options.save_baseline_path, std::ios::trunc);
+    for (const auto& phase : order) {
+        const double median = percentile_of(samples[phase], 0.5);
+        const double p90 = percentile_of(samples[phase], 0.9);
+        if (save.is_open()) save << phase << " " << median << "\n";
+
+        const auto base = baseline.find(phase);
+        if (base == baseline.end()) {
+            std::printf("%-18s %9.1f us %9.1f us %12s %9s\n", phase.c_str(), median, p90, "-", "-");
+            continue;
+        }
+
+        const double growth = median - base->second;
+        const double percent = base->second > 0.0 ? growth / base->second * 100.0 : 0.0;
+        const bool regressed = growth > options.floor_us && percent > options.tolerance;
+        if (regressed) exit_code = 1;
+        std::printf("%-18s %9.1f us %9.1f us %9.1f us %+8.1f%%%s\n", phase.c_str(), median, p90, base->second, percent,
+                    regressed ? "  REGRESSED" : "");
+    }
+
+    if (!options.save_baseline_path.empty() && !save) {
+        std::cerr << "Could not write baseline " << options.save_baseline_path << "\n";
+        return 1;
+    }
+    return exit_code;
+}
+
+int run_bench(const BenchOptions& options) {
+    std::error_code ec;
+    fs::create_directories(options.directory, ec);
+    if (ec) {
+        std::cerr << "Could not create scratch directory " << options.directory.string() << ": " << ec.message()
+                  << "\n";
+        return 1;
+    }
+
+    AppConfig config;
+    if (!options.config_path.empty()) config = load_config(options.config_path, "");
+    config.worker_threads = options.threads;
+
+    WorkPool pool(resolve_worker_threads(options.threads));
+    std::cout << "Scratch: " << options.directory.string() << "  threads: " << pool.thread_count()
+              << "  scale: " << options.scale << "  seed: " << options.seed << "\n";
+    print_header();
+
+    int exit_code = 0;
+    for (const TreeShape shape : options.shapes) {
+        for (const Strategy strategy : options.strategies) {
+            if (strategy == Strategy::Uring && !uring_delete_available()) {
+                std::printf("%-16s %-11s skipped (io_uring unavailable)\n", tree_shape_name(shape).c_str(),
+                            strategy_name(strategy).c_str());
+                continue;
+            }
+
+            const fs::path root = options.directory / tree_shape_name(shape);
+            fs::remove_all(root, ec);
+
+            GeneratedTree tree;
+            std::vector<RunResult> runs;
+            for (int attempt = 0; attempt < options.repeat; ++attempt) {
+                std::string error;
+                if (!generate_tree(root, shape, options.scale, options.seed, tree, error)) {
+                    std::cerr << "Tree generation failed: " << error << "\n";
+                    fs::remove_all(root, ec);
+                    return 1;
+                }
+
+                runs.push_back(run_strategy(strategy, root, pool, config));
+                if (!runs.back().complete) {
+                    exit_code = 1;
+                    fs::remove_all(root, ec);
+                }
+            }
+
+            std::sort(runs.begin(), runs.end(),
+                      [](const RunResult& a, const RunResult& b) { return a.seconds < b.seconds; });
+            print_row(shape, strategy, tree, runs[runs.size() / 2]);
+        }
+    }
+    return exit_code;
+}
+
+} // namespace
+
+} // namespace exterminate::bench
+
+int main(int argc, char* argv[]) {
+    exterminate::bench::BenchOptions options;
+    std::string error;
+    if (!exterminate::bench::parse_options(argc, argv, options, error)) {
+        std::cerr << error << "\n";
+        exterminate::bench::print_usage();
+        return 2;
+    }
+    if (options.startup) return exterminate::bench::run_startup_bench(options);
+    return exterminate::bench::run_bench(options);
+}
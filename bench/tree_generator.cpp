@@ -0,0 +1,238 @@
+#include "tree_generator.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <system_error>
+
+namespace exterminate::bench {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr size_t kWriteChunkBytes = 1024 * 1024;
+
+class TreeWriter {
+public:
+    TreeWriter(GeneratedTree& tree, std::string& error) : tree_(tree), error_(error) {
+        std::mt19937_64 fill(0x5eedf11eULL);
+        chunk_.resize(kWriteChunkBytes);
+        for (auto& byte : chunk_) byte = static_cast<char>(fill());
+    }
+
+    bool directory(const fs::path& path) {
+        std::error_code ec;
+        if (!fs::create_directory(path, ec)) {
+            error_ = "could not create directory " + path.string() + ": " + ec.message();
+            return false;
+        }
+        ++tree_.directories;
+        return true;
+    }
+
+    bool file(const fs::path& path, std::uint64_t size) {
+        std::FILE* out = std::fopen(path.string().c_str(), "wb");
+        if (!out) {
+            error_ = "could not create file " + path.string();
+            return false;
+        }
+
+        std::uint64_t left = size;
+        bool ok = true;
+        while (left > 0 && ok) {
+            const size_t count = static_cast<size_t>(std::min<std::uint64_t>(left, chunk_.size()));
+            ok = std::fwrite(chunk_.data(), 1, count, out) == count;
+            left -= count;
+        }
+        ok = std::fclose(out) == 0 && ok;
+        if (!ok) {
+            error_ = "could not write file " + path.string();
+            return false;
+        }
+
+        ++tree_.files;
+        tree_.bytes += size;
+        return true;
+    }
+
+    void fail(std::string message) { error_ = std::move(message); }
+
+private:
+    GeneratedTree& tree_;
+    std::string& error_;
+    std::vector<char> chunk_;
+};
+
+std::uint64_t scaled(double base, double scale) {
+    return std::max<std::uint64_t>(1, static_cast<std::uint64_t>(base * scale));
+}
+
+std::string file_name(std::uint64_t index) {
+    return "f" + std::to_string(index) + ".dat";
+}
+
+bool generate_wide_flat(TreeWriter& writer, const fs::path& root, double scale) {
+    const std::uint64_t files = scaled(50000, scale);
+    for (std::uint64_t i = 0; i < files; ++i) {
+        if (!writer.file(root / file_name(i), 64)) return false;
+    }
+    return true;
+}
+
+// Built bottom-up in short chunks: each new chunk is created near the root and
+// the chain so far is renamed underneath it, so no path ever passes the
+// platform limit however deep the result is.
+bool generate_deep_narrow(TreeWriter& writer, const fs::path& root, double scale) {
+    constexpr std::uint64_t kChunkLevels = 256;
+    const fs::path chain = root / "d";
+    const fs::path chunk = root / "chunk";
+
+    std::uint64_t levels_left = scaled(1000, scale);
+    bool have_chain = false;
+    while (levels_left > 0) {
+        const std::uint64_t levels = std::min(levels_left, kChunkLevels);
+        fs::path bottom = chunk;
+        if (!writer.directory(bottom)) return false;
+        for (std::uint64_t level = 0; level < levels; ++level) {
+            if (level > 0) {
+                bottom /= "d";
+                if (!writer.directory(bottom)) return false;
+            }
+            for (std::uint64_t i = 0; i < 4; ++i) {
+                if (!writer.file(bottom / file_name(i), 1024)) return false;
+            }
+        }
+
+        std::error_code ec;
+        if (have_chain) fs::rename(chain, bottom / "d", ec);
+        if (!ec) fs::rename(chunk, chain, ec);
+        if (ec) {
+            writer.fail("could not extend deep chain: " + ec.message());
+            return false;
+        }
+
+        have_chain = true;
+        levels_left -= levels;
+    }
+    return true;
+}
+
+bool generate_many_tiny_files(TreeWriter& writer, const fs::path& root, double scale, std::mt19937_64& random) {
+    const std::uint64_t directories = scaled(200, scale);
+    std::uniform_int_distribution<std::uint64_t> size(0, 1024);
+    for (std::uint64_t d = 0; d < directories; ++d) {
+        const fs::path directory = root / ("d" + std::to_string(d));
+        if (!writer.directory(directory)) return false;
+        for (std::uint64_t i = 0; i < 500; ++i) {
+            if (!writer.file(directory / file_name(i), size(random))) return false;
+        }
+    }
+    return true;
+}
+
+bool generate_few_huge_files(TreeWriter& writer, const fs::path& root, double scale) {
+    const std::uint64_t files = 8;
+    const std::uint64_t size = scaled(16.0 * 1024 * 1024, scale);
+    for (std::uint64_t i = 0; i < files; ++i) {
+        if (!writer.file(root / file_name(i), size)) return false;
+    }
+    return true;
+}
+
+// Random recursive tree: each new directory hangs off a uniformly chosen
+// existing one, and file sizes are mostly small with a long tail.
+bool generate_mixed(TreeWriter& writer, const fs::path& root, double scale, std::mt19937_64& random) {
+    const std::uint64_t directory_count = scaled(2000, scale);
+    const std::uint64_t file_count = scaled(40000, scale);
+
+    std::vector<fs::path> directories{root};
+    directories.reserve(directory_count + 1);
+    for (std::uint64_t d = 0; d < directory_count; ++d) {
+        std::uniform_int_distribution<size_t> pick(0, directories.size() - 1);
+        fs::path directory = directories[pick(random)] / ("d" + std::to_string(d));
+        if (!writer.directory(directory)) return false;
+        directories.push_back(std::move(directory));
+    }
+
+    std::uniform_int_distribution<size_t> pick_directory(0, directories.size() - 1);
+    std::uniform_real_distribution<double> bucket(0.0, 1.0);
+    for (std::uint64_t i = 0; i < file_count; ++i) {
+        const double roll = bucket(random);
+        std::uint64_t low = 0;
+        std::uint64_t high = 4 * 1024;
+        if (roll >= 0.999) {
+            low = 1024 * 1024;
+            high = 4 * 1024 * 1024;
+        } else if (roll >= 0.9) {
+            low = 4 * 1024;
+            high = 64 * 1024;
+        }
+        std::uniform_int_distribution<std::uint64_t> size(low, high);
+        if (!writer.file(directories[pick_directory(random)] / file_name(i), size(random))) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+const std::vector<TreeShape>& all_tree_shapes() {
+    static const std::vector<TreeShape> shapes = {
+        TreeShape::WideFlat,
+        TreeShape::DeepNarrow,
+        TreeShape::ManyTinyFiles,
+        TreeShape::FewHugeFiles,
+        TreeShape::Mixed,
+    };
+    return shapes;
+}
+
+std::string tree_shape_name(TreeShape shape) {
+    switch (shape) {
+        case TreeShape::WideFlat:
+            return "wide-flat";
+        case TreeShape::DeepNarrow:
+            return "deep-narrow";
+        case TreeShape::ManyTinyFiles:
+            return "many-tiny-files";
+        case TreeShape::FewHugeFiles:
+            return "few-huge-files";
+        case TreeShape::Mixed:
+            return "mixed";
+    }
+    return "unknown";
+}
+
+bool parse_tree_shape(const std::string& name, TreeShape& out_shape) {
+    for (const TreeShape shape : all_tree_shapes()) {
+        if (tree_shape_name(shape) == name) {
+            out_shape = shape;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool generate_tree(const fs::path& root, TreeShape shape, double scale, std::uint64_t seed,
+                   GeneratedTree& out_tree, std::string& out_error) {
+    out_tree = GeneratedTree{};
+    TreeWriter writer(out_tree, out_error);
+    if (!writer.directory(root)) return false;
+
+    std::mt19937_64 random(seed ^ (static_cast<std::uint64_t>(shape) + 1) * 0x9e3779b97f4a7c15ULL);
+    switch (shape) {
+        case TreeShape::WideFlat:
+            return generate_wide_flat(writer, root, scale);
+        case TreeShape::DeepNarrow:
+            return generate_deep_narrow(writer, root, scale);
+        case TreeShape::ManyTinyFiles:
+            return generate_many_tiny_files(writer, root, scale, random);
+        case TreeShape::FewHugeFiles:
+            return generate_few_huge_files(writer, root, scale);
+        case TreeShape::Mixed:
+            return generate_mixed(writer, root, scale, random);
+    }
+    return false;
+}
+
+} // namespace exterminate::bench
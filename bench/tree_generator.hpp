@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace exterminate::bench {
+
+enum class TreeShape {
+    WideFlat,
+    DeepNarrow,
+    ManyTinyFiles,
+    FewHugeFiles,
+    Mixed,
+};
+
+struct GeneratedTree {
+    std::uint64_t files = 0;
+    std::uint64_t directories = 0;
+    std::uint64_t bytes = 0;
+};
+
+const std::vector<TreeShape>& all_tree_shapes();
+std::string tree_shape_name(TreeShape shape);
+bool parse_tree_shape(const std::string& name, TreeShape& out_shape);
+
+// Builds the same tree for the same shape, scale and seed every time. `root`
+// must not exist yet. Returns false and fills `out_error` on the first
+// filesystem error.
+bool generate_tree(const std::filesystem::path& root, TreeShape shape, double scale, std::uint64_t seed,
+                   GeneratedTree& out_tree, std::string& out_error);
+
+} // namespace exterminate::bench
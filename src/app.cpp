@@ -4,13 +4,31 @@
 #include "config.hpp"
 #include "delete_engine.hpp"
 #include "install.hpp"
+#include "io_throttle.hpp"
+#include "lock_holders.hpp"
+#include "path_guard.hpp"
 #include "paths.hpp"
+#include "progress.hpp"
+#include "purge.hpp"
+#include "result_json.hpp"
+#include "service.hpp"
+#include "shred.hpp"
+#include "startup_profile.hpp"
+#include "target_list.hpp"
+#include "tombstone.hpp"
+#include "trace.hpp"
+#include "tree_scan.hpp"
 #include "windows_env.hpp"
+#include "work_pool.hpp"
 
 #include <algorithm>
 #include <cctype>
+#include <chrono>
+#include <cstdio>
 #include <filesystem>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -24,6 +42,9 @@ namespace exterminate {
 
 namespace {
 
+// Failures listed per target or run; the rest are only counted.
+constexpr size_t kMaxListedFailures = 10;
+
 std::string style(const std::string& text, const char* ansi_code, bool enabled) {
     if (!enabled) return text;
     return std::string("\x1b[") + ansi_code + "m" + text + "\x1b[0m";
@@ -39,15 +60,417 @@ std::string normalize_confirmation(std::string value) {
     return value;
 }
 
+bool path_present(const std::filesystem::path& path) {
+    std::error_code ec;
+    return std::filesystem::exists(std::filesystem::symlink_status(path, ec)) && !ec;
+}
+
+std::filesystem::path without_trailing_separator(const std::filesystem::path& path) {
+    if (path.has_filename() || !path.has_relative_path()) return path;
+    return path.parent_path();
+}
+
+bool is_within(const std::filesystem::path& path, const std::filesystem::path& ancestor) {
+    auto it = path.begin();
+    for (const auto& component : ancestor) {
+        if (it == path.end() || fold_name_case(component.native()) != fold_name_case(it->native())) return false;
+        ++it;
+    }
+    return true;
+}
+
+// An unquoted path with spaces arrives as several arguments. Only when none
+// of the pieces exists on its own, the space-joined path does, and the user
+// is about to confirm it at the prompt, is it taken as one target like
+// earlier versions did. A target inside another one is dropped: it goes
+// with its ancestor, and deleting both at once would have two passes race
+// over the same entries.
+std::vector<std::filesystem::path> resolve_targets(const std::vector<std::string>& inputs, bool allow_join) {
+    std::vector<std::filesystem::path> resolved;
+    for (const auto& input : inputs) {
+        resolved.push_back(without_trailing_separator(resolve_target_path(input)));
+    }
+
+    if (allow_join && inputs.size() > 1 && std::none_of(resolved.begin(), resolved.end(), path_present)) {
+        std::string joined;
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            if (i > 0) joined.push_back(' ');
+            joined += inputs[i];
+        }
+        const std::filesystem::path joined_path = resolve_target_path(joined);
+        if (path_present(joined_path)) return {joined_path};
+    }
+
+    std::vector<std::filesystem::path> outermost;
+    for (size_t i = 0; i < resolved.size(); ++i) {
+        bool covered = false;
+        for (size_t j = 0; j < resolved.size() && !covered; ++j) {
+            if (i == j || !is_within(resolved[i], resolved[j])) continue;
+            // Of two equal targets, the first one listed is kept.
+            covered = !is_within(resolved[j], resolved[i]) || j < i;
+        }
+        if (!covered) outermost.push_back(resolved[i]);
+    }
+    return outermost;
+}
+
+std::string format_bytes(std::uint64_t bytes) {
+    static const char* const units[] = {"B", "KiB", "MiB", "GiB", "TiB", "PiB"};
+    double value = static_cast<double>(bytes);
+    size_t unit = 0;
+    while (value >= 1024.0 && unit + 1 < sizeof(units) / sizeof(units[0])) {
+        value /= 1024.0;
+        ++unit;
+    }
+
+    char buffer[32];
+    if (unit == 0) {
+        std::snprintf(buffer, sizeof(buffer), "%llu B", static_cast<unsigned long long>(bytes));
+    } else {
+        std::snprintf(buffer, sizeof(buffer), "%.1f %s", value, units[unit]);
+    }
+    return buffer;
+}
+
+std::string format_seconds(double seconds) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.3f s", seconds);
+    return buffer;
+}
+
+std::string format_duration(double seconds) {
+    const auto total = static_cast<long long>(seconds + 0.5);
+    char buffer[32];
+    if (total >= 3600) {
+        std::snprintf(buffer, sizeof(buffer), "%lldh %02lldm", total / 3600, total % 3600 / 60);
+    } else if (total >= 60) {
+        std::snprintf(buffer, sizeof(buffer), "%lldm %02llds", total / 60, total % 60);
+    } else {
+        std::snprintf(buffer, sizeof(buffer), "%llds", total);
+    }
+    return buffer;
+}
+
+// The progress line is redrawn in place on stderr. Result lines are printed
+// under the same lock and clear it first, so the two never share a line.
+std::mutex console_mutex;
+bool progress_line_shown = false;
+
+void clear_progress_line_locked() {
+    if (!progress_line_shown) return;
+    std::cerr << "\r\x1b[K" << std::flush;
+    progress_line_shown = false;
+}
+
+void draw_progress_line(const ProgressSnapshot& snapshot, bool final) {
+    std::lock_guard<std::mutex> lock(console_mutex);
+    if (final) {
+        clear_progress_line_locked();
+        return;
+    }
+
+    std::string line = "Deleting: " + std::to_string(snapshot.removed) + " entries";
+    if (snapshot.bytes > 0) line += ", " + format_bytes(snapshot.bytes);
+    line += ", " + std::to_string(static_cast<unsigned long long>(snapshot.rate)) + "/s";
+    if (snapshot.pending_directories > 0) {
+        line += ", " + std::to_string(snapshot.pending_directories) + " directories pending";
+    }
+    if (snapshot.eta_seconds >= 0) line += ", ETA " + format_duration(snapshot.eta_seconds);
+    std::cerr << "\r\x1b[K" << line << std::flush;
+    progress_line_shown = true;
+}
+
+std::string describe_holders(const std::vector<LockHolder>& holders) {
+    std::string out;
+    for (size_t i = 0; i < holders.size(); ++i) {
+        if (i > 0) out += ", ";
+        out += (holders[i].name.empty() ? std::string("?") : holders[i].name) + " (pid " +
+               std::to_string(holders[i].pid) + ")";
+    }
+    return out;
+}
+
+// With --output json stdout carries only the result document, so text meant
+// for a person goes to stderr instead.
+std::ostream& text_out(const ResultJson* json) {
+    return json ? std::cerr : std::cout;
+}
+
+void print_result(const DeleteResult& result, bool use_color, ResultJson* json) {
+    std::lock_guard<std::mutex> lock(console_mutex);
+    if (json) {
+        json->add(result);
+        return;
+    }
+    clear_progress_line_locked();
+    if (!result.ended_holders.empty()) {
+        std::cerr << style("Ended " + describe_holders(result.ended_holders) + " holding entries of " +
+                               result.target.string(),
+                           "33;1", use_color)
+                  << "\n";
+    }
+    if (result.success) {
+        std::cout << style(result.message, "32;1", use_color) << "\n";
+        return;
+    }
+
+    std::cerr << style(result.message, "31;1", use_color) << "\n";
+    size_t left = 0;
+    for (const auto& failure_class : result.failure_classes) {
+        left += failure_class.count;
+    }
+    for (size_t i = 0; i < result.failures.size() && i < kMaxListedFailures; ++i) {
+        const FailedEntry& failure = result.failures[i];
+        std::string line = "  " + failure.path.string() + ": " + describe_failure_error(failure.error);
+        if (!failure.stage.empty()) line += " (" + failure.stage + ")";
+        if (!failure.holders.empty()) line += ", held open by " + describe_holders(failure.holders);
+        std::cerr << style(line, "31", use_color) << "\n";
+    }
+    if (left > kMaxListedFailures) {
+        std::string line = "  ... " + std::to_string(left - kMaxListedFailures) + " more left behind; by error:";
+        for (size_t i = 0; i < result.failure_classes.size(); ++i) {
+            const FailureClass& failure_class = result.failure_classes[i];
+            line += std::string(i == 0 ? " " : ", ") + std::to_string(failure_class.count) + " " +
+                    describe_failure_error(failure_class.error);
+        }
+        std::cerr << style(line, "31", use_color) << "\n";
+    }
+}
+
+int list_holders(const std::vector<std::filesystem::path>& paths, const AppConfig& config, bool use_color) {
+    WorkPool pool(resolve_worker_threads(config.worker_threads));
+    const std::vector<std::vector<LockHolder>> holders = find_lock_holders(paths, pool);
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (holders[i].empty()) {
+            std::cout << paths[i].string() << ": not held open\n";
+            continue;
+        }
+        std::cout << style(paths[i].string() + ": held open by", "33;1", use_color) << "\n";
+        for (const auto& holder : holders[i]) {
+            std::cout << "  " << holder.pid << "  " << holder.name << (holder.critical ? "  (critical)" : "") << "\n";
+        }
+    }
+    return 0;
+}
+
+int scan_targets(const std::vector<std::filesystem::path>& target_paths, const AppConfig& config, bool use_color) {
+    WorkPool pool(resolve_worker_threads(config.worker_threads));
+
+    int exit_code = 0;
+    for (const auto& target_path : target_paths) {
+        const auto started = std::chrono::steady_clock::now();
+        const ScanStats stats = scan_tree(target_path, pool);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        std::cout << style("Dry run (nothing deleted): " + target_path.string(), "36;1", use_color) << "\n";
+        std::cout << "  Files:       " << stats.files << "\n";
+        std::cout << "  Directories: " << stats.directories << "\n";
+        std::cout << "  Total size:  " << format_bytes(stats.bytes) << " (" << stats.bytes << " bytes)\n";
+        std::cout << "  Max depth:   " << stats.max_depth << "\n";
+        std::cout << "  Scan time:   " << format_seconds(seconds) << "\n";
+        if (stats.errors > 0) {
+            std::cout << style("  Unreadable:  " + std::to_string(stats.errors) + " entries", "33;1", use_color) << "\n";
+            exit_code = 1;
+        }
+
+        if (!stats.largest_directories.empty()) {
+            std::cout << "  Largest directories:\n";
+            for (const auto& directory : stats.largest_directories) {
+                std::cout << "    " << format_bytes(directory.bytes) << "  " << directory.entries << " entries  "
+                          << directory.path.string() << "\n";
+            }
+        }
+    }
+    return exit_code;
+}
+
+std::string describe_age(std::int64_t seconds) {
+    if (seconds % 86400 == 0) return std::to_string(seconds / 86400) + "d";
+    if (seconds % 3600 == 0) return std::to_string(seconds / 3600) + "h";
+    if (seconds % 60 == 0) return std::to_string(seconds / 60) + "m";
+    return std::to_string(seconds) + "s";
+}
+
+std::string describe_purge_rules(const PurgeRules& rules) {
+    std::string out = "files";
+    if (rules.by_age) out += " older than " + describe_age(rules.older_than_seconds);
+    if (rules.by_size) out += std::string(rules.by_age ? "," : "") + " larger than " + format_bytes(rules.larger_than_bytes);
+    if (!rules.name_patterns.empty()) {
+        out += std::string(rules.by_age || rules.by_size ? "," : "") + " matching ";
+        for (size_t i = 0; i < rules.name_patterns.size(); ++i) {
+            if (i > 0) out.push_back('|');
+            out += std::filesystem::path(rules.name_patterns[i]).string();
+        }
+    }
+    return out;
+}
+
+int purge_targets(const std::vector<std::filesystem::path>& target_paths, const PurgeRules& rules,
+                  const AppConfig& config, bool use_color) {
+    WorkPool pool(resolve_worker_threads(config.worker_threads));
+    PurgeOptions purge_options;
+    purge_options.guard = config.path_guard.get();
+    purge_options.throttle = config.throttle.get();
+
+    int exit_code = 0;
+    for (const auto& target_path : target_paths) {
+        std::error_code ec;
+        if (!std::filesystem::is_directory(std::filesystem::symlink_status(target_path, ec))) {
+            std::cerr << style("Not a directory: " + target_path.string(), "31;1", use_color) << "\n";
+            exit_code = 1;
+            continue;
+        }
+
+        DeleteFailureLog failures;
+        purge_options.failures = &failures;
+        const auto started = std::chrono::steady_clock::now();
+        const PurgeStats stats = purge_tree(target_path, rules, pool, purge_options);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        const std::string summary = "Purged: " + target_path.string() + " (" + std::to_string(stats.files_removed) +
+                                    " of " + std::to_string(stats.files_examined) + " files, " +
+                                    std::to_string(stats.directories_removed) + " emptied directories, " +
+                                    format_bytes(stats.bytes_removed) + ", " + format_seconds(seconds) + ")";
+        std::cout << style(summary, stats.failures == 0 ? "32;1" : "33;1", use_color) << "\n";
+        if (stats.failures == 0) continue;
+
+        exit_code = 1;
+        const std::vector<DeleteFailure> listed = failures.take();
+        for (size_t i = 0; i < listed.size() && i < kMaxListedFailures; ++i) {
+            std::cerr << style("  " + listed[i].path.string() + ": " + listed[i].error.message(), "31", use_color)
+                      << "\n";
+        }
+        if (stats.failures > kMaxListedFailures) {
+            std::cerr << style("  ... " + std::to_string(stats.failures - kMaxListedFailures) + " more failures",
+                               "31", use_color)
+                      << "\n";
+        }
+    }
+    return exit_code;
+}
+
+std::string describe_find_dir_names(const std::vector<NativeName>& names) {
+    std::string out;
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (i > 0) out += ", ";
+        out += std::filesystem::path(names[i]).string();
+    }
+    return out;
+}
+
+int find_dirs_targets(const std::vector<std::filesystem::path>& root_paths, const std::vector<NativeName>& names,
+                      const AppConfig& config, bool use_color, ResultJson* json) {
+    int exit_code = 0;
+    std::vector<std::filesystem::path> roots;
+    for (const auto& root_path : root_paths) {
+        std::error_code ec;
+        if (!std::filesystem::is_directory(std::filesystem::symlink_status(root_path, ec))) {
+            std::cerr << style("Not a directory: " + root_path.string(), "31;1", use_color) << "\n";
+            exit_code = 1;
+            continue;
+        }
+        roots.push_back(root_path);
+    }
+    if (roots.empty()) return exit_code;
+
+    DeleteFailureLog search_failures;
+    size_t deleted = 0;
+    size_t failed = 0;
+    const auto started = std::chrono::steady_clock::now();
+    const FoundDirsStats stats = delete_found_dirs(
+        roots, names, config,
+        [&](const std::filesystem::path&, const DeleteResult& result) {
+            if (result.success) {
+                ++deleted;
+            } else {
+                ++failed;
+            }
+            print_result(result, use_color, json);
+        },
+        &search_failures);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    const bool clean = failed == 0 && stats.search_failures == 0;
+    const std::string summary = "Found " + std::to_string(stats.matches) + " directories in " +
+                                std::to_string(stats.directories_searched) + " searched: " + std::to_string(deleted) +
+                                " deleted, " + std::to_string(failed) + " failed (" + format_seconds(seconds) + ")";
+    text_out(json) << style(summary, clean ? "32;1" : "33;1", use_color) << "\n";
+    if (clean) return exit_code;
+
+    const std::vector<DeleteFailure> listed = search_failures.take();
+    for (size_t i = 0; i < listed.size() && i < kMaxListedFailures; ++i) {
+        std::cerr << style("  not searched: " + listed[i].path.string() + ": " + listed[i].error.message(), "31",
+                           use_color)
+                  << "\n";
+    }
+    if (stats.search_failures > kMaxListedFailures) {
+        std::cerr << style("  ... " + std::to_string(stats.search_failures - kMaxListedFailures) +
+                               " more directories not searched",
+                           "31", use_color)
+                  << "\n";
+    }
+    return 1;
+}
+
+int delete_listed_targets(const std::string& list_path, const std::vector<std::filesystem::path>& target_paths,
+                          const AppConfig& config, TraceRecorder* trace, bool use_color, ResultJson* json) {
+    TargetListReader reader;
+    std::string open_error;
+    if (!reader.open(list_path, open_error)) {
+        std::cerr << style("error:", "31;1", use_color) << " " << open_error << "\n";
+        return 1;
+    }
+
+    size_t deleted = 0;
+    size_t already_gone = 0;
+    size_t failed = 0;
+    {
+        DeleteBatch batch(
+            config,
+            [&](size_t, const DeleteResult& result) {
+                if (!result.success) {
+                    ++failed;
+                    print_result(result, use_color, json);
+                } else {
+                    if (result.already_gone) {
+                        ++already_gone;
+                    } else {
+                        ++deleted;
+                    }
+                    if (json) print_result(result, use_color, json);
+                }
+            },
+            trace);
+
+        for (const auto& target_path : target_paths) {
+            batch.add_target(target_path);
+        }
+
+        std::string entry;
+        while (reader.next(entry)) {
+            batch.add_input(entry);
+        }
+        batch.finish();
+    }
+
+    if (reader.failed()) {
+        std::cerr << style("error:", "31;1", use_color) << " " << reader.error() << ": " << list_path << "\n";
+    }
+
+    const std::string summary = "Deleted: " + std::to_string(deleted) + ", already gone: " +
+                                std::to_string(already_gone) + ", failed: " + std::to_string(failed);
+    const bool ok = failed == 0 && !reader.failed();
+    text_out(json) << style(summary, ok ? "32;1" : "31;1", use_color) << "\n";
+    return ok ? 0 : 1;
+}
+
 } // namespace
 
 int run(int argc, char* argv[]) {
-#if !EXTERMINATE_WINDOWS
-    std::cerr << "exterminate currently supports Windows only.\n";
-    return 1;
-#else
+    StartupProfile& profile = StartupProfile::instance();
     const bool standalone = is_standalone_console();
     const bool use_color = has_console_window() && enable_ansi_colors();
+    profile.mark("console_setup");
 
     std::vector<std::string> raw_args;
     for (int i = 1; i < argc; ++i) {
@@ -62,9 +485,24 @@ int run(int argc, char* argv[]) {
         if (standalone) wait_for_key();
         return 1;
     }
+    if (options.profile_startup) profile.enable();
+    profile.mark("parse_cli");
 
     const std::string base_directory = get_base_directory();
-    const AppConfig config = load_config(options.config_path, base_directory);
+    profile.mark("base_directory");
+    std::vector<std::string> config_warnings;
+    AppConfig config = load_config(options.config_path, base_directory, &config_warnings);
+    profile.mark("load_config");
+    for (const auto& warning : config_warnings) {
+        std::cerr << style("warning:", "33;1", use_color) << " " << warning << "\n";
+    }
+    if (options.tombstone) config.tombstone_delete = true;
+    if (options.json_output) config.count_freed_bytes = true;
+    if (options.kill_holders) config.kill_lock_holders = true;
+    if (options.max_ops_per_sec > 0 || options.max_bytes_per_sec > 0) {
+        config.throttle = std::make_shared<IoThrottle>(options.max_ops_per_sec, options.max_bytes_per_sec);
+    }
+    if (options.shred_passes > 0) config.shredder = std::make_shared<Shredder>(options.shred_passes);
 
     if (options.command == Command::Help) {
         print_usage();
@@ -72,16 +510,19 @@ int run(int argc, char* argv[]) {
     }
 
     if (options.command == Command::None) {
+#if EXTERMINATE_WINDOWS
         if (standalone) {
             const int exit_code = install_self(config, base_directory, options.config_path);
             wait_for_key();
             return exit_code;
         }
+#endif
 
         print_usage();
         return 1;
     }
 
+#if EXTERMINATE_WINDOWS
     if (options.command == Command::Install) {
         return install_self(config, base_directory, options.config_path);
     }
@@ -89,14 +530,89 @@ int run(int argc, char* argv[]) {
     if (options.command == Command::Uninstall) {
         return uninstall_self(config);
     }
+#else
+    if (options.command == Command::Install || options.command == Command::Uninstall) {
+        std::cerr << style("error:", "31;1", use_color) << " install and uninstall are only supported on Windows.\n";
+        return 1;
+    }
+#endif
+
+    if (options.command == Command::Serve) {
+        return run_service(options.config_path, base_directory);
+    }
+
+    if (options.command == Command::SweepTombstones) {
+        enter_background_mode();
+        return sweep_tombstones(config) == 0 ? 0 : 1;
+    }
+
+    std::vector<std::filesystem::path> target_paths = resolve_targets(options.target_paths, !options.confirmed);
+    const bool from_list = !options.target_list_path.empty();
+
+    if (options.command == Command::Holders) {
+        return list_holders(target_paths, config, use_color);
+    }
+
+    // Protected targets are dropped before the prompt so it only lists what
+    // will be deleted. Listed targets are checked as they are deleted. A
+    // purge or search keeps its targets, so only the entries inside are
+    // checked.
+    const bool purge = options.command == Command::Purge;
+    const bool find_dirs = options.command == Command::FindDirs;
+    ResultJson result_json;
+    ResultJson* json = options.json_output ? &result_json : nullptr;
+    bool refused = false;
+    target_paths.erase(std::remove_if(target_paths.begin(), target_paths.end(),
+                                      [&](const std::filesystem::path& target_path) {
+                                          std::string message;
+                                          if (purge || find_dirs || target_allowed(target_path, config, message)) return false;
+                                          std::cerr << style(message, "31;1", use_color) << "\n";
+                                          if (json) {
+                                              DeleteResult refusal{false, false, message};
+                                              refusal.target = target_path;
+                                              json->add(refusal);
+                                          }
+                                          refused = true;
+                                          return true;
+                                      }),
+                       target_paths.end());
+    if (refused && target_paths.empty() && !from_list) {
+        if (json) json->write(std::cout, std::chrono::nanoseconds(0));
+        return 1;
+    }
+    profile.mark("resolve_targets");
+
+    if (options.command == Command::Scan) {
+        return scan_targets(target_paths, config, use_color) == 0 && !refused ? 0 : 1;
+    }
+
+    const bool relaunch = config.auto_elevate && !options.elevated_run && !is_running_as_admin() && standalone;
+    profile.mark("elevation_check");
+    if (relaunch) return relaunch_as_admin(raw_args);
 
-    const std::filesystem::path target_path = resolve_target_path(options.target_path);
+    // Per-run options the service was not started with keep the delete in
+    // this process. Without a service one is started for later invocations.
+    const bool in_process = purge || find_dirs || from_list || !options.trace_path.empty() || options.tombstone ||
+                            config.throttle || options.background || !options.progress_json_path.empty() ||
+                            options.json_output || options.kill_holders || config.shredder;
+    ServiceClient service;
+    if (config.use_resident_service && !in_process && !service.connect()) {
+        spawn_service(options.config_path);
+    }
+    if (config.use_resident_service) profile.mark("service_connect");
 
-    if (config.auto_elevate && !options.elevated_run && !is_running_as_admin() && standalone) {
-        return relaunch_as_admin(raw_args);
+    std::FILE* progress_stream = nullptr;
+    if (!options.progress_json_path.empty()) {
+        std::string open_error;
+        progress_stream = open_progress_stream(options.progress_json_path, open_error);
+        if (!progress_stream) {
+            std::cerr << style("error:", "31;1", use_color) << " " << open_error << "\n";
+            return 1;
+        }
     }
 
-    std::cout << style("Warning: Exterminate permanently deletes targets (no Recycle Bin).", "33;1", use_color) << "\n";
+    std::ostream& text = text_out(json);
+    text << style("Warning: Exterminate permanently deletes targets (no Recycle Bin).", "33;1", use_color) << "\n";
 
     if (!options.confirmed) {
         if (!has_console_window()) {
@@ -104,27 +620,116 @@ int run(int argc, char* argv[]) {
             return 1;
         }
 
-        std::cout << style("Type YES (or Y) to confirm permanent deletion of:", "36;1", use_color) << "\n";
-        std::cout << style(target_path.string(), "36", use_color) << "\n> " << std::flush;
+        if (from_list && options.target_list_path == "-") {
+            std::cerr << style("error:", "31;1", use_color) << " reading targets from stdin requires --confirmed.\n";
+            return 1;
+        }
+
+        std::string what = "permanent deletion of:";
+        if (purge) what = "permanent deletion of " + describe_purge_rules(options.purge) + " in:";
+        if (find_dirs) {
+            what = "permanent deletion of every directory named " + describe_find_dir_names(options.find_dir_names) +
+                   " under:";
+        }
+        text << style("Type YES (or Y) to confirm " + what, "36;1", use_color) << "\n";
+        for (const auto& target_path : target_paths) {
+            text << style(target_path.string(), "36", use_color) << "\n";
+        }
+        if (from_list) {
+            text << style("every target listed in " + options.target_list_path, "36", use_color) << "\n";
+        }
+        if (config.shredder) {
+            const int passes = config.shredder->passes();
+            text << style("after overwriting every file " + std::to_string(passes) + (passes == 1 ? " time" : " times"),
+                          "36;1", use_color)
+                 << "\n";
+        }
+        if (options.kill_holders) {
+            text << style("and ending any process that holds an entry open", "36;1", use_color) << "\n";
+        }
+        text << "> " << std::flush;
 
         std::string answer;
         std::getline(std::cin, answer);
         const std::string normalized = normalize_confirmation(answer);
         if (normalized != "YES" && normalized != "Y") {
-            std::cout << style("Canceled.", "33;1", use_color) << "\n";
+            text << style("Canceled.", "33;1", use_color) << "\n";
             return 1;
         }
     }
 
-    const DeleteResult result = delete_target(target_path, config);
-    if (result.success) {
-        std::cout << style(result.message, "32;1", use_color) << "\n";
-        return 0;
+    profile.mark("confirmation", !options.confirmed);
+
+    // Before any worker starts, since threads inherit the priority.
+    if (options.background) enter_background_mode();
+
+    TraceRecorder trace_recorder;
+    TraceRecorder* trace = options.trace_path.empty() ? nullptr : &trace_recorder;
+
+    // Only deletes in this process are counted. A purge removes a subset of
+    // what it lists, so there is nothing to estimate against.
+    std::unique_ptr<ProgressReporter> reporter;
+    const bool show_progress_line = use_color && !options.no_progress;
+    if (!purge && !service.connected() && (show_progress_line || progress_stream)) {
+        config.progress = std::make_shared<DeleteProgress>();
+        reporter = std::make_unique<ProgressReporter>(
+            *config.progress, std::chrono::milliseconds(500),
+            [progress_stream, show_progress_line](const ProgressSnapshot& snapshot, bool final) {
+                if (progress_stream) {
+                    std::fputs(format_progress_event(snapshot, final).c_str(), progress_stream);
+                    std::fflush(progress_stream);
+                }
+                if (show_progress_line) draw_progress_line(snapshot, final);
+            });
     }
 
-    std::cerr << style(result.message, "31;1", use_color) << "\n";
-    return 1;
-#endif
+    const auto run_started = std::chrono::steady_clock::now();
+    int exit_code = refused ? 1 : 0;
+    if (purge) {
+        exit_code = purge_targets(target_paths, options.purge, config, use_color);
+    } else if (find_dirs) {
+        exit_code = find_dirs_targets(target_paths, options.find_dir_names, config, use_color, json);
+    } else if (from_list) {
+        exit_code = delete_listed_targets(options.target_list_path, target_paths, config, trace, use_color, json);
+    } else {
+        std::vector<DeleteResult> results;
+        if (!service.connected() || !service.submit(config.identity, target_paths, results)) {
+            results = delete_targets(target_paths, config, trace);
+        }
+        if (reporter) reporter->stop();
+        for (const auto& result : results) {
+            print_result(result, use_color, json);
+            if (!result.success) exit_code = 1;
+        }
+    }
+    if (reporter) reporter->stop();
+    if (progress_stream) std::fclose(progress_stream);
+    if (config.shredder) {
+        const Shredder& shredder = *config.shredder;
+        text << "Overwrote " << shredder.files_overwritten() << " files (" << format_bytes(shredder.bytes_written())
+             << ", " << shredder.passes() << (shredder.passes() == 1 ? " pass" : " passes") << ")\n";
+        if (shredder.hard_linked_files() > 0) {
+            text << style("Not overwritten, other hard links keep the data: " +
+                              std::to_string(shredder.hard_linked_files()),
+                          "33;1", use_color)
+                 << "\n";
+        }
+    }
+    if (json) json->write(std::cout, std::chrono::steady_clock::now() - run_started);
+
+    // Also picks up tombstones a previous run's sweeper did not finish.
+    if (has_pending_tombstones()) spawn_tombstone_sweeper(options.config_path);
+
+    if (profile.enabled()) profile.print(std::cerr);
+
+    if (trace) {
+        std::string trace_error;
+        if (!trace->write(options.trace_path, trace_error)) {
+            std::cerr << style("error:", "31;1", use_color) << " " << trace_error << "\n";
+            exit_code = 1;
+        }
+    }
+    return exit_code;
 }
 
 } // namespace exterminate
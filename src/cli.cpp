@@ -1,7 +1,10 @@
 #include "cli.hpp"
 
+#include "shred.hpp"
+
 #include <algorithm>
 #include <cctype>
+#include <filesystem>
 #include <iostream>
 #include <vector>
 
@@ -26,7 +29,41 @@ bool read_next_value(int argc, char* argv[], int& index, std::string& out_value)
 }
 
 bool looks_like_option(const std::string& value) {
+#ifdef _WIN32
     return value.size() > 1 && (value.front() == '-' || value.front() == '/');
+#else
+    return value.size() > 1 && value.front() == '-';
+#endif
+}
+
+// "node_modules,target,obj". Names only: a separator or "." / ".." would
+// match nothing or something else than the user meant.
+bool add_find_dir_names(const std::string& text, std::vector<NativeName>& out_names) {
+    size_t start = 0;
+    bool added = false;
+    while (start <= text.size()) {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos) end = text.size();
+        const std::string name = text.substr(start, end - start);
+        start = end + 1;
+        if (name.empty()) continue;
+        if (name == "." || name == ".." || name.find_first_of("/\\") != std::string::npos) return false;
+        out_names.push_back(fold_name_case(std::filesystem::path(name).native()));
+        added = true;
+    }
+    return added;
+}
+
+bool parse_rate(const std::string& text, std::uint64_t& out_value) {
+    if (text.empty() || text.size() > 18) return false;
+    std::uint64_t value = 0;
+    for (char c : text) {
+        if (!std::isdigit(static_cast<unsigned char>(c))) return false;
+        value = value * 10 + static_cast<std::uint64_t>(c - '0');
+    }
+    if (value == 0) return false;
+    out_value = value;
+    return true;
 }
 
 } // namespace
@@ -39,6 +76,12 @@ bool parse_cli(int argc, char* argv[], CliOptions& out_options, std::string& out
     bool install = false;
     bool uninstall = false;
     bool help = false;
+    bool scan = false;
+    bool sweep_tombstones = false;
+    bool serve = false;
+    bool purge = false;
+    bool find_dirs = false;
+    bool holders = false;
 
     for (int index = 1; index < argc; ++index) {
         const std::string argument = argv[index];
@@ -59,6 +102,141 @@ bool parse_cli(int argc, char* argv[], CliOptions& out_options, std::string& out
             continue;
         }
 
+        if (normalized == "--dry-run" || normalized == "--scan") {
+            scan = true;
+            continue;
+        }
+
+        if (normalized == "--tombstone") {
+            out_options.tombstone = true;
+            continue;
+        }
+
+        if (normalized == "--holders") {
+            holders = true;
+            continue;
+        }
+
+        if (normalized == "--kill-holders") {
+            out_options.kill_holders = true;
+            continue;
+        }
+
+        if (normalized == "--shred" || normalized.rfind("--shred=", 0) == 0) {
+            std::uint64_t passes = 1;
+            if (normalized.size() > 7 && (!parse_rate(normalized.substr(8), passes) ||
+                                          passes > static_cast<std::uint64_t>(Shredder::kMaxPasses))) {
+                out_error = "invalid pass count for --shred: " + argument.substr(8) + " (use 1 to " +
+                            std::to_string(Shredder::kMaxPasses) + ")";
+                return false;
+            }
+            out_options.shred_passes = static_cast<int>(passes);
+            continue;
+        }
+
+        if (normalized == "--profile-startup") {
+            out_options.profile_startup = true;
+            continue;
+        }
+
+        if (normalized == "--background") {
+            out_options.background = true;
+            continue;
+        }
+
+        if (normalized == "--max-ops-per-sec") {
+            std::string value;
+            if (!read_next_value(argc, argv, index, value)) {
+                out_error = "missing value for --max-ops-per-sec";
+                return false;
+            }
+            if (!parse_rate(value, out_options.max_ops_per_sec)) {
+                out_error = "invalid rate for --max-ops-per-sec: " + value + " (use a positive count, e.g. 2000)";
+                return false;
+            }
+            continue;
+        }
+
+        if (normalized == "--max-bytes-per-sec") {
+            std::string value;
+            if (!read_next_value(argc, argv, index, value)) {
+                out_error = "missing value for --max-bytes-per-sec";
+                return false;
+            }
+            if (!parse_purge_size(value, out_options.max_bytes_per_sec) || out_options.max_bytes_per_sec == 0) {
+                out_error = "invalid size for --max-bytes-per-sec: " + value + " (use e.g. 200M, 1GiB)";
+                return false;
+            }
+            continue;
+        }
+
+        if (normalized == "--sweep-tombstones") {
+            sweep_tombstones = true;
+            continue;
+        }
+
+        if (normalized == "--serve") {
+            serve = true;
+            continue;
+        }
+
+        if (normalized == "--purge") {
+            purge = true;
+            continue;
+        }
+
+        if (normalized == "--older-than") {
+            std::string value;
+            if (!read_next_value(argc, argv, index, value)) {
+                out_error = "missing value for --older-than";
+                return false;
+            }
+            if (!parse_purge_age(value, out_options.purge.older_than_seconds)) {
+                out_error = "invalid age for --older-than: " + value + " (use e.g. 14d, 12h, 30m)";
+                return false;
+            }
+            out_options.purge.by_age = true;
+            continue;
+        }
+
+        if (normalized == "--larger-than") {
+            std::string value;
+            if (!read_next_value(argc, argv, index, value)) {
+                out_error = "missing value for --larger-than";
+                return false;
+            }
+            if (!parse_purge_size(value, out_options.purge.larger_than_bytes)) {
+                out_error = "invalid size for --larger-than: " + value + " (use e.g. 1GiB, 500M, 64k)";
+                return false;
+            }
+            out_options.purge.by_size = true;
+            continue;
+        }
+
+        if (normalized == "--match") {
+            std::string value;
+            if (!read_next_value(argc, argv, index, value)) {
+                out_error = "missing value for --match";
+                return false;
+            }
+            add_purge_patterns(value, out_options.purge);
+            continue;
+        }
+
+        if (normalized == "--find-dirs") {
+            std::string value;
+            if (!read_next_value(argc, argv, index, value)) {
+                out_error = "missing value for --find-dirs";
+                return false;
+            }
+            if (!add_find_dir_names(value, out_options.find_dir_names)) {
+                out_error = "invalid directory name for --find-dirs: " + value + " (use e.g. node_modules,target)";
+                return false;
+            }
+            find_dirs = true;
+            continue;
+        }
+
         if (normalized == "--config" || normalized == "-config" || normalized == "/config") {
             if (!read_next_value(argc, argv, index, out_options.config_path)) {
                 out_error = "missing value for --config";
@@ -67,6 +245,52 @@ bool parse_cli(int argc, char* argv[], CliOptions& out_options, std::string& out
             continue;
         }
 
+        if (normalized == "--from-file") {
+            if (!read_next_value(argc, argv, index, out_options.target_list_path)) {
+                out_error = "missing value for --from-file";
+                return false;
+            }
+            continue;
+        }
+
+        if (normalized == "--trace") {
+            if (!read_next_value(argc, argv, index, out_options.trace_path)) {
+                out_error = "missing value for --trace";
+                return false;
+            }
+            continue;
+        }
+
+        if (normalized == "--progress-json") {
+            if (!read_next_value(argc, argv, index, out_options.progress_json_path)) {
+                out_error = "missing value for --progress-json";
+                return false;
+            }
+            continue;
+        }
+
+        if (normalized == "--output") {
+            std::string value;
+            if (!read_next_value(argc, argv, index, value)) {
+                out_error = "missing value for --output";
+                return false;
+            }
+            if (value == "json") {
+                out_options.json_output = true;
+            } else if (value == "text") {
+                out_options.json_output = false;
+            } else {
+                out_error = "invalid value for --output: " + value + " (use text or json)";
+                return false;
+            }
+            continue;
+        }
+
+        if (normalized == "--no-progress") {
+            out_options.no_progress = true;
+            continue;
+        }
+
         if (normalized == "--elevated-run") {
             out_options.elevated_run = true;
             continue;
@@ -95,8 +319,10 @@ bool parse_cli(int argc, char* argv[], CliOptions& out_options, std::string& out
         return false;
     }
 
+    const bool has_targets = !target_parts.empty() || !out_options.target_list_path.empty();
+
     if (install) {
-        if (!target_parts.empty()) {
+        if (has_targets) {
             out_error = "install mode does not accept a target path";
             return false;
         }
@@ -105,7 +331,7 @@ bool parse_cli(int argc, char* argv[], CliOptions& out_options, std::string& out
     }
 
     if (uninstall) {
-        if (!target_parts.empty()) {
+        if (has_targets) {
             out_error = "uninstall mode does not accept a target path";
             return false;
         }
@@ -113,15 +339,107 @@ bool parse_cli(int argc, char* argv[], CliOptions& out_options, std::string& out
         return true;
     }
 
-    if (!target_parts.empty()) {
-        std::string merged_target;
-        for (size_t i = 0; i < target_parts.size(); ++i) {
-            if (i > 0) merged_target.push_back(' ');
-            merged_target += target_parts[i];
+    if (sweep_tombstones) {
+        if (has_targets) {
+            out_error = "--sweep-tombstones does not accept a target path";
+            return false;
+        }
+        out_options.command = Command::SweepTombstones;
+        return true;
+    }
+
+    if (serve) {
+        if (has_targets) {
+            out_error = "--serve does not accept a target path";
+            return false;
+        }
+        out_options.command = Command::Serve;
+        return true;
+    }
+
+    if (out_options.kill_holders && (purge || scan || holders)) {
+        out_error = "--kill-holders cannot be combined with --purge, --dry-run or --holders";
+        return false;
+    }
+
+    if (out_options.shred_passes > 0 && (purge || scan || holders || out_options.tombstone)) {
+        out_error = "--shred cannot be combined with --purge, --dry-run, --holders or --tombstone";
+        return false;
+    }
+
+    if (holders) {
+        if (target_parts.empty() || !out_options.target_list_path.empty()) {
+            out_error = "--holders requires paths and does not read --from-file";
+            return false;
+        }
+        if (purge || find_dirs || scan || out_options.json_output) {
+            out_error = "--holders cannot be combined with --purge, --find-dirs, --dry-run or --output json";
+            return false;
+        }
+        out_options.command = Command::Holders;
+        out_options.target_paths = target_parts;
+        return true;
+    }
+
+    if (!purge && !out_options.purge.empty()) {
+        out_error = "--older-than, --larger-than and --match require --purge";
+        return false;
+    }
+
+    if (purge && find_dirs) {
+        out_error = "use either --purge or --find-dirs, not both";
+        return false;
+    }
+
+    if (purge) {
+        if (target_parts.empty() || !out_options.target_list_path.empty()) {
+            out_error = "--purge requires target directories and does not read --from-file";
+            return false;
         }
+        if (out_options.purge.empty()) {
+            out_error = "--purge requires at least one of --older-than, --larger-than or --match";
+            return false;
+        }
+        if (scan || out_options.tombstone || !out_options.progress_json_path.empty() || out_options.json_output) {
+            out_error = "--purge cannot be combined with --dry-run, --tombstone, --progress-json or --output json";
+            return false;
+        }
+        out_options.command = Command::Purge;
+        out_options.target_paths = target_parts;
+        return true;
+    }
+
+    if (find_dirs) {
+        if (target_parts.empty() || !out_options.target_list_path.empty()) {
+            out_error = "--find-dirs requires root directories and does not read --from-file";
+            return false;
+        }
+        if (scan) {
+            out_error = "--find-dirs cannot be combined with --dry-run";
+            return false;
+        }
+        out_options.command = Command::FindDirs;
+        out_options.target_paths = target_parts;
+        return true;
+    }
+
+    if (scan) {
+        if (out_options.json_output) {
+            out_error = "--output json cannot be combined with --dry-run";
+            return false;
+        }
+        if (target_parts.empty()) {
+            out_error = "dry-run mode requires a target path";
+            return false;
+        }
+        out_options.command = Command::Scan;
+        out_options.target_paths = target_parts;
+        return true;
+    }
 
+    if (has_targets) {
         out_options.command = Command::Delete;
-        out_options.target_path = merged_target;
+        out_options.target_paths = target_parts;
         return true;
     }
 
@@ -132,12 +450,29 @@ bool parse_cli(int argc, char* argv[], CliOptions& out_options, std::string& out
 void print_usage() {
     std::cout << "Usage:\n";
     std::cout << "  exterminate \"C:\\path\\to\\target\"\n";
+    std::cout << "  exterminate \"C:\\path\\one\" \"C:\\path\\two\" ...\n";
     std::cout << "  exterminate --install\n";
     std::cout << "  exterminate -install\n";
     std::cout << "  exterminate --uninstall\n";
     std::cout << "  exterminate -uninstall\n";
     std::cout << "  exterminate --confirmed \"C:\\path\\to\\target\"\n";
+    std::cout << "  exterminate --dry-run \"C:\\path\\to\\target\"\n";
+    std::cout << "  exterminate --tombstone \"C:\\path\\to\\target\"\n";
+    std::cout << "  exterminate --purge --older-than 14d --match \"*.tmp|*.log\" \"C:\\path\\to\\dir\"\n";
+    std::cout << "  exterminate --purge --larger-than 1GiB \"C:\\path\\to\\dir\"\n";
+    std::cout << "  exterminate --find-dirs node_modules,target,obj \"C:\\path\\to\\root\"\n";
+    std::cout << "  exterminate --background --max-ops-per-sec 2000 --max-bytes-per-sec 200M \"C:\\path\\to\\target\"\n";
+    std::cout << "  exterminate --from-file \"C:\\path\\to\\list.txt\"\n";
+    std::cout << "  <producer> | exterminate --confirmed --from-file -\n";
     std::cout << "  exterminate --config \"C:\\path\\to\\config.json\" \"C:\\path\\to\\target\"\n";
+    std::cout << "  exterminate --trace \"C:\\path\\to\\trace.json\" \"C:\\path\\to\\target\"\n";
+    std::cout << "  exterminate --progress-json fd:3 --confirmed \"C:\\path\\to\\target\"\n";
+    std::cout << "  exterminate --output json --confirmed \"C:\\path\\one\" \"C:\\path\\two\"\n";
+    std::cout << "  exterminate --shred=3 \"D:\\scratch\"\n";
+    std::cout << "  exterminate --kill-holders \"C:\\path\\to\\target\"\n";
+    std::cout << "  exterminate --holders \"C:\\path\\to\\locked.dll\"\n";
+    std::cout << "  exterminate --profile-startup --confirmed \"C:\\path\\to\\target\"\n";
+    std::cout << "  exterminate --serve\n";
     std::cout << "\nWarning: Exterminate permanently deletes targets (no Recycle Bin).\n";
 }
 
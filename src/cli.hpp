@@ -1,12 +1,22 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <vector>
+
+#include "purge.hpp"
 
 namespace exterminate {
 
 enum class Command {
     None,
     Delete,
+    Purge,
+    FindDirs,
+    Holders,
+    Scan,
+    SweepTombstones,
+    Serve,
     Install,
     Uninstall,
     Help,
@@ -14,10 +24,28 @@ enum class Command {
 
 struct CliOptions {
     Command command = Command::None;
-    std::string target_path;
+    std::vector<std::string> target_paths;
+    std::string target_list_path;
     std::string config_path;
+    std::string trace_path;
+    std::string progress_json_path;
     bool elevated_run = false;
     bool confirmed = false;
+    bool tombstone = false;
+    bool profile_startup = false;
+    bool background = false;
+    bool no_progress = false;
+    bool kill_holders = false;
+    // --output json: one JSON result document on stdout instead of text.
+    bool json_output = false;
+    // Zero is unlimited.
+    std::uint64_t max_ops_per_sec = 0;
+    std::uint64_t max_bytes_per_sec = 0;
+    // --shred[=passes]; zero does not overwrite.
+    int shred_passes = 0;
+    PurgeRules purge;
+    // Folded with fold_name_case.
+    std::vector<NativeName> find_dir_names;
 };
 
 bool parse_cli(int argc, char* argv[], CliOptions& out_options, std::string& out_error);
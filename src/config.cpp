@@ -1,10 +1,17 @@
 #include "config.hpp"
 
+#include "content_hash.hpp"
+#include "path_guard.hpp"
+#include "paths.hpp"
+
 #include <algorithm>
+#include <cctype>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
-#include <regex>
-#include <sstream>
+#include <map>
+#include <mutex>
+#include <string_view>
 
 namespace exterminate {
 
@@ -12,103 +19,541 @@ namespace fs = std::filesystem;
 
 namespace {
 
+constexpr int kMaxNesting = 64;
+
 std::string read_text_file(const fs::path& path) {
-    std::ifstream in(path);
+    std::ifstream in(path, std::ios::binary);
     if (!in.is_open()) return "";
     return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
 }
 
-std::string to_lower_copy(std::string value) {
-    std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) {
-        return static_cast<char>(std::tolower(c));
-    });
-    return value;
+bool equals_ignore_case(std::string_view lhs, std::string_view rhs) {
+    if (lhs.size() != rhs.size()) return false;
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(lhs[i])) != std::tolower(static_cast<unsigned char>(rhs[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void append_utf8(std::string& out, std::uint32_t code_point) {
+    if (code_point < 0x80) {
+        out.push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else if (code_point < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+}
+
+enum class JsonKind {
+    Null,
+    Bool,
+    Integer,
+    Number,
+    String,
+    Array,
+    Object,
+};
+
+const char* json_kind_name(JsonKind kind) {
+    switch (kind) {
+        case JsonKind::Null: return "null";
+        case JsonKind::Bool: return "a boolean";
+        case JsonKind::Integer: return "an integer";
+        case JsonKind::Number: return "a number";
+        case JsonKind::String: return "a string";
+        case JsonKind::Array: return "an array";
+        case JsonKind::Object: return "an object";
+    }
+    return "a value";
+}
+
+// Only what the key table needs is kept: scalars, and the elements of an
+// array when they are all strings.
+struct JsonValue {
+    JsonKind kind = JsonKind::Null;
+    bool boolean = false;
+    long long integer = 0;
+    std::string text;
+    std::vector<std::string> strings;
+    bool all_strings = true;
+};
+
+using ApplyKey = bool (*)(const JsonValue& value, AppConfig& config, std::string& out_error);
+
+struct ConfigKey {
+    const char* name;
+    ApplyKey apply;
+};
+
+bool expect_kind(const JsonValue& value, JsonKind kind, std::string& out_error) {
+    if (value.kind == kind) return true;
+    out_error = std::string("expected ") + json_kind_name(kind) + ", found " + json_kind_name(value.kind);
+    return false;
+}
+
+bool read_bool(const JsonValue& value, bool& target, std::string& out_error) {
+    if (!expect_kind(value, JsonKind::Bool, out_error)) return false;
+    target = value.boolean;
+    return true;
+}
+
+bool read_count(const JsonValue& value, int& target, std::string& out_error) {
+    if (!expect_kind(value, JsonKind::Integer, out_error)) return false;
+    if (value.integer < 0 || value.integer > 0x7fffffff) {
+        out_error = "expected a non-negative integer, found " + std::to_string(value.integer);
+        return false;
+    }
+    target = static_cast<int>(value.integer);
+    return true;
+}
+
+bool read_string(const JsonValue& value, std::string& target, std::string& out_error) {
+    if (!expect_kind(value, JsonKind::String, out_error)) return false;
+    target = value.text;
+    return true;
+}
+
+bool read_string_list(const JsonValue& value, std::vector<std::string>& target, std::string& out_error) {
+    if (!expect_kind(value, JsonKind::Array, out_error)) return false;
+    if (!value.all_strings) {
+        out_error = "expected an array of strings";
+        return false;
+    }
+    target = value.strings;
+    return true;
+}
+
+bool read_engine(const JsonValue& value, DeleteEngine& target, std::string& out_error) {
+    if (!expect_kind(value, JsonKind::String, out_error)) return false;
+    if (equals_ignore_case(value.text, "parallel")) {
+        target = DeleteEngine::Parallel;
+    } else if (equals_ignore_case(value.text, "uring")) {
+        target = DeleteEngine::Uring;
+    } else if (equals_ignore_case(value.text, "filesystem")) {
+        target = DeleteEngine::Filesystem;
+    } else {
+        out_error = "unknown delete engine \"" + value.text + "\" (expected parallel, uring or filesystem)";
+        return false;
+    }
+    return true;
 }
 
-std::string unescape_json_string(const std::string& value) {
-    std::string out;
-    out.reserve(value.size());
-    for (size_t i = 0; i < value.size(); ++i) {
-        if (value[i] == '\\' && i + 1 < value.size()) {
-            const char next = value[i + 1];
-            if (next == '\\' || next == '"' || next == '/') {
-                out.push_back(next);
-                ++i;
-                continue;
+constexpr ConfigKey kConfigKeys[] = {
+    {"retries", [](const JsonValue& v, AppConfig& c, std::string& e) { return read_count(v, c.retries, e); }},
+    {"retryDelayMs", [](const JsonValue& v, AppConfig& c, std::string& e) { return read_count(v, c.retry_delay_ms, e); }},
+    {"autoElevate", [](const JsonValue& v, AppConfig& c, std::string& e) { return read_bool(v, c.auto_elevate, e); }},
+    {"selfInstallToUserPath",
+     [](const JsonValue& v, AppConfig& c, std::string& e) { return read_bool(v, c.self_install_to_user_path, e); }},
+    {"installDirectory",
+     [](const JsonValue& v, AppConfig& c, std::string& e) { return read_string(v, c.install_directory, e); }},
+    {"copyDefaultConfigOnInstall",
+     [](const JsonValue& v, AppConfig& c, std::string& e) { return read_bool(v, c.copy_default_config_on_install, e); }},
+    {"forceTakeOwnership",
+     [](const JsonValue& v, AppConfig& c, std::string& e) { return read_bool(v, c.force_take_ownership, e); }},
+    {"grantAdministratorsFullControl",
+     [](const JsonValue& v, AppConfig& c, std::string& e) {
+         return read_bool(v, c.grant_administrators_full_control, e);
+     }},
+    {"grantCurrentUserFullControl",
+     [](const JsonValue& v, AppConfig& c, std::string& e) { return read_bool(v, c.grant_current_user_full_control, e); }},
+    {"useRobocopyMirrorFallback",
+     [](const JsonValue& v, AppConfig& c, std::string& e) { return read_bool(v, c.use_robocopy_mirror_fallback, e); }},
+    {"useWslFallbackIfAvailable",
+     [](const JsonValue& v, AppConfig& c, std::string& e) { return read_bool(v, c.use_wsl_fallback_if_available, e); }},
+    {"deleteEngine", [](const JsonValue& v, AppConfig& c, std::string& e) { return read_engine(v, c.delete_engine, e); }},
+    {"workerThreads", [](const JsonValue& v, AppConfig& c, std::string& e) { return read_count(v, c.worker_threads, e); }},
+    {"tombstoneDelete", [](const JsonValue& v, AppConfig& c, std::string& e) { return read_bool(v, c.tombstone_delete, e); }},
+    {"useResidentService",
+     [](const JsonValue& v, AppConfig& c, std::string& e) { return read_bool(v, c.use_resident_service, e); }},
+    {"serviceIdleTimeoutSeconds",
+     [](const JsonValue& v, AppConfig& c, std::string& e) { return read_count(v, c.service_idle_timeout_seconds, e); }},
+    {"protectedPaths",
+     [](const JsonValue& v, AppConfig& c, std::string& e) { return read_string_list(v, c.protected_paths, e); }},
+};
+
+constexpr size_t kConfigKeyCount = sizeof(kConfigKeys) / sizeof(kConfigKeys[0]);
+
+const ConfigKey* find_config_key(std::string_view name, size_t& out_index) {
+    for (size_t i = 0; i < kConfigKeyCount; ++i) {
+        if (equals_ignore_case(name, kConfigKeys[i].name)) {
+            out_index = i;
+            return &kConfigKeys[i];
+        }
+    }
+    return nullptr;
+}
+
+// Single pass over the text. Positions are only turned into line and column
+// when a diagnostic is reported. A syntax error stops the parse; the keys
+// read before it keep their values.
+class ConfigParser {
+public:
+    ConfigParser(std::string_view text, std::string source, std::vector<std::string>& warnings)
+        : text_(text), source_(std::move(source)), warnings_(warnings) {}
+
+    AppConfig parse() {
+        AppConfig config;
+        if (text_.substr(0, 3) == "\xEF\xBB\xBF") pos_ = 3;
+
+        skip_space();
+        if (!consume('{')) {
+            error("expected '{' at the start of the config");
+            return config;
+        }
+
+        bool seen[kConfigKeyCount] = {};
+        skip_space();
+        if (consume('}')) return finish(config);
+
+        std::string key;
+        while (true) {
+            skip_space();
+            const size_t key_offset = pos_;
+            if (!parse_key(key)) return config;
+            skip_space();
+            const size_t value_offset = pos_;
+            JsonValue value;
+            if (!parse_value(value, 1)) return config;
+
+            size_t index = 0;
+            const ConfigKey* entry = find_config_key(key, index);
+            if (!entry) {
+                warn(key_offset, "unknown key \"" + key + "\"");
+            } else {
+                if (seen[index]) warn(key_offset, "duplicate key \"" + key + "\"; the last value wins");
+                seen[index] = true;
+                std::string apply_error;
+                if (!entry->apply(value, config, apply_error)) {
+                    warn(value_offset, std::string(entry->name) + ": " + apply_error + "; using the default");
+                }
+            }
+
+            skip_space();
+            if (consume(',')) continue;
+            if (consume('}')) return finish(config);
+            error("expected ',' or '}'");
+            return config;
+        }
+    }
+
+private:
+    AppConfig finish(const AppConfig& config) {
+        skip_space();
+        if (pos_ < text_.size()) warn(pos_, "unexpected text after the config object");
+        return config;
+    }
+
+    void skip_space() {
+        while (pos_ < text_.size()) {
+            const char c = text_[pos_];
+            if (c != ' ' && c != '\t' && c != '\n' && c != '\r') return;
+            ++pos_;
+        }
+    }
+
+    bool consume(char expected) {
+        if (pos_ < text_.size() && text_[pos_] == expected) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    bool consume_word(std::string_view word) {
+        if (text_.substr(pos_, word.size()) != word) return false;
+        pos_ += word.size();
+        return true;
+    }
+
+    bool parse_key(std::string& out) {
+        if (pos_ >= text_.size() || text_[pos_] != '"') {
+            error("expected a key string");
+            return false;
+        }
+        if (!parse_string(out)) return false;
+        skip_space();
+        if (!consume(':')) {
+            error("expected ':' after key \"" + out + "\"");
+            return false;
+        }
+        return true;
+    }
+
+    bool parse_hex4(std::uint32_t& out) {
+        if (pos_ + 4 > text_.size()) return false;
+        out = 0;
+        for (int i = 0; i < 4; ++i) {
+            const char c = text_[pos_++];
+            out <<= 4;
+            if (c >= '0' && c <= '9') {
+                out |= static_cast<std::uint32_t>(c - '0');
+            } else if (c >= 'a' && c <= 'f') {
+                out |= static_cast<std::uint32_t>(c - 'a' + 10);
+            } else if (c >= 'A' && c <= 'F') {
+                out |= static_cast<std::uint32_t>(c - 'A' + 10);
+            } else {
+                return false;
             }
-            if (next == 'n') {
-                out.push_back('\n');
-                ++i;
-                continue;
+        }
+        return true;
+    }
+
+    bool parse_string(std::string& out) {
+        ++pos_;
+        out.clear();
+        while (pos_ < text_.size()) {
+            const size_t run_end = text_.find_first_of("\"\\", pos_);
+            if (run_end == std::string_view::npos) break;
+            out.append(text_.data() + pos_, run_end - pos_);
+            pos_ = run_end + 1;
+            if (text_[run_end] == '"') return true;
+
+            if (pos_ >= text_.size()) break;
+            const char escaped = text_[pos_++];
+            switch (escaped) {
+                case '"': out.push_back('"'); break;
+                case '\\': out.push_back('\\'); break;
+                case '/': out.push_back('/'); break;
+                case 'b': out.push_back('\b'); break;
+                case 'f': out.push_back('\f'); break;
+                case 'n': out.push_back('\n'); break;
+                case 'r': out.push_back('\r'); break;
+                case 't': out.push_back('\t'); break;
+                case 'u': {
+                    std::uint32_t code_point = 0;
+                    if (!parse_hex4(code_point)) {
+                        error(run_end, "invalid \\u escape");
+                        return false;
+                    }
+                    if (code_point >= 0xD800 && code_point < 0xDC00 && consume_word("\\u")) {
+                        std::uint32_t low = 0;
+                        if (!parse_hex4(low) || low < 0xDC00 || low >= 0xE000) {
+                            error(run_end, "invalid surrogate pair");
+                            return false;
+                        }
+                        code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    append_utf8(out, code_point);
+                    break;
+                }
+                default:
+                    // Hand-written Windows paths often carry single
+                    // backslashes; keep them as written.
+                    warn(run_end, "invalid escape '\\" + std::string(1, escaped) + "'; write backslashes as \\\\");
+                    out.push_back('\\');
+                    out.push_back(escaped);
+                    break;
             }
-            if (next == 'r') {
-                out.push_back('\r');
-                ++i;
-                continue;
+        }
+        error("unterminated string");
+        return false;
+    }
+
+    bool parse_digits() {
+        const size_t first = pos_;
+        while (pos_ < text_.size() && std::isdigit(static_cast<unsigned char>(text_[pos_]))) ++pos_;
+        return pos_ > first;
+    }
+
+    bool parse_number(JsonValue& out) {
+        const size_t start = pos_;
+        const bool negative = consume('-');
+        bool integral = parse_digits();
+        const size_t integer_end = pos_;
+        if (!integral) {
+            error(start, "invalid number");
+            return false;
+        }
+        if (consume('.')) {
+            integral = false;
+            if (!parse_digits()) {
+                error(start, "invalid number");
+                return false;
             }
-            if (next == 't') {
-                out.push_back('\t');
-                ++i;
-                continue;
+        }
+        if (pos_ < text_.size() && (text_[pos_] == 'e' || text_[pos_] == 'E')) {
+            integral = false;
+            ++pos_;
+            if (!consume('+')) consume('-');
+            if (!parse_digits()) {
+                error(start, "invalid number");
+                return false;
             }
         }
-        out.push_back(value[i]);
+
+        // More than 18 digits cannot be a sensible setting; it stays a plain
+        // number so it fails the integer check instead of wrapping.
+        const size_t digit_count = integer_end - start - (negative ? 1 : 0);
+        if (!integral || digit_count > 18) {
+            out.kind = JsonKind::Number;
+            return true;
+        }
+        long long value = 0;
+        for (size_t i = integer_end - digit_count; i < integer_end; ++i) {
+            value = value * 10 + (text_[i] - '0');
+        }
+        out.kind = JsonKind::Integer;
+        out.integer = negative ? -value : value;
+        return true;
     }
-    return out;
-}
 
-void try_read_int(const std::string& text, const std::string& key, int& target) {
-    const std::regex rx("\"" + key + "\"\\s*:\\s*(-?[0-9]+)", std::regex::icase);
-    std::smatch match;
-    if (std::regex_search(text, match, rx) && match.size() >= 2) {
-        try {
-            target = std::stoi(match[1].str());
-        } catch (...) {
+    bool parse_value(JsonValue& out, int depth) {
+        if (depth > kMaxNesting) {
+            error("nesting is too deep");
+            return false;
+        }
+        if (pos_ >= text_.size()) {
+            error("expected a value");
+            return false;
+        }
+
+        const char c = text_[pos_];
+        if (c == '"') {
+            out.kind = JsonKind::String;
+            return parse_string(out.text);
         }
+        if (c == '-' || std::isdigit(static_cast<unsigned char>(c))) return parse_number(out);
+        if (consume_word("true") || consume_word("false")) {
+            out.kind = JsonKind::Bool;
+            out.boolean = c == 't';
+            return true;
+        }
+        if (consume_word("null")) {
+            out.kind = JsonKind::Null;
+            return true;
+        }
+        if (c == '[') return parse_array(out, depth);
+        if (c == '{') return parse_object(out, depth);
+
+        error("expected a value");
+        return false;
     }
-}
 
-void try_read_bool(const std::string& text, const std::string& key, bool& target) {
-    const std::regex rx("\"" + key + "\"\\s*:\\s*(true|false)", std::regex::icase);
-    std::smatch match;
-    if (std::regex_search(text, match, rx) && match.size() >= 2) {
-        target = to_lower_copy(match[1].str()) == "true";
+    bool parse_array(JsonValue& out, int depth) {
+        ++pos_;
+        out.kind = JsonKind::Array;
+        skip_space();
+        if (consume(']')) return true;
+        while (true) {
+            skip_space();
+            JsonValue element;
+            if (!parse_value(element, depth + 1)) return false;
+            if (element.kind == JsonKind::String) {
+                out.strings.push_back(std::move(element.text));
+            } else {
+                out.all_strings = false;
+            }
+            skip_space();
+            if (consume(',')) continue;
+            if (consume(']')) return true;
+            error("expected ',' or ']'");
+            return false;
+        }
     }
-}
 
-void try_read_string(const std::string& text, const std::string& key, std::string& target) {
-    const std::regex rx("\"" + key + "\"\\s*:\\s*\"([^\"]*)\"", std::regex::icase);
-    std::smatch match;
-    if (std::regex_search(text, match, rx) && match.size() >= 2) {
-        target = unescape_json_string(match[1].str());
+    // Nested objects only appear under unknown keys, so members are checked
+    // for syntax and dropped.
+    bool parse_object(JsonValue& out, int depth) {
+        ++pos_;
+        out.kind = JsonKind::Object;
+        skip_space();
+        if (consume('}')) return true;
+        std::string key;
+        while (true) {
+            skip_space();
+            if (!parse_key(key)) return false;
+            skip_space();
+            JsonValue member;
+            if (!parse_value(member, depth + 1)) return false;
+            skip_space();
+            if (consume(',')) continue;
+            if (consume('}')) return true;
+            error("expected ',' or '}'");
+            return false;
+        }
     }
-}
 
-AppConfig parse_config_text(const std::string& text) {
-    AppConfig config;
+    void warn(size_t offset, const std::string& message) {
+        size_t line = 1;
+        size_t line_start = 0;
+        const size_t end = std::min(offset, text_.size());
+        for (size_t i = 0; i < end; ++i) {
+            if (text_[i] == '\n') {
+                ++line;
+                line_start = i + 1;
+            }
+        }
+        warnings_.push_back(source_ + ":" + std::to_string(line) + ":" + std::to_string(end - line_start + 1) + ": " +
+                            message);
+    }
 
-    try_read_int(text, "retries", config.retries);
-    try_read_int(text, "retryDelayMs", config.retry_delay_ms);
-    try_read_bool(text, "autoElevate", config.auto_elevate);
-    try_read_bool(text, "selfInstallToUserPath", config.self_install_to_user_path);
-    try_read_string(text, "installDirectory", config.install_directory);
-    try_read_bool(text, "copyDefaultConfigOnInstall", config.copy_default_config_on_install);
-    try_read_bool(text, "forceTakeOwnership", config.force_take_ownership);
-    try_read_bool(text, "grantAdministratorsFullControl", config.grant_administrators_full_control);
-    try_read_bool(text, "grantCurrentUserFullControl", config.grant_current_user_full_control);
-    try_read_bool(text, "useRobocopyMirrorFallback", config.use_robocopy_mirror_fallback);
-    try_read_bool(text, "useWslFallbackIfAvailable", config.use_wsl_fallback_if_available);
+    void error(size_t offset, const std::string& message) { warn(offset, message + "; ignoring the rest of the file"); }
 
-    return config;
+    void error(const std::string& message) { error(pos_, message); }
+
+    std::string_view text_;
+    std::string source_;
+    std::vector<std::string>& warnings_;
+    size_t pos_ = 0;
+};
+
+// Built-in patterns whose variables are not set are skipped quietly; only
+// configured ones are reported.
+void compile_path_guard(AppConfig& config, const std::string& source, std::vector<std::string>& out_warnings) {
+    std::vector<std::string> patterns = builtin_protected_paths();
+#ifdef _WIN32
+    patterns.push_back(resolve_install_dir(config).string());
+#endif
+    const size_t configured_from = patterns.size();
+    patterns.insert(patterns.end(), config.protected_paths.begin(), config.protected_paths.end());
+
+    std::vector<size_t> rejected;
+    config.path_guard = PathGuard::compile(patterns, rejected);
+    for (const size_t index : rejected) {
+        if (index < configured_from) continue;
+        out_warnings.push_back(source + ": protectedPaths: \"" + patterns[index] +
+                               "\" is not an absolute path or a pattern starting with **; ignored");
+    }
 }
 
+struct CachedConfig {
+    fs::file_time_type modified;
+    std::uintmax_t size = 0;
+    AppConfig config;
+    std::vector<std::string> warnings;
+};
+
+// A hit costs two stats instead of a read and a parse; the resident service
+// reloads through here before every batch.
+std::mutex cache_mutex;
+std::map<fs::path, CachedConfig> config_cache;
+
 } // namespace
 
 std::string default_config_path(const std::string& base_directory) {
     return (fs::path(base_directory) / "config" / "exterminate.config.json").string();
 }
 
-AppConfig load_config(const std::string& explicit_path, const std::string& base_directory) {
+AppConfig parse_config_text(const std::string& text, const std::string& source,
+                            std::vector<std::string>& out_warnings) {
+    AppConfig config = ConfigParser(text, source, out_warnings).parse();
+    compile_path_guard(config, source, out_warnings);
+    return config;
+}
+
+AppConfig load_config(const std::string& explicit_path, const std::string& base_directory,
+                      std::vector<std::string>* out_warnings) {
     std::vector<fs::path> candidates;
 
     if (!explicit_path.empty()) {
@@ -120,15 +565,37 @@ AppConfig load_config(const std::string& explicit_path, const std::string& base_
 
     for (const auto& path : candidates) {
         std::error_code ec;
-        if (!fs::exists(path, ec) || ec) continue;
+        const fs::file_time_type modified = fs::last_write_time(path, ec);
+        if (ec) continue;
+        const std::uintmax_t size = fs::file_size(path, ec);
+        if (ec || size == 0) continue;
+
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        auto cached = config_cache.find(path);
+        if (cached == config_cache.end() || cached->second.modified != modified || cached->second.size != size) {
+            const std::string text = read_text_file(path);
+            if (text.empty()) continue;
 
-        const std::string text = read_text_file(path);
-        if (text.empty()) continue;
+            CachedConfig entry;
+            entry.modified = modified;
+            entry.size = size;
+            entry.config = parse_config_text(text, path.string(), entry.warnings);
+            entry.config.identity = fs::absolute(path, ec).lexically_normal().string() + "\n" +
+                                    format_hash(hash_bytes(text.data(), text.size()));
+            cached = config_cache.insert_or_assign(path, std::move(entry)).first;
+        }
 
-        return parse_config_text(text);
+        if (out_warnings) *out_warnings = cached->second.warnings;
+        return cached->second.config;
     }
 
-    return AppConfig{};
+    static const AppConfig defaults = [] {
+        AppConfig config;
+        std::vector<std::string> ignored;
+        compile_path_guard(config, "", ignored);
+        return config;
+    }();
+    return defaults;
 }
 
 } // namespace exterminate
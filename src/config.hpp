@@ -1,9 +1,22 @@
 #pragma once
 
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace exterminate {
 
+class DeleteProgress;
+class IoThrottle;
+class PathGuard;
+class Shredder;
+
+enum class DeleteEngine {
+    Filesystem,
+    Parallel,
+    Uring,
+};
+
 struct AppConfig {
     int retries = 6;
     int retry_delay_ms = 350;
@@ -16,9 +29,43 @@ struct AppConfig {
     bool grant_current_user_full_control = true;
     bool use_robocopy_mirror_fallback = true;
     bool use_wsl_fallback_if_available = true;
+    DeleteEngine delete_engine = DeleteEngine::Parallel;
+    int worker_threads = 0;
+    bool tombstone_delete = false;
+    bool use_resident_service = false;
+    int service_idle_timeout_seconds = 600;
+    // Added to the built-in list and the install directory.
+    std::vector<std::string> protected_paths;
+    // Compiled from the protected paths when the config is loaded.
+    std::shared_ptr<const PathGuard> path_guard;
+    // The file this was loaded from and a hash of its contents; empty for
+    // the built-in defaults. The resident service only deletes for clients
+    // whose config has the same identity as its own.
+    std::string identity;
+    // Set for one run by --max-ops-per-sec and --max-bytes-per-sec; shared by
+    // every worker of the run.
+    std::shared_ptr<IoThrottle> throttle;
+    // Set for one run when progress is reported; the engines count into it.
+    std::shared_ptr<DeleteProgress> progress;
+    // Set for one run by --output json: files whose size the enumeration did
+    // not report are statted so freed bytes can be counted.
+    bool count_freed_bytes = false;
+    // Set for one run by --kill-holders: processes holding open an entry
+    // that keeps surviving are ended before it is retried.
+    bool kill_lock_holders = false;
+    // Set for one run by --shred: file contents are overwritten before the
+    // file is removed.
+    std::shared_ptr<const Shredder> shredder;
 };
 
-AppConfig load_config(const std::string& explicit_path, const std::string& base_directory);
+// Unknown keys, type errors and syntax errors are reported as
+// "source:line:column: message" warnings; a key that fails keeps its default.
+AppConfig parse_config_text(const std::string& text, const std::string& source,
+                            std::vector<std::string>& out_warnings);
+// Parsed files are cached by modification time and size, so loading an
+// unchanged file again only costs a stat.
+AppConfig load_config(const std::string& explicit_path, const std::string& base_directory,
+                      std::vector<std::string>* out_warnings = nullptr);
 std::string default_config_path(const std::string& base_directory);
 
 } // namespace exterminate
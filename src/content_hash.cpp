@@ -0,0 +1,158 @@
+#include "content_hash.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace exterminate {
+
+namespace {
+
+constexpr std::uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr std::uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr std::uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+constexpr std::uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr std::uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+constexpr size_t kReadBlock = 1 << 20;
+
+std::uint64_t rotate_left(std::uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+std::uint64_t read_le64(const unsigned char* p) {
+    std::uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+std::uint64_t read_le32(const unsigned char* p) {
+    return static_cast<std::uint64_t>(p[0]) | (static_cast<std::uint64_t>(p[1]) << 8) |
+           (static_cast<std::uint64_t>(p[2]) << 16) | (static_cast<std::uint64_t>(p[3]) << 24);
+}
+
+std::uint64_t lane_round(std::uint64_t accumulator, std::uint64_t input) {
+    accumulator += input * kPrime2;
+    accumulator = rotate_left(accumulator, 31);
+    return accumulator * kPrime1;
+}
+
+std::uint64_t merge_round(std::uint64_t hash, std::uint64_t accumulator) {
+    hash ^= lane_round(0, accumulator);
+    return hash * kPrime1 + kPrime4;
+}
+
+} // namespace
+
+Xxh64::Xxh64(std::uint64_t seed)
+    : accumulators_{seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1}, buffer_{}, seed_(seed) {}
+
+void Xxh64::update(const void* data, size_t size) {
+    const unsigned char* input = static_cast<const unsigned char*>(data);
+    total_ += size;
+
+    if (buffered_ + size < sizeof(buffer_)) {
+        std::memcpy(buffer_ + buffered_, input, size);
+        buffered_ += size;
+        return;
+    }
+
+    if (buffered_ > 0) {
+        const size_t fill = sizeof(buffer_) - buffered_;
+        std::memcpy(buffer_ + buffered_, input, fill);
+        for (int lane = 0; lane < 4; ++lane) {
+            accumulators_[lane] = lane_round(accumulators_[lane], read_le64(buffer_ + lane * 8));
+        }
+        input += fill;
+        size -= fill;
+        buffered_ = 0;
+    }
+
+    while (size >= sizeof(buffer_)) {
+        for (int lane = 0; lane < 4; ++lane) {
+            accumulators_[lane] = lane_round(accumulators_[lane], read_le64(input + lane * 8));
+        }
+        input += sizeof(buffer_);
+        size -= sizeof(buffer_);
+    }
+
+    std::memcpy(buffer_, input, size);
+    buffered_ = size;
+}
+
+std::uint64_t Xxh64::digest() const {
+    std::uint64_t hash = 0;
+    if (total_ >= sizeof(buffer_)) {
+        hash = rotate_left(accumulators_[0], 1) + rotate_left(accumulators_[1], 7) +
+               rotate_left(accumulators_[2], 12) + rotate_left(accumulators_[3], 18);
+        for (const std::uint64_t accumulator : accumulators_) {
+            hash = merge_round(hash, accumulator);
+        }
+    } else {
+        hash = seed_ + kPrime5;
+    }
+    hash += total_;
+
+    const unsigned char* p = buffer_;
+    size_t remaining = buffered_;
+    while (remaining >= 8) {
+        hash ^= lane_round(0, read_le64(p));
+        hash = rotate_left(hash, 27) * kPrime1 + kPrime4;
+        p += 8;
+        remaining -= 8;
+    }
+    if (remaining >= 4) {
+        hash ^= read_le32(p) * kPrime1;
+        hash = rotate_left(hash, 23) * kPrime2 + kPrime3;
+        p += 4;
+        remaining -= 4;
+    }
+    while (remaining > 0) {
+        hash ^= *p * kPrime5;
+        hash = rotate_left(hash, 11) * kPrime1;
+        ++p;
+        --remaining;
+    }
+
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+std::uint64_t hash_bytes(const void* data, size_t size) {
+    Xxh64 hasher;
+    hasher.update(data, size);
+    return hasher.digest();
+}
+
+bool hash_file_contents(const std::filesystem::path& path, std::uint64_t& out_hash) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) return false;
+
+    Xxh64 hasher;
+    std::vector<char> block(kReadBlock);
+    while (in) {
+        in.read(block.data(), static_cast<std::streamsize>(block.size()));
+        const std::streamsize got = in.gcount();
+        if (got <= 0) break;
+        hasher.update(block.data(), static_cast<size_t>(got));
+    }
+    if (in.bad()) return false;
+
+    out_hash = hasher.digest();
+    return true;
+}
+
+std::string format_hash(std::uint64_t hash) {
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+    return buffer;
+}
+
+} // namespace exterminate
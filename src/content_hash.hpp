@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace exterminate {
+
+// Streaming XXH64. Not cryptographic; used to notice that a file changed.
+class Xxh64 {
+public:
+    explicit Xxh64(std::uint64_t seed = 0);
+
+    void update(const void* data, size_t size);
+    std::uint64_t digest() const;
+
+private:
+    std::uint64_t accumulators_[4];
+    unsigned char buffer_[32];
+    size_t buffered_ = 0;
+    std::uint64_t total_ = 0;
+    std::uint64_t seed_;
+};
+
+std::uint64_t hash_bytes(const void* data, size_t size);
+// Reads the file in 1 MiB blocks.
+bool hash_file_contents(const std::filesystem::path& path, std::uint64_t& out_hash);
+std::string format_hash(std::uint64_t hash);
+
+} // namespace exterminate
@@ -1,57 +1,83 @@
 #include "delete_engine.hpp"
 
+#include "dir_search.hpp"
+#include "io_throttle.hpp"
+#include "lock_holders.hpp"
+#include "native_delete.hpp"
 #include "paths.hpp"
+#include "progress.hpp"
+#include "startup_profile.hpp"
+#include "tombstone.hpp"
+#include "trace.hpp"
+#include "uring_delete.hpp"
 #include "windows_env.hpp"
+#include "work_pool.hpp"
 
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
 #include <filesystem>
+#include <iterator>
+#include <memory>
+#include <random>
 #include <thread>
 #include <vector>
 
+#ifndef _WIN32
+  #include <sys/stat.h>
+#endif
+
 namespace exterminate {
 
 namespace fs = std::filesystem;
 
 namespace {
 
-bool path_exists(const fs::path& path) {
+enum class TargetKind {
+    Missing,
+    File,
+    Directory,
+};
+
+// One lstat answers both "is it still there" and "is it a directory"; links
+// are reported as files so they are removed rather than followed.
+TargetKind probe_target(const fs::path& path) {
     std::error_code ec;
-    return fs::exists(path, ec) && !ec;
+    const fs::file_status status = fs::symlink_status(path, ec);
+    if (ec || !fs::exists(status)) return TargetKind::Missing;
+    return fs::is_directory(status) ? TargetKind::Directory : TargetKind::File;
 }
 
-bool path_is_directory(const fs::path& path) {
-    std::error_code ec;
-    return fs::is_directory(path, ec) && !ec;
+bool path_exists(const fs::path& path) {
+    return probe_target(path) != TargetKind::Missing;
 }
 
-void clear_attributes(const fs::path& path, bool directory) {
+#ifdef _WIN32
+int clear_attributes(const fs::path& path, bool directory) {
     if (directory) {
-        run_hidden_process("attrib.exe", {"-R", "-S", "-H", path.string(), "/S", "/D"});
-    } else {
-        run_hidden_process("attrib.exe", {"-R", "-S", "-H", path.string()});
+        return run_hidden_process("attrib.exe", {"-R", "-S", "-H", path.string(), "/S", "/D"});
     }
+    return run_hidden_process("attrib.exe", {"-R", "-S", "-H", path.string()});
 }
 
-void take_ownership(const fs::path& path, bool directory) {
+int take_ownership(const fs::path& path, bool directory) {
     if (directory) {
-        run_hidden_process("takeown.exe", {"/F", path.string(), "/A", "/R", "/D", "Y"});
-    } else {
-        run_hidden_process("takeown.exe", {"/F", path.string(), "/A", "/D", "Y"});
+        return run_hidden_process("takeown.exe", {"/F", path.string(), "/A", "/R", "/D", "Y"});
     }
+    return run_hidden_process("takeown.exe", {"/F", path.string(), "/A", "/D", "Y"});
 }
 
-void grant_admin_full_control(const fs::path& path, bool directory) {
+int grant_admin_full_control(const fs::path& path, bool directory) {
     if (directory) {
-        run_hidden_process("icacls.exe", {path.string(), "/grant", "*S-1-5-32-544:(OI)(CI)F", "/T", "/C"});
-    } else {
-        run_hidden_process("icacls.exe", {path.string(), "/grant", "*S-1-5-32-544:F", "/C"});
+        return run_hidden_process("icacls.exe", {path.string(), "/grant", "*S-1-5-32-544:(OI)(CI)F", "/T", "/C"});
     }
+    return run_hidden_process("icacls.exe", {path.string(), "/grant", "*S-1-5-32-544:F", "/C"});
 }
 
-void grant_current_user_full_control(const fs::path& path, bool directory) {
+int grant_current_user_full_control(const fs::path& path, bool directory) {
     const char* user_domain = std::getenv("USERDOMAIN");
     const char* user_name = std::getenv("USERNAME");
-    if (!user_name || !*user_name) return;
+    if (!user_name || !*user_name) return -1;
 
     std::string identity;
     if (user_domain && *user_domain) {
@@ -61,38 +87,255 @@ void grant_current_user_full_control(const fs::path& path, bool directory) {
     }
 
     if (directory) {
-        run_hidden_process("icacls.exe", {path.string(), "/grant", identity + ":(OI)(CI)F", "/T", "/C"});
-    } else {
-        run_hidden_process("icacls.exe", {path.string(), "/grant", identity + ":F", "/C"});
+        return run_hidden_process("icacls.exe", {path.string(), "/grant", identity + ":(OI)(CI)F", "/T", "/C"});
     }
+    return run_hidden_process("icacls.exe", {path.string(), "/grant", identity + ":F", "/C"});
 }
 
-void delete_with_std_filesystem(const fs::path& path, bool directory) {
+#endif
+
+// std::filesystem stops at the first error without naming the entry, so a
+// failure is reported against the whole target. Its first removal cannot be
+// observed, so the start of the call stands in for it.
+int delete_with_std_filesystem(const fs::path& path, bool directory, DeleteFailureLog* failures,
+                               NativeDeleteStats& stats) {
+    note_mutation();
     std::error_code ec;
     if (directory) {
-        fs::remove_all(path, ec);
-    } else {
-        fs::remove(path, ec);
+        const std::uintmax_t removed = fs::remove_all(path, ec);
+        if (removed != static_cast<std::uintmax_t>(-1)) stats.entries_removed += static_cast<size_t>(removed);
+    } else if (fs::remove(path, ec)) {
+        ++stats.entries_removed;
+    }
+    if (ec && failures) failures->add(DeleteFailure{path, directory, ec});
+    return ec ? 1 : 0;
+}
+
+int delete_single_file(const fs::path& path, const TreeDeleteOptions& options, NativeDeleteStats& stats) {
+    std::error_code ec;
+    std::uint64_t size = 0;
+    if (options.count_bytes || (options.throttle && options.throttle->limits_bytes())) {
+        size = fs::file_size(path, ec);
+        if (ec) size = 0;
+        ec.clear();
+    }
+    if (options.throttle) options.throttle->acquire(1, size);
+    if (delete_file_native(path, ec, options.shred)) {
+        ++stats.entries_removed;
+        stats.bytes_removed += size;
+        if (options.progress) options.progress->add_removed(1, size);
+        return 0;
+    }
+    options.failures->add(DeleteFailure{path, false, ec});
+    return 1;
+}
+
+int delete_with_parallel_engine(const fs::path& path, bool directory, WorkPool& pool,
+                                const TreeDeleteOptions& options, NativeDeleteStats& stats) {
+    if (!directory) return delete_single_file(path, options, stats);
+    const NativeDeleteStats tree = delete_tree_parallel(path, pool, options);
+    stats.entries_removed += tree.entries_removed;
+    stats.bytes_removed += tree.bytes_removed;
+    return tree.failures == 0 ? 0 : 1;
+}
+
+// Returns false when io_uring is unavailable so the caller can fall back.
+bool delete_with_uring_engine(const fs::path& path, bool directory, const TreeDeleteOptions& options,
+                              NativeDeleteStats& stats, int& out_exit_code) {
+    if (!directory) {
+        out_exit_code = delete_single_file(path, options, stats);
+        return true;
+    }
+
+    NativeDeleteStats tree;
+    if (!delete_tree_uring(path, tree, options)) return false;
+    stats.entries_removed += tree.entries_removed;
+    stats.bytes_removed += tree.bytes_removed;
+    out_exit_code = tree.failures == 0 ? 0 : 1;
+    return true;
+}
+
+// Uses the caller's pool when deleting as part of a batch; otherwise the pool
+// is only created once a stage actually needs it.
+struct EnginePool {
+    WorkPool* shared = nullptr;
+    std::unique_ptr<WorkPool> owned;
+    int threads = 0;
+
+    WorkPool& get() {
+        if (shared) return *shared;
+        if (!owned) owned = std::make_unique<WorkPool>(threads);
+        return *owned;
+    }
+};
+
+// remove_all cannot skip protected entries, so a target a protected pattern
+// can match inside goes to the parallel engine instead. Neither remove_all
+// nor a ring that queues unlinks in bulk can be paced or overwrite files
+// first, so a throttled or shredding run does the same. remove_all does not
+// report sizes either, so neither does a run that counts freed bytes.
+const char* engine_stage_name(const AppConfig& config, const PathGuard::Cursor& guard_cursor) {
+    switch (config.delete_engine) {
+        case DeleteEngine::Filesystem:
+            if (guard_cursor.empty() && !config.throttle && !config.shredder && !config.count_freed_bytes) {
+                return "filesystem";
+            }
+            break;
+        case DeleteEngine::Uring:
+            if (!config.throttle && !config.shredder && uring_delete_available()) return "uring";
+            break;
+        case DeleteEngine::Parallel:
+            break;
+    }
+    return "parallel";
+}
+
+// What was removed is added to `stats`; its failure count is left alone.
+int delete_with_engine(const fs::path& path, bool directory, const AppConfig& config,
+                       const PathGuard::Cursor& guard_cursor, EnginePool& pool, DeleteFailureLog& failures,
+                       NativeDeleteStats& stats) {
+    TreeDeleteOptions options;
+    options.failures = &failures;
+    options.throttle = config.throttle.get();
+    options.progress = config.progress.get();
+    options.count_bytes = config.count_freed_bytes;
+    options.shred = config.shredder.get();
+    if (!guard_cursor.empty()) {
+        options.guard = config.path_guard.get();
+        options.guard_cursor = guard_cursor;
+    }
+
+    switch (config.delete_engine) {
+        case DeleteEngine::Filesystem:
+            if (guard_cursor.empty() && !config.throttle && !config.shredder && !config.count_freed_bytes) {
+                return delete_with_std_filesystem(path, directory, &failures, stats);
+            }
+            break;
+        case DeleteEngine::Uring: {
+            int exit_code = 0;
+            if (!config.throttle && !config.shredder && delete_with_uring_engine(path, directory, options, stats, exit_code)) {
+                return exit_code;
+            }
+            break;
+        }
+        case DeleteEngine::Parallel:
+            break;
+    }
+
+    return delete_with_parallel_engine(path, directory, pool.get(), options, stats);
+}
+
+// The parent is resolved through links, so a link above the target cannot
+// hide a protected directory; a link as the target itself is only unlinked.
+fs::path guarded_path(const fs::path& target_path) {
+    std::error_code ec;
+    fs::path path = fs::absolute(target_path, ec);
+    if (ec) path = target_path;
+    path = path.lexically_normal();
+    if (!path.has_filename() && path.has_relative_path()) path = path.parent_path();
+    if (!path.has_relative_path()) return path;
+
+    const fs::path parent = fs::weakly_canonical(path.parent_path(), ec);
+    if (ec) return path;
+    return parent / path.filename();
+}
+
+bool check_guard(const fs::path& target_path, const AppConfig& config, PathGuard::Cursor& out_inside,
+                 std::string& out_message) {
+    out_inside.clear();
+    if (!config.path_guard) return true;
+
+    std::string reason;
+    if (config.path_guard->allows(guarded_path(target_path), out_inside, reason)) return true;
+    out_message = "Refused: " + target_path.string() + " " + reason;
+    return false;
+}
+
+// Walks the guard from the target down to an entry inside it. False when the
+// entry itself is protected.
+bool guard_cursor_inside(const AppConfig& config, const fs::path& target_path, const PathGuard::Cursor& target_cursor,
+                         const fs::path& entry_path, PathGuard::Cursor& out_cursor) {
+    out_cursor = target_cursor;
+    if (out_cursor.empty() || entry_path == target_path) return true;
+
+    PathGuard::Cursor next;
+    for (const auto& component : entry_path.lexically_relative(target_path)) {
+        if (out_cursor.empty()) break;
+        if (config.path_guard->protects(out_cursor, component.native(), &next)) return false;
+        out_cursor.swap(next);
     }
+    return true;
 }
 
-void delete_with_cmd(const fs::path& path, bool directory) {
+// What one target's result reports about its stages, filled in as they run.
+// Repairs and retry waits are timed but are never the stage that deleted.
+struct StageLog {
+    std::vector<StageTiming> stages;
+    const char* last_removal = nullptr;
+    NativeDeleteStats removed;
+    int attempts = 0;
+    std::vector<LockHolder> ended_holders;
+
+    void record(const char* name, std::chrono::steady_clock::duration duration, bool removal) {
+        auto it = std::find_if(stages.begin(), stages.end(),
+                               [&](const StageTiming& timing) { return timing.stage == name; });
+        if (it == stages.end()) it = stages.insert(stages.end(), StageTiming{name, 0, {}});
+        ++it->runs;
+        it->duration += std::chrono::duration_cast<std::chrono::nanoseconds>(duration);
+        if (removal) last_removal = name;
+    }
+};
+
+// Times each stage of one attempt into the log, and records it as a span
+// when a recorder is attached. Only spans pay for the extra existence check.
+struct StageTracer {
+    TraceRecorder* trace = nullptr;
+    const fs::path& target;
+    int attempt = 0;
+    StageLog* log = nullptr;
+
+    template <typename Stage>
+    void run(const char* name, Stage&& stage, bool removal = true) const {
+        if (!trace && !log) {
+            stage();
+            return;
+        }
+
+        StageSpan span;
+        span.start = std::chrono::steady_clock::now();
+        span.exit_code = stage();
+        span.duration = std::chrono::steady_clock::now() - span.start;
+        if (log) log->record(name, span.duration, removal);
+        if (!trace) return;
+
+        span.stage = name;
+        span.target = target.string();
+        span.attempt = attempt;
+        span.thread = TraceRecorder::current_thread();
+        span.target_exists = path_exists(target);
+        trace->record(std::move(span));
+    }
+};
+
+#ifdef _WIN32
+int delete_with_cmd(const fs::path& path, bool directory) {
     const std::string verbatim = to_verbatim_path(path);
     if (directory) {
-        run_hidden_process("cmd.exe", {"/d", "/c", "rd /s /q \"" + verbatim + "\""});
-    } else {
-        run_hidden_process("cmd.exe", {"/d", "/c", "del /f /q \"" + verbatim + "\""});
+        return run_hidden_process("cmd.exe", {"/d", "/c", "rd /s /q \"" + verbatim + "\""});
     }
+    return run_hidden_process("cmd.exe", {"/d", "/c", "del /f /q \"" + verbatim + "\""});
 }
 
-void delete_with_robocopy(const fs::path& path) {
+// Reports robocopy's own exit code; the cleanup passes after it are part of
+// the same stage.
+int delete_with_robocopy(const fs::path& path) {
     const auto tick = std::chrono::steady_clock::now().time_since_epoch().count();
     const fs::path temp = fs::temp_directory_path() / ("exterminate-empty-" + std::to_string(tick));
     std::error_code ec;
     fs::create_directories(temp, ec);
-    if (ec) return;
+    if (ec) return -1;
 
-    run_hidden_process("robocopy.exe", {
+    const int exit_code = run_hidden_process("robocopy.exe", {
         temp.string(),
         path.string(),
         "/MIR",
@@ -106,72 +349,663 @@ void delete_with_robocopy(const fs::path& path) {
     });
 
     delete_with_cmd(path, true);
-    delete_with_std_filesystem(path, true);
+    NativeDeleteStats removed;
+    delete_with_std_filesystem(path, true, nullptr, removed);
 
     fs::remove_all(temp, ec);
+    return exit_code;
 }
 
-void delete_with_wsl(const fs::path& path) {
-    if (!command_exists_on_path("wsl.exe")) return;
+int delete_with_wsl(const fs::path& path) {
+    if (!command_exists_on_path("wsl.exe")) return -1;
     std::string wsl_path;
-    if (!try_to_wsl_path(path, wsl_path)) return;
-    run_hidden_process("wsl.exe", {"--exec", "rm", "-rf", "--", wsl_path});
+    if (!try_to_wsl_path(path, wsl_path)) return -1;
+    return run_hidden_process("wsl.exe", {"--exec", "rm", "-rf", "--", wsl_path});
+}
+#endif
+
+bool is_within(const fs::path& path, const fs::path& directory) {
+    auto it = path.begin();
+    for (const auto& part : directory) {
+        if (part.empty()) continue;
+        if (it == path.end() || *it != part) return false;
+        ++it;
+    }
+    return true;
 }
 
-} // namespace
+// Keeps only the refused entries that lie inside the target, dropping any
+// entry already covered by a refused directory above it.
+std::vector<DeleteFailure> access_denied_entries(std::vector<DeleteFailure> failures, const fs::path& target_path) {
+    std::vector<DeleteFailure> denied;
+    for (auto& failure : failures) {
+        if (is_access_denied(failure.error) && is_within(failure.path, target_path)) {
+            denied.push_back(std::move(failure));
+        }
+    }
+
+    std::sort(denied.begin(), denied.end(),
+              [](const DeleteFailure& a, const DeleteFailure& b) { return a.path < b.path; });
 
-DeleteResult delete_target(const fs::path& target_path, const AppConfig& config) {
+    std::vector<DeleteFailure> out;
+    for (auto& failure : denied) {
+        const bool covered = std::any_of(out.begin(), out.end(), [&](const DeleteFailure& kept) {
+            return kept.directory && is_within(failure.path, kept.path);
+        });
+        if (!covered) out.push_back(std::move(failure));
+    }
+    return out;
+}
+
+#ifdef _WIN32
+// Past this many entries one recursive repair or fallback over the whole
+// target costs fewer child processes than one per entry.
+constexpr size_t kMaxRepairEntries = 16;
+
+void repair_entry(const fs::path& path, bool directory, const AppConfig& config, const StageTracer& tracer) {
+    tracer.run("attrib", [&] { return clear_attributes(path, directory); }, false);
+
+    if (config.force_take_ownership) {
+        tracer.run("takeown", [&] { return take_ownership(path, directory); }, false);
+    }
+
+    if (config.grant_administrators_full_control) {
+        tracer.run("icacls-admins", [&] { return grant_admin_full_control(path, directory); }, false);
+    }
+
+    if (config.grant_current_user_full_control) {
+        tracer.run("icacls-user", [&] { return grant_current_user_full_control(path, directory); }, false);
+    }
+}
+
+// The tools report no sizes, so once one has run the bytes freed are only a
+// lower bound.
+void run_external_fallbacks(const fs::path& path, bool directory, const AppConfig& config,
+                            const StageTracer& tracer, NativeDeleteStats& removed) {
+    if (path_exists(path)) {
+        removed.bytes_unknown = true;
+        tracer.run("cmd", [&] { return delete_with_cmd(path, directory); });
+    }
+
+    if (config.use_robocopy_mirror_fallback && directory && path_exists(path)) {
+        tracer.run("robocopy", [&] { return delete_with_robocopy(path); });
+    }
+
+    if (config.use_wsl_fallback_if_available && path_exists(path)) {
+        tracer.run("wsl", [&] { return delete_with_wsl(path); });
+    }
+}
+
+void repair_access(const std::vector<DeleteFailure>& denied, const fs::path& target_path, bool directory,
+                   const AppConfig& config, const StageTracer& tracer) {
+    if (denied.size() > kMaxRepairEntries) {
+        repair_entry(target_path, directory, config, tracer);
+        return;
+    }
+
+    for (const auto& entry : denied) {
+        const StageTracer entry_tracer{tracer.trace, entry.path, tracer.attempt, tracer.log};
+        repair_entry(entry.path, entry.directory, config, entry_tracer);
+    }
+}
+#else
+// Removing an entry needs write and search permission on its directory, and
+// emptying a directory needs read permission on it as well.
+bool grant_owner_access(const fs::path& directory) {
+    struct stat info {};
+    if (::lstat(directory.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)) return false;
+    if ((info.st_mode & S_IRWXU) == S_IRWXU) return true;
+    return ::chmod(directory.c_str(), (info.st_mode | S_IRWXU) & 07777) == 0;
+}
+
+void repair_access(const std::vector<DeleteFailure>& denied, const fs::path& target_path, bool,
+                   const AppConfig&, const StageTracer& tracer) {
+    tracer.run("chmod", [&] {
+        bool repaired = true;
+        for (const auto& entry : denied) {
+            const fs::path parent = entry.path.parent_path();
+            if (is_within(parent, target_path)) repaired = grant_owner_access(parent) && repaired;
+            if (entry.directory) repaired = grant_owner_access(entry.path) && repaired;
+        }
+        return repaired ? 0 : 1;
+    }, false);
+}
+#endif
+
+// How long an ended holder gets to exit before the entry is retried anyway.
+constexpr std::chrono::milliseconds kHolderExitTimeout{5000};
+
+// Looks up the processes holding open the survivors that failed for that
+// reason and, with --kill-holders, ends them. Returns each survivor's
+// holders; `released` is set for those whose holders were all ended.
+std::vector<std::vector<LockHolder>> resolve_holders(const std::vector<DeleteFailure>& survivors,
+                                                     const AppConfig& config, WorkPool& pool,
+                                                     const StageTracer& tracer, StageLog& log,
+                                                     std::vector<bool>& released) {
+    std::vector<std::vector<LockHolder>> holders(survivors.size());
+    released.assign(survivors.size(), false);
+
+    std::vector<fs::path> held_paths;
+    std::vector<size_t> held_index;
+    for (size_t i = 0; i < survivors.size(); ++i) {
+        if (!is_held_open(survivors[i].error)) continue;
+        held_paths.push_back(survivors[i].path);
+        held_index.push_back(i);
+    }
+    if (held_paths.empty()) return holders;
+
+    std::vector<std::vector<LockHolder>> found;
+    tracer.run("find-holders", [&] {
+        found = find_lock_holders(held_paths, pool);
+        return 0;
+    }, false);
+    for (size_t i = 0; i < held_index.size(); ++i) {
+        holders[held_index[i]] = std::move(found[i]);
+    }
+    if (!config.kill_lock_holders) return holders;
+
+    tracer.run("kill-holders", [&] {
+        int exit_code = 0;
+        for (size_t i = 0; i < holders.size(); ++i) {
+            if (holders[i].empty()) continue;
+            bool all_ended = true;
+            for (const auto& holder : holders[i]) {
+                const bool already = std::any_of(log.ended_holders.begin(), log.ended_holders.end(),
+                                                 [&](const LockHolder& ended) { return ended.pid == holder.pid; });
+                if (already) continue;
+                std::error_code ec;
+                if (end_lock_holder(holder, kHolderExitTimeout, ec)) {
+                    log.ended_holders.push_back(holder);
+                } else {
+                    all_ended = false;
+                    exit_code = 1;
+                }
+            }
+            released[i] = all_ended;
+        }
+        return exit_code;
+    }, false);
+    return holders;
+}
+
+// An entry that survived a pass, retried on its own once `due` passes.
+struct ResidualEntry {
+    fs::path path;
+    int tries = 0;
+    std::chrono::steady_clock::time_point due;
+};
+
+// Doubles per try up to 8x the configured delay. The jitter keeps entries
+// that failed together from being retried in lockstep.
+std::chrono::milliseconds backoff_delay(int retry_delay_ms, int tries) {
+    if (retry_delay_ms <= 0) return std::chrono::milliseconds(0);
+    const int shift = std::min(std::max(tries - 1, 0), 3);
+    const long long ceiling = static_cast<long long>(retry_delay_ms) << shift;
+
+    thread_local std::minstd_rand random(std::random_device{}());
+    std::uniform_int_distribution<long long> jitter(ceiling / 2, ceiling);
+    return std::chrono::milliseconds(jitter(random));
+}
+
+// One pass over one entry: engine, repair of refused entries plus a second
+// engine pass, then the external fallbacks. Returns what the last engine
+// pass could not remove; what the log had no room for is counted in
+// `dropped`.
+std::vector<DeleteFailure> delete_pass(const fs::path& path, bool directory, const AppConfig& config,
+                                       const PathGuard::Cursor& guard_cursor, EnginePool& pool,
+                                       const StageTracer& tracer, bool run_fallbacks, NativeDeleteStats& removed,
+                                       std::vector<FailureClass>& dropped) {
+    DeleteFailureLog failures;
+    const char* stage = engine_stage_name(config, guard_cursor);
+    tracer.run(stage, [&] {
+        return delete_with_engine(path, directory, config, guard_cursor, pool, failures, removed);
+    });
+    std::vector<DeleteFailure> remaining = failures.take();
+    dropped = failures.take_dropped();
+
+    if (!remaining.empty() && path_exists(path)) {
+        const std::vector<DeleteFailure> denied = access_denied_entries(remaining, path);
+        if (!denied.empty()) {
+            repair_access(denied, path, directory, config, tracer);
+            tracer.run(stage, [&] {
+                return delete_with_engine(path, directory, config, guard_cursor, pool, failures, removed);
+            });
+            remaining = failures.take();
+            dropped = failures.take_dropped();
+        }
+    }
+
+    // The external tools would remove protected entries along with the rest,
+    // at full rate and without overwriting files.
+#ifdef _WIN32
+    if (run_fallbacks && guard_cursor.empty() && !config.throttle && !config.shredder) {
+        run_external_fallbacks(path, directory, config, tracer, removed);
+    }
+#else
+    (void)run_fallbacks;
+#endif
+    return remaining;
+}
+
+DeleteResult run_stages(const fs::path& target_path, const AppConfig& config, WorkPool* shared_pool,
+                        TraceRecorder* trace, StageLog& log) {
     if (!path_exists(target_path)) {
         return DeleteResult{true, true, "Already gone: " + target_path.string()};
     }
 
+    PathGuard::Cursor guard_cursor;
+    std::string refusal;
+    if (!check_guard(target_path, config, guard_cursor, refusal)) return DeleteResult{false, false, refusal};
+
     int retries = config.retries;
     if (retries < 0) retries = 0;
     int retry_delay_ms = config.retry_delay_ms;
     if (retry_delay_ms < 0) retry_delay_ms = 0;
 
-    for (int attempt = 0; attempt <= retries; ++attempt) {
-        if (!path_exists(target_path)) break;
-
-        const bool directory = path_is_directory(target_path);
+    // The sweeper would delete the whole tombstone, protected entries included,
+    // at full rate and without overwriting anything.
+    if (config.tombstone_delete && guard_cursor.empty() && !config.throttle && !config.shredder) {
+        bool moved = false;
+        log.attempts = 1;
+        const StageTracer tracer{trace, target_path, 0, &log};
+        tracer.run("tombstone", [&] {
+            std::error_code ec;
+            moved = move_to_tombstone(target_path, ec);
+            return moved ? 0 : 1;
+        });
+        if (moved) {
+            return DeleteResult{true, false,
+                                "Deleted: " + target_path.string() + " (space is reclaimed in the background)"};
+        }
+    }
 
-        clear_attributes(target_path, directory);
+    EnginePool pool;
+    pool.shared = shared_pool;
+    pool.threads = resolve_worker_threads(config.worker_threads);
+
+    // Only what survived is retried, each entry on its own backoff. Once no
+    // survivor is left, the target is passed over once more to remove the
+    // directories that were kept alive by them. Protected entries are kept
+    // rather than retried, so that pass is only made once after one was met.
+    std::vector<ResidualEntry> pending{ResidualEntry{target_path, 0, std::chrono::steady_clock::now()}};
+    std::vector<FailedEntry> left_behind;
+    std::vector<FailureClass> left_behind_classes;
+    int highest_tries = 0;
+    bool gave_up = false;
+    bool kept_protected = false;
+    bool swept = false;
+
+    for (;;) {
+        if (pending.empty()) {
+            if (!path_exists(target_path)) break;
+            if (gave_up || swept) break;
+            swept = kept_protected;
+            pending.push_back(ResidualEntry{target_path, highest_tries, std::chrono::steady_clock::now()});
+        }
 
-        if (config.force_take_ownership) {
-            take_ownership(target_path, directory);
+        const auto earliest = std::min_element(pending.begin(), pending.end(),
+                                               [](const ResidualEntry& a, const ResidualEntry& b) {
+                                                   return a.due < b.due;
+                                               });
+        const auto now = std::chrono::steady_clock::now();
+        if (earliest->due > now) {
+            const StageTracer tracer{trace, target_path, earliest->tries, &log};
+            const auto wait = earliest->due - now;
+            tracer.run("retry-wait", [&] {
+                std::this_thread::sleep_for(wait);
+                return 0;
+            }, false);
         }
 
-        if (config.grant_administrators_full_control) {
-            grant_admin_full_control(target_path, directory);
+        const auto ready_until = std::chrono::steady_clock::now();
+        const auto split = std::partition(pending.begin(), pending.end(),
+                                          [&](const ResidualEntry& entry) { return entry.due > ready_until; });
+        std::vector<ResidualEntry> due(std::make_move_iterator(split), std::make_move_iterator(pending.end()));
+        pending.erase(split, pending.end());
+
+#ifdef _WIN32
+        const bool per_entry_fallbacks = due.size() <= kMaxRepairEntries;
+#else
+        const bool per_entry_fallbacks = true;
+#endif
+
+        for (const auto& entry : due) {
+            const TargetKind kind = probe_target(entry.path);
+            if (kind == TargetKind::Missing) continue;
+
+            PathGuard::Cursor entry_cursor;
+            if (!guard_cursor_inside(config, target_path, guard_cursor, entry.path, entry_cursor)) {
+                kept_protected = true;
+                continue;
+            }
+
+            const bool directory = kind == TargetKind::Directory;
+            log.attempts = std::max(log.attempts, entry.tries + 1);
+            const StageTracer tracer{trace, entry.path, entry.tries, &log};
+            std::vector<FailureClass> dropped;
+            std::vector<DeleteFailure> survivors = delete_pass(entry.path, directory, config, entry_cursor, pool,
+                                                               tracer, per_entry_fallbacks, log.removed, dropped);
+
+            const auto kept = std::remove_if(survivors.begin(), survivors.end(), [](const DeleteFailure& failure) {
+                return is_protected_entry(failure.error);
+            });
+            const bool kept_here = kept != survivors.end();
+            kept_protected = kept_protected || kept_here;
+            survivors.erase(kept, survivors.end());
+
+            survivors.erase(std::remove_if(survivors.begin(), survivors.end(),
+                                           [](const DeleteFailure& failure) { return !path_exists(failure.path); }),
+                            survivors.end());
+            if (survivors.empty() && !kept_here && path_exists(entry.path)) {
+                survivors.push_back(DeleteFailure{entry.path, directory, std::error_code()});
+            }
+
+            // Entries the log had no room for are not retried on their own;
+            // on the last try they are only counted.
+            if (entry.tries >= retries) {
+                for (const auto& dropped_class : dropped) {
+                    count_failure_class(left_behind_classes, dropped_class.error, dropped_class.count);
+                }
+            }
+
+            // Scanners and indexers let go of a file quickly, so an entry held
+            // open gets one retry before its holders are looked up. Waiting
+            // longer will not make any other holder let go: unless
+            // --kill-holders ended them, the entry is given up right away.
+            std::vector<bool> released(survivors.size(), false);
+            std::vector<std::vector<LockHolder>> holders(survivors.size());
+            if (entry.tries >= 1 || entry.tries >= retries) {
+                holders = resolve_holders(survivors, config, pool.get(), tracer, log, released);
+            }
+
+            for (size_t i = 0; i < survivors.size(); ++i) {
+                DeleteFailure& survivor = survivors[i];
+                const bool held = !holders[i].empty();
+                if (entry.tries >= retries || (held && !released[i])) {
+                    gave_up = true;
+                    count_failure_class(left_behind_classes, survivor.error);
+                    if (left_behind.size() < kMaxReportedFailures) {
+                        left_behind.push_back(FailedEntry{std::move(survivor.path), survivor.directory, survivor.error,
+                                                          log.last_removal ? log.last_removal : "",
+                                                          std::move(holders[i])});
+                    }
+                    continue;
+                }
+                const int tries = entry.tries + 1;
+                highest_tries = std::max(highest_tries, tries);
+                const auto delay = released[i] ? std::chrono::milliseconds(0) : backoff_delay(retry_delay_ms, tries);
+                pending.push_back(ResidualEntry{std::move(survivor.path), tries, std::chrono::steady_clock::now() + delay});
+            }
         }
 
-        if (config.grant_current_user_full_control) {
-            grant_current_user_full_control(target_path, directory);
+#ifdef _WIN32
+        if (!per_entry_fallbacks && guard_cursor.empty() && !config.throttle && !config.shredder &&
+            path_exists(target_path)) {
+            run_external_fallbacks(target_path, true, config, StageTracer{trace, target_path, highest_tries, &log},
+                                   log.removed);
         }
+#endif
+    }
+
+    if (!path_exists(target_path)) {
+        return DeleteResult{true, false, "Deleted: " + target_path.string()};
+    }
+    if (kept_protected && !gave_up) {
+        return DeleteResult{true, false, "Deleted: " + target_path.string() + " (protected entries inside were kept)"};
+    }
+    std::sort(left_behind.begin(), left_behind.end(),
+              [](const FailedEntry& a, const FailedEntry& b) { return a.path < b.path; });
+    DeleteResult result{false, false, "Failed to delete: " + target_path.string()};
+    result.failures = std::move(left_behind);
+    result.failure_classes = std::move(left_behind_classes);
+    return result;
+}
+
+void fill_result(DeleteResult& result, const fs::path& target_path, StageLog& log,
+                 std::chrono::steady_clock::time_point started) {
+    result.target = target_path;
+    result.entries_removed = log.removed.entries_removed;
+    result.bytes_freed = log.removed.bytes_removed;
+    result.bytes_known = !log.removed.bytes_unknown;
+    result.attempts = log.attempts;
+    if (result.success && !result.already_gone && log.last_removal) result.final_stage = log.last_removal;
+    result.stages = std::move(log.stages);
+    result.ended_holders = std::move(log.ended_holders);
+    result.duration = std::chrono::steady_clock::now() - started;
+}
+
+DeleteResult run_delete(const fs::path& target_path, const AppConfig& config, WorkPool* shared_pool,
+                        TraceRecorder* trace) {
+    const auto started = std::chrono::steady_clock::now();
+    StageLog log;
+    DeleteResult result = run_stages(target_path, config, shared_pool, trace, log);
+    fill_result(result, target_path, log, started);
+    return result;
+}
+
+// A match that survived the fused pass, with what that pass did so its
+// final result covers both.
+struct SurvivingMatch {
+    fs::path path;
+    DeleteResult first_pass;
+};
 
-        delete_with_std_filesystem(target_path, directory);
-        if (path_exists(target_path)) {
-            delete_with_cmd(target_path, directory);
+} // namespace
+
+bool target_allowed(const fs::path& target_path, const AppConfig& config, std::string& out_message) {
+    PathGuard::Cursor inside;
+    return check_guard(target_path, config, inside, out_message);
+}
+
+std::string describe_failure_error(const std::error_code& error) {
+    return error ? error.message() : "still present";
+}
+
+DeleteResult delete_target(const fs::path& target_path, const AppConfig& config, TraceRecorder* trace) {
+    return run_delete(target_path, config, nullptr, trace);
+}
+
+DeleteResult delete_target(const fs::path& target_path, const AppConfig& config, WorkPool& pool,
+                           TraceRecorder* trace) {
+    return run_delete(target_path, config, &pool, trace);
+}
+
+std::vector<DeleteResult> delete_targets(const std::vector<fs::path>& target_paths, const AppConfig& config,
+                                         TraceRecorder* trace) {
+    std::vector<DeleteResult> results(target_paths.size());
+    if (target_paths.size() == 1) {
+        results[0] = delete_target(target_paths[0], config, trace);
+        return results;
+    }
+
+    DeleteBatch batch(config, [&](size_t index, const DeleteResult& result) { results[index] = result; }, trace);
+    for (const auto& target_path : target_paths) {
+        batch.add_target(target_path);
+    }
+    batch.finish();
+    return results;
+}
+
+DeleteBatch::DeleteBatch(const AppConfig& config, ResultSink sink, TraceRecorder* trace)
+    : config_(config),
+      sink_(std::move(sink)),
+      trace_(trace),
+      owned_pool_(std::make_unique<WorkPool>(resolve_worker_threads(config.worker_threads))),
+      pool_(*owned_pool_) {
+    max_in_flight_ = static_cast<size_t>(pool_.thread_count()) * 4;
+}
+
+DeleteBatch::DeleteBatch(const AppConfig& config, WorkPool& pool, ResultSink sink, TraceRecorder* trace)
+    : config_(config), sink_(std::move(sink)), trace_(trace), pool_(pool) {
+    max_in_flight_ = static_cast<size_t>(pool_.thread_count()) * 4;
+}
+
+DeleteBatch::~DeleteBatch() {
+    finish();
+}
+
+void DeleteBatch::add_target(fs::path target_path) {
+    std::string label = target_path.u8string();
+    fs::path target = target_path;
+    enqueue(std::move(label), std::move(target), [this, target_path = std::move(target_path)] {
+        return delete_target(target_path, config_, pool_, trace_);
+    });
+}
+
+void DeleteBatch::add_input(std::string input) {
+    std::string label = input;
+    enqueue(std::move(label), fs::path(), [this, input = std::move(input)] {
+        return delete_target(resolve_target_path(input), config_, pool_, trace_);
+    });
+}
+
+void DeleteBatch::enqueue(std::string label, fs::path target, std::function<DeleteResult()> job) {
+    size_t index = 0;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        slot_cv_.wait(lock, [this] { return in_flight_ < max_in_flight_; });
+        ++in_flight_;
+        index = next_index_++;
+    }
+
+    // A job that throws (out of memory, a name the narrow encoding cannot
+    // hold) still reports, so its slot and whoever waits on its result are
+    // released.
+    pool_.submit(group_, [this, index, label = std::move(label), target = std::move(target), job = std::move(job)] {
+        DeleteResult result;
+        try {
+            result = job();
+        } catch (const std::exception& error) {
+            result = DeleteResult{false, false, "Failed to delete: " + label + " (" + error.what() + ")"};
+            result.target = target;
+        } catch (...) {
+            result = DeleteResult{false, false, "Failed to delete: " + label + " (unexpected error)"};
+            result.target = target;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            sink_(index, result);
+            --in_flight_;
         }
+        slot_cv_.notify_one();
+    });
+}
 
-        if (config.use_robocopy_mirror_fallback && directory && path_exists(target_path)) {
-            delete_with_robocopy(target_path);
+void DeleteBatch::finish() {
+    pool_.wait(group_);
+}
+
+FoundDirsStats delete_found_dirs(const std::vector<fs::path>& roots, const std::vector<NativeName>& names,
+                                 const AppConfig& config, const FoundDirSink& sink,
+                                 DeleteFailureLog* search_failures) {
+    WorkPool pool(resolve_worker_threads(config.worker_threads));
+    std::mutex mutex;
+    std::vector<SurvivingMatch> survivors;
+    const auto report = [&](const fs::path& match, const DeleteResult& result) {
+        std::lock_guard<std::mutex> lock(mutex);
+        sink(match, result);
+    };
+
+    // Each match gets one engine pass on the search's own pool. The first
+    // failure is far more likely to be a lock or a permission than a race, so
+    // repair and retries are left to the full pipeline below.
+    const auto delete_match = [&](const fs::path& match, const PathGuard::Cursor& cursor) {
+        const auto started = std::chrono::steady_clock::now();
+        StageLog log;
+        const auto finish = [&](DeleteResult result) {
+            fill_result(result, match, log, started);
+            report(match, result);
+        };
+
+        const PathGuard* guard = config.path_guard.get();
+        if (guard && guard->above_protected(cursor)) {
+            PathGuard::Cursor inside;
+            std::string refusal;
+            if (!check_guard(match, config, inside, refusal)) {
+                finish(DeleteResult{false, false, refusal});
+                return;
+            }
         }
 
-        if (config.use_wsl_fallback_if_available && path_exists(target_path)) {
-            delete_with_wsl(target_path);
+        log.attempts = 1;
+        const StageTracer tracer{nullptr, match, 0, &log};
+        if (config.tombstone_delete && cursor.empty() && !config.throttle && !config.shredder) {
+            bool moved = false;
+            tracer.run("tombstone", [&] {
+                std::error_code ec;
+                moved = move_to_tombstone(match, ec);
+                return moved ? 0 : 1;
+            });
+            if (moved) {
+                finish(DeleteResult{true, false, "Deleted: " + match.string() + " (space is reclaimed in the background)"});
+                return;
+            }
         }
 
-        if (!path_exists(target_path)) {
-            return DeleteResult{true, false, "Deleted: " + target_path.string()};
+        EnginePool engine_pool;
+        engine_pool.shared = &pool;
+        DeleteFailureLog failures;
+        tracer.run(engine_stage_name(config, cursor), [&] {
+            return delete_with_engine(match, true, config, cursor, engine_pool, failures, log.removed);
+        });
+        if (!path_exists(match)) {
+            finish(DeleteResult{true, false, "Deleted: " + match.string()});
+            return;
         }
 
-        if (attempt < retries) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(retry_delay_ms));
+        DeleteResult first_pass;
+        fill_result(first_pass, match, log, started);
+        std::lock_guard<std::mutex> lock(mutex);
+        survivors.push_back(SurvivingMatch{match, std::move(first_pass)});
+    };
+
+    DirSearchOptions options;
+    options.names = names;
+    options.guard = config.path_guard.get();
+    options.failures = search_failures;
+
+    // Roots are searched side by side too; each search task waits on its own
+    // walk while running the pool's other work.
+    FoundDirsStats stats;
+    TaskGroup group;
+    for (const auto& root : roots) {
+        pool.submit(group, [&, root] {
+            const DirSearchStats searched = search_dirs(root, options, pool, delete_match);
+            std::lock_guard<std::mutex> lock(mutex);
+            stats.directories_searched += searched.directories_searched;
+            stats.matches += searched.matches;
+            stats.search_failures += searched.failures;
+        });
+    }
+    pool.wait(group);
+
+    if (!survivors.empty()) {
+        DeleteBatch batch(config, pool, [&](size_t index, const DeleteResult& result) {
+            const DeleteResult& first = survivors[index].first_pass;
+            DeleteResult merged = result;
+            merged.entries_removed += first.entries_removed;
+            merged.bytes_freed += first.bytes_freed;
+            merged.bytes_known = merged.bytes_known && first.bytes_known;
+            merged.attempts += first.attempts;
+            merged.duration += first.duration;
+            for (auto it = first.stages.rbegin(); it != first.stages.rend(); ++it) {
+                const auto same = std::find_if(merged.stages.begin(), merged.stages.end(),
+                                               [&](const StageTiming& timing) { return timing.stage == it->stage; });
+                if (same == merged.stages.end()) {
+                    merged.stages.insert(merged.stages.begin(), *it);
+                } else {
+                    same->runs += it->runs;
+                    same->duration += it->duration;
+                }
+            }
+            report(survivors[index].path, merged);
+        });
+        for (const auto& survivor : survivors) {
+            batch.add_target(survivor.path);
         }
+        batch.finish();
     }
-
-    return DeleteResult{false, false, "Failed to delete: " + target_path.string()};
+    return stats;
 }
 
 } // namespace exterminate
@@ -1,18 +1,151 @@
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
 
 #include "config.hpp"
+#include "dir_handle.hpp"
+#include "lock_holders.hpp"
+#include "native_delete.hpp"
+#include "trace.hpp"
+#include "work_pool.hpp"
 
 namespace exterminate {
 
+// A stage that ran one or more times for one target, e.g. "parallel",
+// "chmod" or "retry-wait", with its total time.
+struct StageTiming {
+    std::string stage;
+    int runs = 0;
+    std::chrono::nanoseconds duration{};
+};
+
+// An entry still there when delete_target gave up. `error` is what its last
+// engine pass got (empty when the pass reported none) and `stage` the last
+// removing stage tried on it. `holders` is only looked up for entries
+// another process has open.
+struct FailedEntry {
+    std::filesystem::path path;
+    bool directory = false;
+    std::error_code error;
+    std::string stage;
+    std::vector<LockHolder> holders;
+};
+
+// At most this many entries are listed per target; the rest are counted.
+constexpr size_t kMaxReportedFailures = 64;
+
+// The statistics are filled in by delete_target; results relayed by the
+// resident service only carry the first three fields.
 struct DeleteResult {
+    DeleteResult() = default;
+    DeleteResult(bool succeeded, bool was_gone, std::string text)
+        : success(succeeded), already_gone(was_gone), message(std::move(text)) {}
+
     bool success = false;
     bool already_gone = false;
     std::string message;
+    std::filesystem::path target;
+    size_t entries_removed = 0;
+    // Sizes of the files removed, as far as the engine knew them; see
+    // AppConfig::count_freed_bytes. `bytes_known` is false when an external
+    // tool removed part of the target, so the sum is short by an unknown
+    // amount.
+    std::uint64_t bytes_freed = 0;
+    bool bytes_known = true;
+    // Passes over the entry that needed the most, 0 when nothing was tried.
+    int attempts = 0;
+    // The last removing stage before the target was gone; empty unless it
+    // was deleted.
+    std::string final_stage;
+    std::vector<StageTiming> stages;
+    std::chrono::nanoseconds duration{};
+    // Only set when the target was not deleted: the entries left behind, and
+    // all of them, listed or not, counted by error.
+    std::vector<FailedEntry> failures;
+    std::vector<FailureClass> failure_classes;
+    // Processes --kill-holders ended, whatever the outcome.
+    std::vector<LockHolder> ended_holders;
+};
+
+// The error's message, or "still present" for an entry that survived
+// without one.
+std::string describe_failure_error(const std::error_code& error);
+
+// False when the config's protected paths cover the target or something
+// deleting it would remove; out_message then says which pattern.
+bool target_allowed(const std::filesystem::path& target_path, const AppConfig& config, std::string& out_message);
+
+// When `trace` is set, every stage of every attempt is recorded as a span.
+DeleteResult delete_target(const std::filesystem::path& target_path, const AppConfig& config,
+                           TraceRecorder* trace = nullptr);
+DeleteResult delete_target(const std::filesystem::path& target_path, const AppConfig& config, WorkPool& pool,
+                           TraceRecorder* trace = nullptr);
+std::vector<DeleteResult> delete_targets(const std::vector<std::filesystem::path>& target_paths,
+                                         const AppConfig& config, TraceRecorder* trace = nullptr);
+
+// Streams targets onto a shared pool with a bounded number in flight, so a
+// producer can keep adding while earlier targets are being deleted. Results
+// are reported through the sink (serialized) in completion order. add_* must
+// be called from a thread outside the pool.
+class DeleteBatch {
+public:
+    using ResultSink = std::function<void(size_t index, const DeleteResult& result)>;
+
+    DeleteBatch(const AppConfig& config, ResultSink sink, TraceRecorder* trace = nullptr);
+    // Runs on a pool that outlives the batch instead of starting its own.
+    DeleteBatch(const AppConfig& config, WorkPool& pool, ResultSink sink, TraceRecorder* trace = nullptr);
+    ~DeleteBatch();
+
+    DeleteBatch(const DeleteBatch&) = delete;
+    DeleteBatch& operator=(const DeleteBatch&) = delete;
+
+    void add_target(std::filesystem::path target_path);
+    void add_input(std::string input);
+    void finish();
+
+private:
+    // `label` names the target in the failed result of a job that throws.
+    void enqueue(std::string label, std::filesystem::path target, std::function<DeleteResult()> job);
+
+    const AppConfig& config_;
+    ResultSink sink_;
+    TraceRecorder* trace_;
+    std::unique_ptr<WorkPool> owned_pool_;
+    WorkPool& pool_;
+    TaskGroup group_;
+    std::mutex mutex_;
+    std::condition_variable slot_cv_;
+    size_t in_flight_ = 0;
+    size_t max_in_flight_ = 0;
+    size_t next_index_ = 0;
+};
+
+struct FoundDirsStats {
+    size_t directories_searched = 0;
+    size_t matches = 0;
+    size_t search_failures = 0;
 };
 
-DeleteResult delete_target(const std::filesystem::path& target_path, const AppConfig& config);
+// Finds every directory named one of `names` (folded with fold_name_case)
+// below each root and deletes it as soon as it is found, without searching
+// inside it. Matches are deleted on the pool the search runs on, so matches
+// in disjoint subtrees go concurrently; only those that survive that one
+// engine pass go through the full delete_target pipeline afterwards. Results
+// are reported through the sink (serialized).
+using FoundDirSink = std::function<void(const std::filesystem::path& match, const DeleteResult& result)>;
+FoundDirsStats delete_found_dirs(const std::vector<std::filesystem::path>& roots, const std::vector<NativeName>& names,
+                                 const AppConfig& config, const FoundDirSink& sink,
+                                 DeleteFailureLog* search_failures = nullptr);
 
 } // namespace exterminate
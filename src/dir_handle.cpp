@@ -0,0 +1,688 @@
+#include "dir_handle.hpp"
+
+#include <utility>
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #define NOMINMAX
+  #include <windows.h>
+  #include <winternl.h>
+#else
+  #include <dirent.h>
+  #include <fcntl.h>
+  #include <sys/resource.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+  #include <cerrno>
+  #include <cstring>
+  #ifdef __linux__
+    #include <sys/syscall.h>
+  #endif
+#endif
+
+namespace exterminate {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr size_t kBatchEntries = 512;
+constexpr size_t kEnumerationBufferBytes = 64 * 1024;
+
+#ifdef _WIN32
+
+constexpr DWORD kDispositionDelete = 0x00000001;
+constexpr DWORD kDispositionPosixSemantics = 0x00000002;
+constexpr DWORD kDispositionIgnoreReadonly = 0x00000010;
+constexpr auto kFileDispositionInfoEx = static_cast<FILE_INFO_BY_HANDLE_CLASS>(21);
+
+struct DispositionInfoEx {
+    DWORD flags;
+};
+
+std::error_code win32_error(DWORD code) {
+    return std::error_code(static_cast<int>(code), std::system_category());
+}
+
+// FILETIME counts 100 ns ticks from 1601.
+std::int64_t unix_seconds(LONGLONG file_time) {
+    return file_time / 10000000LL - 11644473600LL;
+}
+
+std::wstring to_verbatim_wide(const fs::path& path) {
+    std::error_code ec;
+    fs::path absolute = fs::absolute(path, ec);
+    if (ec) absolute = path;
+    const std::wstring raw = absolute.wstring();
+    if (raw.rfind(L"\\\\?\\", 0) == 0) return raw;
+    if (raw.rfind(L"\\\\", 0) == 0) return L"\\\\?\\UNC\\" + raw.substr(2);
+    return L"\\\\?\\" + raw;
+}
+
+HANDLE open_relative(HANDLE root, const std::wstring& name, ACCESS_MASK access, ULONG options, std::error_code& ec) {
+    UNICODE_STRING unicode_name;
+    unicode_name.Buffer = const_cast<PWSTR>(name.c_str());
+    unicode_name.Length = static_cast<USHORT>(name.size() * sizeof(wchar_t));
+    unicode_name.MaximumLength = unicode_name.Length;
+
+    OBJECT_ATTRIBUTES attributes;
+    InitializeObjectAttributes(&attributes, &unicode_name, OBJ_CASE_INSENSITIVE, root, nullptr);
+
+    IO_STATUS_BLOCK io{};
+    HANDLE handle = nullptr;
+    const NTSTATUS status = NtCreateFile(
+        &handle,
+        access | SYNCHRONIZE,
+        &attributes,
+        &io,
+        nullptr,
+        0,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        FILE_OPEN,
+        options | FILE_SYNCHRONOUS_IO_NONALERT | FILE_OPEN_REPARSE_POINT | FILE_OPEN_FOR_BACKUP_INTENT,
+        nullptr,
+        0);
+
+    if (status < 0) {
+        ec = win32_error(RtlNtStatusToDosError(status));
+        return nullptr;
+    }
+    return handle;
+}
+
+bool clear_readonly(HANDLE handle) {
+    FILE_BASIC_INFO basic{};
+    if (!GetFileInformationByHandleEx(handle, FileBasicInfo, &basic, sizeof(basic))) return false;
+    if ((basic.FileAttributes & FILE_ATTRIBUTE_READONLY) == 0) return false;
+    basic.FileAttributes &= ~static_cast<DWORD>(FILE_ATTRIBUTE_READONLY);
+    if (basic.FileAttributes == 0) basic.FileAttributes = FILE_ATTRIBUTE_NORMAL;
+    return SetFileInformationByHandle(handle, FileBasicInfo, &basic, sizeof(basic)) != FALSE;
+}
+
+bool delete_relative(HANDLE root, const std::wstring& name, ULONG options, std::error_code& ec) {
+    HANDLE handle = open_relative(root, name, DELETE | FILE_READ_ATTRIBUTES | FILE_WRITE_ATTRIBUTES, options, ec);
+    if (!handle) return false;
+
+    DispositionInfoEx posix_delete{kDispositionDelete | kDispositionPosixSemantics | kDispositionIgnoreReadonly};
+    BOOL deleted = SetFileInformationByHandle(handle, kFileDispositionInfoEx, &posix_delete, sizeof(posix_delete));
+    if (!deleted) {
+        FILE_DISPOSITION_INFO legacy_delete{TRUE};
+        deleted = SetFileInformationByHandle(handle, FileDispositionInfo, &legacy_delete, sizeof(legacy_delete));
+        if (!deleted && GetLastError() == ERROR_ACCESS_DENIED && clear_readonly(handle)) {
+            deleted = SetFileInformationByHandle(handle, FileDispositionInfo, &legacy_delete, sizeof(legacy_delete));
+        }
+    }
+
+    const DWORD error = deleted ? ERROR_SUCCESS : GetLastError();
+    CloseHandle(handle);
+    if (!deleted) {
+        ec = win32_error(error);
+        return false;
+    }
+    return true;
+}
+
+#else
+
+std::error_code errno_error() {
+    return std::error_code(errno, std::system_category());
+}
+
+bool is_dot_or_dot_dot(const char* name) {
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+// Only reached for DT_UNKNOWN, i.e. filesystems that do not report entry
+// types; everything else is classified from the directory listing alone.
+bool is_directory_at(int directory_fd, const char* name) {
+#if defined(__linux__) && defined(STATX_TYPE)
+    struct statx info {};
+    return ::statx(directory_fd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, STATX_TYPE, &info) == 0 &&
+           S_ISDIR(info.stx_mode);
+#else
+    struct stat info {};
+    return ::fstatat(directory_fd, name, &info, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(info.st_mode);
+#endif
+}
+
+#endif
+
+} // namespace
+
+#ifdef _WIN32
+
+struct DirReader::State {
+    HANDLE handle = nullptr;
+    bool exhausted = false;
+    std::vector<unsigned char> buffer;
+};
+
+DirHandle::~DirHandle() {
+    close();
+}
+
+DirHandle::DirHandle(DirHandle&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+
+DirHandle& DirHandle::operator=(DirHandle&& other) noexcept {
+    if (this != &other) {
+        close();
+        handle_ = std::exchange(other.handle_, nullptr);
+    }
+    return *this;
+}
+
+DirHandle DirHandle::open(const fs::path& path, std::error_code& ec) {
+    ec.clear();
+    DirHandle out;
+    const std::wstring verbatim = to_verbatim_wide(path);
+    HANDLE handle = CreateFileW(
+        verbatim.c_str(),
+        FILE_LIST_DIRECTORY | FILE_READ_ATTRIBUTES | SYNCHRONIZE,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS,
+        nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        ec = win32_error(GetLastError());
+        return out;
+    }
+    out.handle_ = handle;
+    return out;
+}
+
+DirHandle DirHandle::open_child(const NativeName& name, std::error_code& ec) const {
+    ec.clear();
+    DirHandle out;
+    out.handle_ = open_relative(static_cast<HANDLE>(handle_), name,
+                                FILE_LIST_DIRECTORY | FILE_READ_ATTRIBUTES, FILE_DIRECTORY_FILE, ec);
+    return out;
+}
+
+bool DirHandle::remove_file(const NativeName& name, std::error_code& ec) const {
+    ec.clear();
+    return delete_relative(static_cast<HANDLE>(handle_), name, 0, ec);
+}
+
+bool DirHandle::remove_directory(const NativeName& name, std::error_code& ec) const {
+    ec.clear();
+    return delete_relative(static_cast<HANDLE>(handle_), name, FILE_DIRECTORY_FILE, ec);
+}
+
+bool DirHandle::entry_size(const NativeName& name, std::uint64_t& out_size, std::error_code& ec) const {
+    ec.clear();
+    out_size = 0;
+    HANDLE handle = open_relative(static_cast<HANDLE>(handle_), name, FILE_READ_ATTRIBUTES, 0, ec);
+    if (!handle) return false;
+    FILE_STANDARD_INFO info{};
+    const BOOL ok = GetFileInformationByHandleEx(handle, FileStandardInfo, &info, sizeof(info));
+    const DWORD error = ok ? ERROR_SUCCESS : GetLastError();
+    CloseHandle(handle);
+    if (!ok) {
+        ec = win32_error(error);
+        return false;
+    }
+    out_size = static_cast<std::uint64_t>(info.EndOfFile.QuadPart);
+    return true;
+}
+
+bool DirHandle::entry_status(const NativeName& name, std::uint64_t& out_size, std::int64_t& out_modified,
+                             std::error_code& ec) const {
+    ec.clear();
+    out_size = 0;
+    out_modified = 0;
+    HANDLE handle = open_relative(static_cast<HANDLE>(handle_), name, FILE_READ_ATTRIBUTES, 0, ec);
+    if (!handle) return false;
+    FILE_STANDARD_INFO standard{};
+    FILE_BASIC_INFO basic{};
+    const BOOL ok = GetFileInformationByHandleEx(handle, FileStandardInfo, &standard, sizeof(standard)) &&
+                    GetFileInformationByHandleEx(handle, FileBasicInfo, &basic, sizeof(basic));
+    const DWORD error = ok ? ERROR_SUCCESS : GetLastError();
+    CloseHandle(handle);
+    if (!ok) {
+        ec = win32_error(error);
+        return false;
+    }
+    out_size = static_cast<std::uint64_t>(standard.EndOfFile.QuadPart);
+    out_modified = unix_seconds(basic.LastWriteTime.QuadPart);
+    return true;
+}
+
+bool DirHandle::valid() const {
+    return handle_ != nullptr;
+}
+
+void DirHandle::close() {
+    if (handle_) {
+        CloseHandle(static_cast<HANDLE>(handle_));
+        handle_ = nullptr;
+    }
+}
+
+DirReader::DirReader(const DirHandle& directory) : state_(std::make_unique<State>()) {
+    state_->handle = static_cast<HANDLE>(directory.handle_);
+    state_->buffer.resize(kEnumerationBufferBytes);
+}
+
+DirReader::~DirReader() = default;
+
+bool DirReader::next_batch(std::vector<DirEntry>& out, std::error_code& ec) {
+    out.clear();
+    ec.clear();
+    if (state_->exhausted || !state_->handle) return false;
+
+    while (out.empty()) {
+        if (!GetFileInformationByHandleEx(state_->handle, FileFullDirectoryInfo,
+                                          state_->buffer.data(), static_cast<DWORD>(state_->buffer.size()))) {
+            const DWORD error = GetLastError();
+            state_->exhausted = true;
+            if (error != ERROR_NO_MORE_FILES) ec = win32_error(error);
+            return false;
+        }
+
+        const unsigned char* cursor = state_->buffer.data();
+        for (;;) {
+            const auto* info = reinterpret_cast<const FILE_FULL_DIR_INFO*>(cursor);
+            const std::wstring name(info->FileName, info->FileNameLength / sizeof(wchar_t));
+            if (name != L"." && name != L"..") {
+                DirEntry entry;
+                entry.name = name;
+                entry.directory = (info->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0 &&
+                                  (info->FileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0;
+                entry.size_known = true;
+                entry.size = static_cast<std::uint64_t>(info->EndOfFile.QuadPart);
+                entry.modified_known = true;
+                entry.modified = unix_seconds(info->LastWriteTime.QuadPart);
+                out.push_back(std::move(entry));
+            }
+            if (info->NextEntryOffset == 0) break;
+            cursor += info->NextEntryOffset;
+        }
+    }
+    return true;
+}
+
+FileHandle::~FileHandle() {
+    close();
+}
+
+FileHandle::FileHandle(FileHandle&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+
+FileHandle& FileHandle::operator=(FileHandle&& other) noexcept {
+    if (this != &other) {
+        close();
+        handle_ = std::exchange(other.handle_, nullptr);
+    }
+    return *this;
+}
+
+bool FileHandle::valid() const {
+    return handle_ != nullptr;
+}
+
+void FileHandle::close() {
+    if (handle_) {
+        CloseHandle(static_cast<HANDLE>(handle_));
+        handle_ = nullptr;
+    }
+}
+
+FileHandle DirHandle::open_file_for_overwrite(const NativeName& name, bool unbuffered, bool& out_unbuffered,
+                                              std::error_code& ec) const {
+    ec.clear();
+    const HANDLE root = static_cast<HANDLE>(handle_);
+    const ACCESS_MASK access = FILE_READ_DATA | FILE_WRITE_DATA | FILE_READ_ATTRIBUTES;
+    const ULONG options = FILE_NON_DIRECTORY_FILE | (unbuffered ? FILE_NO_INTERMEDIATE_BUFFERING | FILE_WRITE_THROUGH : 0);
+
+    HANDLE handle = open_relative(root, name, access, options, ec);
+    if (!handle && ec.value() == ERROR_ACCESS_DENIED) {
+        std::error_code attributes_ec;
+        HANDLE attributes = open_relative(root, name, FILE_READ_ATTRIBUTES | FILE_WRITE_ATTRIBUTES,
+                                          FILE_NON_DIRECTORY_FILE, attributes_ec);
+        if (attributes) {
+            const bool cleared = clear_readonly(attributes);
+            CloseHandle(attributes);
+            if (cleared) {
+                ec.clear();
+                handle = open_relative(root, name, access, options, ec);
+            }
+        }
+    }
+
+    // The handle is on the link itself when the entry is a reparse point.
+    if (handle) {
+        FILE_BASIC_INFO basic{};
+        if (GetFileInformationByHandleEx(handle, FileBasicInfo, &basic, sizeof(basic)) &&
+            (basic.FileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0) {
+            CloseHandle(handle);
+            handle = nullptr;
+        }
+    }
+
+    FileHandle out;
+    out.handle_ = handle;
+    out_unbuffered = handle && unbuffered;
+    return out;
+}
+
+void raise_open_handle_limit() {}
+
+#else
+
+#ifdef __linux__
+struct DirReader::State {
+    int fd = -1;
+    bool exhausted = false;
+    std::unique_ptr<char[]> buffer;
+    long filled = 0;
+    long offset = 0;
+};
+#else
+struct DirReader::State {
+    DIR* stream = nullptr;
+    bool exhausted = false;
+};
+#endif
+
+DirHandle::~DirHandle() {
+    close();
+}
+
+DirHandle::DirHandle(DirHandle&& other) noexcept : fd_(std::exchange(other.fd_, -1)) {}
+
+DirHandle& DirHandle::operator=(DirHandle&& other) noexcept {
+    if (this != &other) {
+        close();
+        fd_ = std::exchange(other.fd_, -1);
+    }
+    return *this;
+}
+
+DirHandle DirHandle::open(const fs::path& path, std::error_code& ec) {
+    ec.clear();
+    DirHandle out;
+    out.fd_ = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (out.fd_ < 0) ec = errno_error();
+    return out;
+}
+
+FileHandle::~FileHandle() {
+    close();
+}
+
+FileHandle::FileHandle(FileHandle&& other) noexcept : fd_(std::exchange(other.fd_, -1)) {}
+
+FileHandle& FileHandle::operator=(FileHandle&& other) noexcept {
+    if (this != &other) {
+        close();
+        fd_ = std::exchange(other.fd_, -1);
+    }
+    return *this;
+}
+
+bool FileHandle::valid() const {
+    return fd_ >= 0;
+}
+
+void FileHandle::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+// The type is checked before opening so a device node is never opened for
+// writing, and again on the descriptor in case the entry was swapped.
+FileHandle DirHandle::open_file_for_overwrite(const NativeName& name, bool unbuffered, bool& out_unbuffered,
+                                              std::error_code& ec) const {
+    ec.clear();
+    out_unbuffered = false;
+    FileHandle out;
+
+    struct stat before {};
+    if (::fstatat(fd_, name.c_str(), &before, AT_SYMLINK_NOFOLLOW) != 0) {
+        ec = errno_error();
+        return out;
+    }
+    if (!S_ISREG(before.st_mode)) return out;
+
+    const int flags = O_WRONLY | O_NOFOLLOW | O_NONBLOCK | O_CLOEXEC;
+    const auto open_file = [&] {
+#ifdef O_DIRECT
+        if (unbuffered) {
+            out.fd_ = ::openat(fd_, name.c_str(), flags | O_DIRECT);
+            if (out.fd_ >= 0) {
+                out_unbuffered = true;
+                return;
+            }
+            // EINVAL: the filesystem does not do direct I/O (tmpfs, some FUSE).
+            if (errno != EINVAL) return;
+        }
+#endif
+        out.fd_ = ::openat(fd_, name.c_str(), flags);
+#ifdef F_NOCACHE
+        if (out.fd_ >= 0 && unbuffered) out_unbuffered = ::fcntl(out.fd_, F_NOCACHE, 1) == 0;
+#endif
+    };
+
+    open_file();
+    if (out.fd_ < 0 && errno == EACCES && (before.st_mode & S_IWUSR) == 0 &&
+        ::fchmodat(fd_, name.c_str(), (before.st_mode | S_IWUSR) & 07777, 0) == 0) {
+        open_file();
+    }
+    if (out.fd_ < 0) {
+        ec = errno_error();
+        return out;
+    }
+
+    struct stat after {};
+    if (::fstat(out.fd_, &after) != 0 || !S_ISREG(after.st_mode) || after.st_ino != before.st_ino ||
+        after.st_dev != before.st_dev) {
+        out.close();
+        out_unbuffered = false;
+    }
+    return out;
+}
+
+DirHandle DirHandle::open_child(const NativeName& name, std::error_code& ec) const {
+    ec.clear();
+    DirHandle out;
+    out.fd_ = ::openat(fd_, name.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (out.fd_ < 0) ec = errno_error();
+    return out;
+}
+
+bool DirHandle::remove_file(const NativeName& name, std::error_code& ec) const {
+    ec.clear();
+    if (::unlinkat(fd_, name.c_str(), 0) == 0) return true;
+    ec = errno_error();
+    return false;
+}
+
+bool DirHandle::remove_directory(const NativeName& name, std::error_code& ec) const {
+    ec.clear();
+    if (::unlinkat(fd_, name.c_str(), AT_REMOVEDIR) == 0) return true;
+    ec = errno_error();
+    return false;
+}
+
+bool DirHandle::entry_size(const NativeName& name, std::uint64_t& out_size, std::error_code& ec) const {
+    ec.clear();
+    out_size = 0;
+#if defined(__linux__) && defined(STATX_SIZE)
+    struct statx info {};
+    if (::statx(fd_, name.c_str(), AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, STATX_SIZE, &info) != 0) {
+        ec = errno_error();
+        return false;
+    }
+    out_size = info.stx_size;
+#else
+    struct stat info {};
+    if (::fstatat(fd_, name.c_str(), &info, AT_SYMLINK_NOFOLLOW) != 0) {
+        ec = errno_error();
+        return false;
+    }
+    out_size = static_cast<std::uint64_t>(info.st_size);
+#endif
+    return true;
+}
+
+bool DirHandle::entry_status(const NativeName& name, std::uint64_t& out_size, std::int64_t& out_modified,
+                             std::error_code& ec) const {
+    ec.clear();
+    out_size = 0;
+    out_modified = 0;
+#if defined(__linux__) && defined(STATX_SIZE)
+    struct statx info {};
+    if (::statx(fd_, name.c_str(), AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, STATX_SIZE | STATX_MTIME, &info) != 0) {
+        ec = errno_error();
+        return false;
+    }
+    out_size = info.stx_size;
+    out_modified = info.stx_mtime.tv_sec;
+#else
+    struct stat info {};
+    if (::fstatat(fd_, name.c_str(), &info, AT_SYMLINK_NOFOLLOW) != 0) {
+        ec = errno_error();
+        return false;
+    }
+    out_size = static_cast<std::uint64_t>(info.st_size);
+    out_modified = static_cast<std::int64_t>(info.st_mtime);
+#endif
+    return true;
+}
+
+bool DirHandle::valid() const {
+    return fd_ >= 0;
+}
+
+void DirHandle::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+#ifdef __linux__
+
+namespace {
+
+struct LinuxDirent64 {
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+} // namespace
+
+DirReader::DirReader(const DirHandle& directory) : state_(std::make_unique<State>()) {
+    state_->fd = directory.fd_;
+    state_->buffer.reset(new char[kEnumerationBufferBytes]);
+}
+
+DirReader::~DirReader() = default;
+
+bool DirReader::next_batch(std::vector<DirEntry>& out, std::error_code& ec) {
+    out.clear();
+    ec.clear();
+    if (state_->exhausted) return false;
+    if (state_->fd < 0) {
+        ec = std::make_error_code(std::errc::bad_file_descriptor);
+        state_->exhausted = true;
+        return false;
+    }
+
+    while (out.size() < kBatchEntries) {
+        if (state_->offset >= state_->filled) {
+            const long read = ::syscall(SYS_getdents64, state_->fd, state_->buffer.get(), kEnumerationBufferBytes);
+            if (read <= 0) {
+                if (read < 0) ec = errno_error();
+                state_->exhausted = true;
+                break;
+            }
+            state_->filled = read;
+            state_->offset = 0;
+        }
+
+        const auto* item = reinterpret_cast<const LinuxDirent64*>(state_->buffer.get() + state_->offset);
+        state_->offset += item->d_reclen;
+
+        const char* name = item->d_name;
+        if (is_dot_or_dot_dot(name)) continue;
+
+        DirEntry entry;
+        entry.name = name;
+        if (item->d_type == DT_UNKNOWN) {
+            entry.directory = is_directory_at(state_->fd, name);
+        } else {
+            entry.directory = item->d_type == DT_DIR;
+        }
+        out.push_back(std::move(entry));
+    }
+
+    return !out.empty();
+}
+
+#else
+
+DirReader::DirReader(const DirHandle& directory) : state_(std::make_unique<State>()) {
+    const int fd = ::dup(directory.fd_);
+    if (fd < 0) return;
+    state_->stream = ::fdopendir(fd);
+    if (!state_->stream) ::close(fd);
+}
+
+DirReader::~DirReader() {
+    if (state_->stream) ::closedir(state_->stream);
+}
+
+bool DirReader::next_batch(std::vector<DirEntry>& out, std::error_code& ec) {
+    out.clear();
+    ec.clear();
+    if (!state_->stream) {
+        if (!state_->exhausted) ec = std::make_error_code(std::errc::bad_file_descriptor);
+        state_->exhausted = true;
+        return false;
+    }
+    if (state_->exhausted) return false;
+
+    while (out.size() < kBatchEntries) {
+        errno = 0;
+        const dirent* item = ::readdir(state_->stream);
+        if (!item) {
+            if (errno != 0) ec = errno_error();
+            state_->exhausted = true;
+            break;
+        }
+
+        const char* name = item->d_name;
+        if (is_dot_or_dot_dot(name)) continue;
+
+        DirEntry entry;
+        entry.name = name;
+        if (item->d_type == DT_UNKNOWN) {
+            entry.directory = is_directory_at(::dirfd(state_->stream), name);
+        } else {
+            entry.directory = item->d_type == DT_DIR;
+        }
+        out.push_back(std::move(entry));
+    }
+
+    return !out.empty();
+}
+
+#endif
+
+void raise_open_handle_limit() {
+    rlimit limit{};
+    if (::getrlimit(RLIMIT_NOFILE, &limit) != 0) return;
+    if (limit.rlim_cur >= limit.rlim_max) return;
+    limit.rlim_cur = limit.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &limit);
+}
+
+#endif
+
+} // namespace exterminate
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <system_error>
+#include <vector>
+
+namespace exterminate {
+
+using NativeName = std::filesystem::path::string_type;
+
+struct DirEntry {
+    NativeName name;
+    bool directory = false;
+    bool size_known = false;
+    std::uint64_t size = 0;
+    // Seconds since the Unix epoch. Only Windows reports it while enumerating.
+    bool modified_known = false;
+    std::int64_t modified = 0;
+};
+
+// A file opened relative to a directory to overwrite its contents.
+class FileHandle {
+public:
+    FileHandle() = default;
+    ~FileHandle();
+
+    FileHandle(FileHandle&& other) noexcept;
+    FileHandle& operator=(FileHandle&& other) noexcept;
+    FileHandle(const FileHandle&) = delete;
+    FileHandle& operator=(const FileHandle&) = delete;
+
+    bool valid() const;
+    void close();
+
+#ifdef _WIN32
+    void* native_handle() const { return handle_; }
+#else
+    int native_fd() const { return fd_; }
+#endif
+
+private:
+    friend class DirHandle;
+
+#ifdef _WIN32
+    void* handle_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+// An open directory that children are opened, enumerated and removed
+// relative to (openat/unlinkat on POSIX, RootDirectory-relative NtCreateFile
+// on Windows), so no operation ever resolves a full path.
+class DirHandle {
+public:
+    DirHandle() = default;
+    ~DirHandle();
+
+    DirHandle(DirHandle&& other) noexcept;
+    DirHandle& operator=(DirHandle&& other) noexcept;
+    DirHandle(const DirHandle&) = delete;
+    DirHandle& operator=(const DirHandle&) = delete;
+
+    static DirHandle open(const std::filesystem::path& path, std::error_code& ec);
+
+    DirHandle open_child(const NativeName& name, std::error_code& ec) const;
+    bool remove_file(const NativeName& name, std::error_code& ec) const;
+    bool remove_directory(const NativeName& name, std::error_code& ec) const;
+    bool entry_size(const NativeName& name, std::uint64_t& out_size, std::error_code& ec) const;
+    // Size and last write time (seconds since the Unix epoch) without
+    // following links.
+    bool entry_status(const NativeName& name, std::uint64_t& out_size, std::int64_t& out_modified,
+                      std::error_code& ec) const;
+
+    // Opens a regular file for writing in place, without following links.
+    // Anything else (a link, device or FIFO) gives an invalid handle and no
+    // error. With `unbuffered`, writes go straight to the device (O_DIRECT,
+    // FILE_NO_INTERMEDIATE_BUFFERING) where the filesystem allows it, and
+    // `out_unbuffered` says whether they do. A read-only file is made
+    // writable first.
+    FileHandle open_file_for_overwrite(const NativeName& name, bool unbuffered, bool& out_unbuffered,
+                                       std::error_code& ec) const;
+
+    bool valid() const;
+    void close();
+
+#ifndef _WIN32
+    int native_fd() const { return fd_; }
+#endif
+
+private:
+    friend class DirReader;
+
+#ifdef _WIN32
+    void* handle_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+class DirReader {
+public:
+    explicit DirReader(const DirHandle& directory);
+    ~DirReader();
+
+    DirReader(const DirReader&) = delete;
+    DirReader& operator=(const DirReader&) = delete;
+
+    // Replaces `out` with the next batch of entries, skipping "." and "..".
+    // Returns false once the directory is exhausted or on error.
+    bool next_batch(std::vector<DirEntry>& out, std::error_code& ec);
+
+private:
+    struct State;
+    std::unique_ptr<State> state_;
+};
+
+void raise_open_handle_limit();
+
+} // namespace exterminate
@@ -0,0 +1,141 @@
+#include "dir_search.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <system_error>
+
+namespace exterminate {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// `remaining` counts the enumeration plus the children that have not opened
+// their handle yet; the handle is closed once it drops to zero. Nothing waits
+// on a directory's subtree, so unlike the delete engine that is all it does.
+struct SearchNode {
+    DirHandle handle;
+    NativeName name;
+    std::shared_ptr<SearchNode> parent;
+    std::atomic<size_t> remaining{1};
+    PathGuard::Cursor guard;
+};
+
+struct SearchContext {
+    SearchContext(WorkPool& owner, const DirSearchOptions& search_options, const DirMatchHandler& handler,
+                  fs::path root)
+        : pool(owner), options(search_options), on_match(handler), base(std::move(root)) {}
+
+    WorkPool& pool;
+    const DirSearchOptions& options;
+    const DirMatchHandler& on_match;
+    fs::path base;
+    TaskGroup group;
+    std::atomic<size_t> searched{0};
+    std::atomic<size_t> matches{0};
+    std::atomic<size_t> failures{0};
+};
+
+fs::path path_of(const SearchContext& context, const SearchNode& node) {
+    std::vector<const NativeName*> names;
+    for (const SearchNode* current = &node; current->parent; current = current->parent.get()) {
+        names.push_back(&current->name);
+    }
+
+    fs::path out = context.base;
+    for (auto it = names.rbegin(); it != names.rend(); ++it) {
+        out /= **it;
+    }
+    return out;
+}
+
+bool is_wanted(const DirSearchOptions& options, const NativeName& name) {
+#ifdef _WIN32
+    const NativeName folded = fold_name_case(name);
+#else
+    const NativeName& folded = name;
+#endif
+    return std::find(options.names.begin(), options.names.end(), folded) != options.names.end();
+}
+
+void release_handle(SearchNode& node) {
+    if (node.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) node.handle.close();
+}
+
+void search_directory(SearchContext& context, const std::shared_ptr<SearchNode>& node) {
+    std::error_code ec;
+    if (node->parent) {
+        node->handle = node->parent->handle.open_child(node->name, ec);
+        release_handle(*node->parent);
+    }
+
+    if (!ec) {
+        DirReader reader(node->handle);
+        std::vector<DirEntry> batch;
+        const PathGuard* guard = node->guard.empty() ? nullptr : context.options.guard;
+        PathGuard::Cursor child_guard;
+        while (reader.next_batch(batch, ec)) {
+            for (auto& entry : batch) {
+                if (!entry.directory) continue;
+                if (guard && guard->protects(node->guard, entry.name, &child_guard)) continue;
+
+                if (is_wanted(context.options, entry.name)) {
+                    context.matches.fetch_add(1, std::memory_order_relaxed);
+                    context.pool.submit(context.group, [&context, match = path_of(context, *node) / entry.name,
+                                                        cursor = guard ? std::move(child_guard) : PathGuard::Cursor()] {
+                        context.on_match(match, cursor);
+                    });
+                    continue;
+                }
+
+                auto child = std::make_shared<SearchNode>();
+                child->name = std::move(entry.name);
+                child->parent = node;
+                if (guard) child->guard = std::move(child_guard);
+                node->remaining.fetch_add(1, std::memory_order_relaxed);
+                context.pool.submit(context.group, [&context, child] { search_directory(context, child); });
+            }
+            if (ec) break;
+        }
+    }
+
+    release_handle(*node);
+    context.searched.fetch_add(1, std::memory_order_relaxed);
+    if (ec) {
+        context.failures.fetch_add(1, std::memory_order_relaxed);
+        if (context.options.failures) context.options.failures->add(DeleteFailure{path_of(context, *node), true, ec});
+    }
+}
+
+} // namespace
+
+DirSearchStats search_dirs(const fs::path& root, const DirSearchOptions& options, WorkPool& pool,
+                           const DirMatchHandler& on_match) {
+    static std::once_flag handle_limit_once;
+    std::call_once(handle_limit_once, raise_open_handle_limit);
+
+    DirSearchStats stats;
+    SearchContext context(pool, options, on_match, root);
+
+    auto top = std::make_shared<SearchNode>();
+    std::error_code ec;
+    top->handle = DirHandle::open(root, ec);
+    if (ec) {
+        stats.failures = 1;
+        if (options.failures) options.failures->add(DeleteFailure{root, true, ec});
+        return stats;
+    }
+    if (options.guard) top->guard = options.guard->cursor_for(root);
+
+    pool.submit(context.group, [&context, top] { search_directory(context, top); });
+    pool.wait(context.group);
+
+    stats.directories_searched = context.searched.load();
+    stats.matches = context.matches.load();
+    stats.failures = context.failures.load();
+    return stats;
+}
+
+} // namespace exterminate
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+#include "dir_handle.hpp"
+#include "native_delete.hpp"
+#include "path_guard.hpp"
+#include "work_pool.hpp"
+
+namespace exterminate {
+
+struct DirSearchOptions {
+    // Directory names to find, folded with fold_name_case.
+    std::vector<NativeName> names;
+    // Protected entries are neither matched nor searched.
+    const PathGuard* guard = nullptr;
+    // Directories that could not be opened or read are reported here.
+    DeleteFailureLog* failures = nullptr;
+};
+
+struct DirSearchStats {
+    size_t directories_searched = 0;
+    size_t matches = 0;
+    size_t failures = 0;
+};
+
+// Runs as its own pool task for every match. `guard` is the guard cursor
+// for the entries inside the match.
+using DirMatchHandler = std::function<void(const std::filesystem::path& match, const PathGuard::Cursor& guard)>;
+
+// Walks `root` on the pool with the same handle-relative traversal the
+// delete engine uses, without descending into matches. Returns once the
+// walk and every handler call have finished.
+DirSearchStats search_dirs(const std::filesystem::path& root, const DirSearchOptions& options, WorkPool& pool,
+                           const DirMatchHandler& on_match);
+
+} // namespace exterminate
@@ -1,5 +1,7 @@
 #include "install.hpp"
 
+#include "content_hash.hpp"
+#include "install_manifest.hpp"
 #include "paths.hpp"
 #include "windows_env.hpp"
 
@@ -19,6 +21,8 @@ namespace fs = std::filesystem;
 
 namespace {
 
+constexpr const char* kManifestFileName = "install-manifest.txt";
+
 enum class InstallState {
     Installed,
     Updated,
@@ -31,6 +35,15 @@ void write_text_file(const fs::path& path, const std::string& text) {
     out << text;
 }
 
+void write_text_file_if_changed(InstallManifest& manifest, const fs::path& path, const std::string& text) {
+    const std::uint64_t hash = hash_bytes(text.data(), text.size());
+    std::uint64_t installed = 0;
+    if (manifest.hash_file(path, installed) && installed == hash) return;
+
+    write_text_file(path, text);
+    manifest.record(path, hash);
+}
+
 std::string install_state_text(InstallState state) {
     switch (state) {
         case InstallState::Installed: return "installed";
@@ -49,7 +62,7 @@ void remove_legacy_wrappers(const fs::path& install_dir) {
     fs::remove_all(install_dir / "bin", ec);
 }
 
-void write_context_script(const fs::path& install_dir) {
+void write_context_script(const fs::path& install_dir, InstallManifest& manifest) {
     const std::string script =
         "Set shell = CreateObject(\"WScript.Shell\")\r\n"
         "Set fso = CreateObject(\"Scripting.FileSystemObject\")\r\n"
@@ -63,10 +76,11 @@ void write_context_script(const fs::path& install_dir) {
         "exitCode = shell.Run(command, 0, True)\r\n"
         "WScript.Quit exitCode\r\n";
 
-    write_text_file(install_dir / "exterminate-context.vbs", script);
+    write_text_file_if_changed(manifest, install_dir / "exterminate-context.vbs", script);
 }
 
-void copy_default_config(const AppConfig& config, const std::string& base_directory, const std::string& explicit_source) {
+void copy_default_config(const AppConfig& config, const std::string& base_directory, const std::string& explicit_source,
+                         InstallManifest& manifest) {
     if (!config.copy_default_config_on_install) return;
 
     fs::path source;
@@ -76,14 +90,20 @@ void copy_default_config(const AppConfig& config, const std::string& base_direct
         source = fs::path(default_config_path(base_directory));
     }
 
-    std::error_code ec;
-    if (!fs::exists(source, ec) || ec) return;
+    std::uint64_t source_hash = 0;
+    if (!manifest.hash_file(source, source_hash)) return;
 
     const fs::path destination_dir = resolve_install_dir(config) / "config";
+    const fs::path destination = destination_dir / "exterminate.config.json";
+    std::uint64_t installed_hash = 0;
+    if (manifest.hash_file(destination, installed_hash) && installed_hash == source_hash) return;
+
+    std::error_code ec;
     fs::create_directories(destination_dir, ec);
     if (ec) return;
 
-    fs::copy_file(source, destination_dir / "exterminate.config.json", fs::copy_options::overwrite_existing, ec);
+    fs::copy_file(source, destination, fs::copy_options::overwrite_existing, ec);
+    if (!ec) manifest.record(destination, source_hash);
 }
 
 bool running_inside_path(const fs::path& root, const fs::path& path) {
@@ -163,8 +183,20 @@ int install_self(const AppConfig& config, const std::string& base_directory, con
         return 1;
     }
 
+    // Files whose size and mtime match the manifest are not read again, so
+    // re-running install when nothing changed costs a few stats.
+    InstallManifest manifest;
+    const fs::path manifest_path = install_dir / kManifestFileName;
+    manifest.load(manifest_path);
+
+    std::uint64_t installed_hash = 0;
+    const bool installed = manifest.hash_file(install_exe, installed_hash);
+    const bool running_installed = installed && fs::equivalent(self_path, install_exe, ec) && !ec;
+    std::uint64_t self_hash = 0;
+    const bool self_hashed = !running_installed && manifest.hash_file(self_path, self_hash);
+
     InstallState state = InstallState::Installed;
-    if (!files_identical(self_path, install_exe)) {
+    if (!running_installed && (!self_hashed || !installed || self_hash != installed_hash)) {
         if (fs::exists(install_exe, ec) && !ec) {
             state = InstallState::Updated;
         }
@@ -173,21 +205,26 @@ int install_self(const AppConfig& config, const std::string& base_directory, con
             std::cerr << "error: could not copy executable to install directory.\n";
             return 1;
         }
+        if (self_hashed) manifest.record(install_exe, self_hash);
     } else {
         state = InstallState::AlreadyInstalled;
     }
 
-    write_context_script(install_dir);
+    write_context_script(install_dir, manifest);
     remove_legacy_wrappers(install_dir);
-    copy_default_config(config, base_directory, config_source_path);
+    copy_default_config(config, base_directory, config_source_path, manifest);
+    manifest.save(manifest_path);
 
-    remove_user_path_entry(wrapper_dir.string());
+    // The broadcast waits on every top-level window, so it is only sent when
+    // PATH actually changed.
+    bool path_changed = remove_user_path_entry(wrapper_dir.string());
     if (config.self_install_to_user_path) {
         if (ensure_user_path_entry(install_dir.string())) {
             std::cout << "Added to PATH: " << install_dir.string() << "\n";
+            path_changed = true;
         }
     }
-    broadcast_environment_change();
+    if (path_changed) broadcast_environment_change();
 
     std::cout << "Installed path: " << install_exe.string() << "\n";
     std::cout << "Status: " << install_state_text(state) << "\n";
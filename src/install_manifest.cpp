@@ -0,0 +1,107 @@
+#include "install_manifest.hpp"
+
+#include "content_hash.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace exterminate {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string manifest_key(const fs::path& path) {
+    std::error_code ec;
+    const fs::path absolute = fs::absolute(path, ec);
+    return (ec ? path : absolute).lexically_normal().u8string();
+}
+
+} // namespace
+
+void InstallManifest::load(const fs::path& manifest_path) {
+    entries_.clear();
+    changed_ = false;
+
+    std::ifstream in(manifest_path, std::ios::binary);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+
+        std::istringstream fields(line);
+        std::string hash_text;
+        Entry entry;
+        if (!(fields >> hash_text >> entry.size >> entry.modified)) continue;
+        fields.get();
+
+        std::string path;
+        std::getline(fields, path);
+        if (path.empty()) continue;
+
+        entry.hash = std::strtoull(hash_text.c_str(), nullptr, 16);
+        entries_[path] = entry;
+    }
+}
+
+bool InstallManifest::save(const fs::path& manifest_path) {
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it->second.used) {
+            ++it;
+        } else {
+            it = entries_.erase(it);
+            changed_ = true;
+        }
+    }
+    if (!changed_) return true;
+
+    std::ofstream out(manifest_path, std::ios::binary | std::ios::trunc);
+    for (const auto& [path, entry] : entries_) {
+        out << format_hash(entry.hash) << ' ' << entry.size << ' ' << entry.modified << ' ' << path << '\n';
+    }
+    if (!out) return false;
+    changed_ = false;
+    return true;
+}
+
+bool InstallManifest::stat_file(const fs::path& path, std::uintmax_t& out_size, long long& out_modified) const {
+    std::error_code ec;
+    out_size = fs::file_size(path, ec);
+    if (ec) return false;
+    const fs::file_time_type modified = fs::last_write_time(path, ec);
+    if (ec) return false;
+    out_modified = static_cast<long long>(modified.time_since_epoch().count());
+    return true;
+}
+
+bool InstallManifest::hash_file(const fs::path& path, std::uint64_t& out_hash) {
+    std::uintmax_t size = 0;
+    long long modified = 0;
+    if (!stat_file(path, size, modified)) return false;
+
+    const std::string key = manifest_key(path);
+    const auto known = entries_.find(key);
+    if (known != entries_.end() && known->second.size == size && known->second.modified == modified) {
+        known->second.used = true;
+        out_hash = known->second.hash;
+        return true;
+    }
+
+    std::uint64_t hash = 0;
+    if (!hash_file_contents(path, hash)) return false;
+    entries_[key] = Entry{hash, size, modified, true};
+    changed_ = true;
+    out_hash = hash;
+    return true;
+}
+
+void InstallManifest::record(const fs::path& path, std::uint64_t hash) {
+    std::uintmax_t size = 0;
+    long long modified = 0;
+    if (!stat_file(path, size, modified)) return;
+
+    entries_[manifest_key(path)] = Entry{hash, size, modified, true};
+    changed_ = true;
+}
+
+} // namespace exterminate
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+
+namespace exterminate {
+
+// Remembers the content hash, size and modification time of every file the
+// installer reads or writes, so an unchanged file is recognised from a stat
+// instead of being read again. Stored as one "<hash> <size> <mtime> <path>"
+// line per file in the install directory.
+class InstallManifest {
+public:
+    void load(const std::filesystem::path& manifest_path);
+    // Only files looked up or recorded since load() are kept. Does nothing if
+    // no entry changed.
+    bool save(const std::filesystem::path& manifest_path);
+
+    // Rehashes the file only when its size or mtime differ from the record.
+    bool hash_file(const std::filesystem::path& path, std::uint64_t& out_hash);
+    // Records a file just written with known content.
+    void record(const std::filesystem::path& path, std::uint64_t hash);
+
+private:
+    struct Entry {
+        std::uint64_t hash = 0;
+        std::uintmax_t size = 0;
+        long long modified = 0;
+        bool used = false;
+    };
+
+    bool stat_file(const std::filesystem::path& path, std::uintmax_t& out_size, long long& out_modified) const;
+
+    std::map<std::string, Entry> entries_;
+    bool changed_ = false;
+};
+
+} // namespace exterminate
@@ -0,0 +1,39 @@
+#include "io_throttle.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace exterminate {
+
+namespace {
+
+// How far ahead of the rate a caller may run after an idle spell.
+constexpr std::int64_t kBurstNanoseconds = 50'000'000;
+
+} // namespace
+
+IoThrottle::IoThrottle(std::uint64_t ops_per_sec, std::uint64_t bytes_per_sec)
+    : ops_per_sec_(ops_per_sec), bytes_per_sec_(bytes_per_sec), epoch_(std::chrono::steady_clock::now()) {}
+
+std::int64_t IoThrottle::reserve(std::atomic<std::int64_t>& next, std::uint64_t rate, std::uint64_t amount,
+                                 std::int64_t now) const {
+    const auto cost = static_cast<std::int64_t>(static_cast<double>(amount) * 1e9 / static_cast<double>(rate));
+    std::int64_t current = next.load(std::memory_order_relaxed);
+    std::int64_t updated = 0;
+    do {
+        updated = std::max(current, now - kBurstNanoseconds) + cost;
+    } while (!next.compare_exchange_weak(current, updated, std::memory_order_relaxed));
+    return updated - kBurstNanoseconds;
+}
+
+void IoThrottle::acquire(std::uint64_t ops, std::uint64_t bytes) {
+    const std::int64_t now =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch_).count();
+
+    std::int64_t due = now;
+    if (ops_per_sec_ > 0 && ops > 0) due = std::max(due, reserve(next_op_, ops_per_sec_, ops, now));
+    if (bytes_per_sec_ > 0 && bytes > 0) due = std::max(due, reserve(next_byte_, bytes_per_sec_, bytes, now));
+    if (due > now) std::this_thread::sleep_until(epoch_ + std::chrono::nanoseconds(due));
+}
+
+} // namespace exterminate
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace exterminate {
+
+// Token buckets for removals and for the bytes they free, shared by every
+// worker. A caller reserves its tokens up front and sleeps until the bucket
+// could have paid for them, so the rate holds across threads with at most a
+// short burst. A rate of zero is unlimited.
+class IoThrottle {
+public:
+    IoThrottle(std::uint64_t ops_per_sec, std::uint64_t bytes_per_sec);
+
+    IoThrottle(const IoThrottle&) = delete;
+    IoThrottle& operator=(const IoThrottle&) = delete;
+
+    bool limits_bytes() const { return bytes_per_sec_ > 0; }
+    void acquire(std::uint64_t ops, std::uint64_t bytes);
+
+private:
+    // Virtual time at which the bucket is next empty, in nanoseconds since
+    // `epoch_` (GCRA).
+    std::int64_t reserve(std::atomic<std::int64_t>& next, std::uint64_t rate, std::uint64_t amount,
+                         std::int64_t now) const;
+
+    std::uint64_t ops_per_sec_;
+    std::uint64_t bytes_per_sec_;
+    std::chrono::steady_clock::time_point epoch_;
+    std::atomic<std::int64_t> next_op_{0};
+    std::atomic<std::int64_t> next_byte_{0};
+};
+
+} // namespace exterminate
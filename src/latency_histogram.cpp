@@ -0,0 +1,63 @@
+#include "latency_histogram.hpp"
+
+namespace exterminate {
+
+namespace {
+
+int highest_bit(std::uint64_t value) {
+    int bit = 0;
+    while (value >>= 1) ++bit;
+    return bit;
+}
+
+} // namespace
+
+size_t LatencyHistogram::bucket_for(std::uint64_t nanoseconds) {
+    if (nanoseconds < kSubBuckets) return static_cast<size_t>(nanoseconds);
+
+    const int exponent = highest_bit(nanoseconds);
+    const int shift = exponent - 3;
+    const size_t sub = static_cast<size_t>((nanoseconds >> shift) & (kSubBuckets - 1));
+    const size_t bucket = static_cast<size_t>(exponent - 2) * kSubBuckets + sub;
+    return bucket < kBucketCount ? bucket : kBucketCount - 1;
+}
+
+std::uint64_t LatencyHistogram::upper_bound_of(size_t bucket) {
+    if (bucket < kSubBuckets) return bucket;
+
+    const int exponent = static_cast<int>(bucket / kSubBuckets) + 2;
+    const std::uint64_t sub = bucket % kSubBuckets;
+    const int shift = exponent - 3;
+    return ((kSubBuckets + sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(std::chrono::nanoseconds duration) {
+    const auto ticks = duration.count();
+    const std::uint64_t nanoseconds = ticks > 0 ? static_cast<std::uint64_t>(ticks) : 0;
+    buckets_[bucket_for(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::count() const {
+    std::uint64_t total = 0;
+    for (const auto& bucket : buckets_) {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+std::chrono::nanoseconds LatencyHistogram::percentile(double fraction) const {
+    const std::uint64_t total = count();
+    if (total == 0) return std::chrono::nanoseconds(0);
+
+    std::uint64_t rank = static_cast<std::uint64_t>(fraction * static_cast<double>(total));
+    if (rank >= total) rank = total - 1;
+
+    std::uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen > rank) return std::chrono::nanoseconds(upper_bound_of(i));
+    }
+    return std::chrono::nanoseconds(upper_bound_of(kBucketCount - 1));
+}
+
+} // namespace exterminate
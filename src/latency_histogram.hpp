@@ -0,0 +1,31 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace exterminate {
+
+// Lock-free log-linear histogram of nanosecond durations: every power of two
+// is split into 8 linear sub-buckets, so percentiles are accurate to ~12%.
+// Safe to record into from any number of threads.
+class LatencyHistogram {
+public:
+    void record(std::chrono::nanoseconds duration);
+
+    std::uint64_t count() const;
+    std::chrono::nanoseconds percentile(double fraction) const;
+
+private:
+    static constexpr size_t kSubBuckets = 8;
+    static constexpr size_t kBucketCount = 64 * kSubBuckets;
+
+    static size_t bucket_for(std::uint64_t nanoseconds);
+    static std::uint64_t upper_bound_of(size_t bucket);
+
+    std::array<std::atomic<std::uint64_t>, kBucketCount> buckets_{};
+};
+
+} // namespace exterminate
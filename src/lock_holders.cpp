@@ -0,0 +1,315 @@
+#include "lock_holders.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #define NOMINMAX
+  #include <windows.h>
+  #include <restartmanager.h>
+#else
+  #include <cerrno>
+  #include <csignal>
+  #include <cstdio>
+  #include <cstdlib>
+  #include <cstring>
+  #include <dirent.h>
+  #include <sys/stat.h>
+  #include <sys/types.h>
+  #include <unistd.h>
+#endif
+
+#ifdef __linux__
+  #include <sys/sysmacros.h>
+  #include <unordered_map>
+#endif
+
+namespace exterminate {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+#ifdef _WIN32
+std::error_code last_error() {
+    return std::error_code(static_cast<int>(GetLastError()), std::system_category());
+}
+
+// A session per path, since Restart Manager only reports which processes
+// hold any of a session's files, not which one each holds.
+std::vector<LockHolder> restart_manager_holders(const fs::path& path) {
+    DWORD session = 0;
+    WCHAR session_key[CCH_RM_SESSION_KEY + 1] = {};
+    if (RmStartSession(&session, 0, session_key) != ERROR_SUCCESS) return {};
+
+    std::vector<LockHolder> holders;
+    const std::wstring file = path.wstring();
+    LPCWSTR files[] = {file.c_str()};
+    if (RmRegisterResources(session, 1, files, 0, nullptr, 0, nullptr) == ERROR_SUCCESS) {
+        std::vector<RM_PROCESS_INFO> processes(8);
+        DWORD status = ERROR_MORE_DATA;
+        UINT count = 0;
+        while (status == ERROR_MORE_DATA) {
+            UINT needed = 0;
+            DWORD reasons = 0;
+            count = static_cast<UINT>(processes.size());
+            status = RmGetList(session, &needed, &count, processes.data(), &reasons);
+            if (status == ERROR_MORE_DATA) processes.resize(needed);
+        }
+
+        if (status == ERROR_SUCCESS) {
+            for (UINT i = 0; i < count; ++i) {
+                const RM_PROCESS_INFO& process = processes[i];
+                if (process.Process.dwProcessId == GetCurrentProcessId()) continue;
+                LockHolder holder;
+                holder.pid = process.Process.dwProcessId;
+                holder.name = fs::path(process.strAppName).string();
+                holder.critical = process.ApplicationType == RmCritical;
+                holders.push_back(std::move(holder));
+            }
+        }
+    }
+    RmEndSession(session);
+    return holders;
+}
+#endif
+
+#ifdef __linux__
+struct FileId {
+    std::uint64_t device = 0;
+    std::uint64_t inode = 0;
+
+    bool operator==(const FileId& other) const { return device == other.device && inode == other.inode; }
+};
+
+struct FileIdHash {
+    size_t operator()(const FileId& id) const { return std::hash<std::uint64_t>()(id.inode * 31 + id.device); }
+};
+
+// The paths asked about, by identity; a path given twice is looked up once.
+using WantedFiles = std::unordered_map<FileId, std::vector<size_t>, FileIdHash>;
+
+// (path index, pid) pairs.
+using HolderHits = std::vector<std::pair<size_t, std::uint32_t>>;
+
+bool parse_pid(const char* text, std::uint32_t& out_pid) {
+    if (*text == '\0') return false;
+    std::uint64_t value = 0;
+    for (const char* c = text; *c; ++c) {
+        if (*c < '0' || *c > '9') return false;
+        value = value * 10 + static_cast<std::uint64_t>(*c - '0');
+        if (value > 0xffffffffu) return false;
+    }
+    out_pid = static_cast<std::uint32_t>(value);
+    return true;
+}
+
+void scan_process(std::uint32_t pid, const WantedFiles& wanted, HolderHits& hits) {
+    const std::string base = "/proc/" + std::to_string(pid);
+    const auto note = [&](std::uint64_t device, std::uint64_t inode) {
+        const auto it = wanted.find(FileId{device, inode});
+        if (it == wanted.end()) return;
+        for (const size_t index : it->second) hits.emplace_back(index, pid);
+    };
+
+    struct stat info {};
+    if (::stat((base + "/cwd").c_str(), &info) == 0) note(info.st_dev, info.st_ino);
+
+    // stat follows each descriptor's link to the open file, deleted or not.
+    const std::string fd_directory = base + "/fd/";
+    if (DIR* descriptors = ::opendir(fd_directory.c_str())) {
+        while (const dirent* entry = ::readdir(descriptors)) {
+            if (entry->d_name[0] == '.') continue;
+            if (::stat((fd_directory + entry->d_name).c_str(), &info) == 0) note(info.st_dev, info.st_ino);
+        }
+        ::closedir(descriptors);
+    }
+
+    // Lines read "<range> <perms> <offset> <major>:<minor> <inode> [path]"
+    // in hex, hex and decimal; anonymous mappings have inode 0.
+    std::FILE* maps = std::fopen((base + "/maps").c_str(), "r");
+    if (!maps) return;
+    char* line = nullptr;
+    size_t capacity = 0;
+    while (::getline(&line, &capacity, maps) > 0) {
+        unsigned major_number = 0;
+        unsigned minor_number = 0;
+        unsigned long long inode = 0;
+        if (std::sscanf(line, "%*s %*s %*s %x:%x %llu", &major_number, &minor_number, &inode) == 3 && inode != 0) {
+            note(makedev(major_number, minor_number), inode);
+        }
+    }
+    std::free(line);
+    std::fclose(maps);
+}
+
+std::string process_name(std::uint32_t pid) {
+    std::string name;
+    if (std::FILE* comm = std::fopen(("/proc/" + std::to_string(pid) + "/comm").c_str(), "r")) {
+        char buffer[64] = {};
+        if (std::fgets(buffer, sizeof(buffer), comm)) name = buffer;
+        std::fclose(comm);
+    }
+    while (!name.empty() && name.back() == '\n') name.pop_back();
+    return name;
+}
+
+// Pids are scanned in chunks so a task is not just one small directory read.
+constexpr size_t kProcessesPerTask = 32;
+
+std::vector<std::vector<LockHolder>> proc_holders(const std::vector<fs::path>& paths, WorkPool& pool) {
+    std::vector<std::vector<LockHolder>> out(paths.size());
+    WantedFiles wanted;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        struct stat info {};
+        if (::lstat(paths[i].c_str(), &info) == 0) wanted[FileId{info.st_dev, info.st_ino}].push_back(i);
+    }
+    if (wanted.empty()) return out;
+
+    std::vector<std::uint32_t> pids;
+    const auto self = static_cast<std::uint32_t>(::getpid());
+    if (DIR* proc = ::opendir("/proc")) {
+        while (const dirent* entry = ::readdir(proc)) {
+            std::uint32_t pid = 0;
+            if (parse_pid(entry->d_name, pid) && pid != self) pids.push_back(pid);
+        }
+        ::closedir(proc);
+    }
+
+    std::mutex mutex;
+    HolderHits hits;
+    TaskGroup group;
+    for (size_t first = 0; first < pids.size(); first += kProcessesPerTask) {
+        pool.submit(group, [&, first] {
+            HolderHits local;
+            const size_t last = std::min(first + kProcessesPerTask, pids.size());
+            for (size_t i = first; i < last; ++i) {
+                scan_process(pids[i], wanted, local);
+            }
+            if (local.empty()) return;
+            std::lock_guard<std::mutex> lock(mutex);
+            hits.insert(hits.end(), local.begin(), local.end());
+        });
+    }
+    pool.wait(group);
+
+    std::sort(hits.begin(), hits.end());
+    hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+    for (const auto& hit : hits) {
+        LockHolder holder;
+        holder.pid = hit.second;
+        holder.name = process_name(hit.second);
+        out[hit.first].push_back(std::move(holder));
+    }
+    return out;
+}
+#endif
+
+#ifndef _WIN32
+// A zombie has already released everything it held.
+bool process_gone(pid_t pid) {
+    if (::kill(pid, 0) != 0) return errno == ESRCH;
+#ifdef __linux__
+    std::FILE* stat_file = std::fopen(("/proc/" + std::to_string(pid) + "/stat").c_str(), "r");
+    if (!stat_file) return true;
+    char buffer[512] = {};
+    const size_t read = std::fread(buffer, 1, sizeof(buffer) - 1, stat_file);
+    std::fclose(stat_file);
+    buffer[read] = '\0';
+    // The command name in parentheses may itself contain spaces or ')'.
+    const char* name_end = std::strrchr(buffer, ')');
+    return name_end && name_end[1] == ' ' && name_end[2] == 'Z';
+#else
+    return false;
+#endif
+}
+#endif
+
+} // namespace
+
+bool is_held_open(const std::error_code& ec) {
+#ifdef _WIN32
+    if (ec.category() == std::system_category()) {
+        return ec.value() == ERROR_SHARING_VIOLATION || ec.value() == ERROR_LOCK_VIOLATION ||
+               ec.value() == ERROR_USER_MAPPED_FILE;
+    }
+#endif
+    return ec == std::errc::device_or_resource_busy || ec == std::errc::text_file_busy;
+}
+
+std::vector<std::vector<LockHolder>> find_lock_holders(const std::vector<fs::path>& paths, WorkPool& pool) {
+#if defined(_WIN32)
+    (void)pool;
+    std::vector<std::vector<LockHolder>> out;
+    out.reserve(paths.size());
+    for (const auto& path : paths) {
+        out.push_back(restart_manager_holders(path));
+    }
+    return out;
+#elif defined(__linux__)
+    return proc_holders(paths, pool);
+#else
+    (void)pool;
+    return std::vector<std::vector<LockHolder>>(paths.size());
+#endif
+}
+
+bool end_lock_holder(const LockHolder& holder, std::chrono::milliseconds timeout, std::error_code& ec) {
+    ec.clear();
+#ifdef _WIN32
+    // 0 and 4 are the idle and System processes.
+    if (holder.critical || holder.pid == 0 || holder.pid == 4 || holder.pid == GetCurrentProcessId()) {
+        ec = std::make_error_code(std::errc::operation_not_permitted);
+        return false;
+    }
+
+    HANDLE process = OpenProcess(PROCESS_TERMINATE | SYNCHRONIZE, FALSE, holder.pid);
+    if (!process) {
+        ec = last_error();
+        return false;
+    }
+    bool ended = TerminateProcess(process, 1) != 0;
+    if (!ended) {
+        ec = last_error();
+    } else if (WaitForSingleObject(process, static_cast<DWORD>(timeout.count())) != WAIT_OBJECT_0) {
+        ec = std::make_error_code(std::errc::timed_out);
+        ended = false;
+    }
+    CloseHandle(process);
+    return ended;
+#else
+    const auto pid = static_cast<pid_t>(holder.pid);
+    if (holder.critical || pid <= 1 || pid == ::getpid()) {
+        ec = std::make_error_code(std::errc::operation_not_permitted);
+        return false;
+    }
+
+    if (::kill(pid, SIGTERM) != 0) {
+        if (errno == ESRCH) return true;
+        ec = std::error_code(errno, std::system_category());
+        return false;
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    bool killed = false;
+    while (!process_gone(pid)) {
+        const auto waited = std::chrono::steady_clock::now() - started;
+        if (waited >= timeout) {
+            ec = std::make_error_code(std::errc::timed_out);
+            return false;
+        }
+        if (!killed && waited >= timeout / 2) {
+            ::kill(pid, SIGKILL);
+            killed = true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+#endif
+}
+
+} // namespace exterminate
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "work_pool.hpp"
+
+namespace exterminate {
+
+struct LockHolder {
+    std::uint32_t pid = 0;
+    std::string name;
+    // Restart Manager reports the process as critical to the system. Such a
+    // process is never ended.
+    bool critical = false;
+};
+
+// True for the errors another process causes by having the entry open:
+// sharing and lock violations on Windows, EBUSY and ETXTBSY elsewhere.
+bool is_held_open(const std::error_code& ec);
+
+// Finds the processes holding each path, in the order given; a path nobody
+// holds gets an empty list. On Windows this asks Restart Manager, which
+// only knows about files. On Linux, the open descriptors, memory mappings
+// and working directories of every process are read once, in parallel on
+// the pool, into an inode-to-pid index for the paths asked about. Processes
+// this one may not inspect are left out, and so is this process.
+std::vector<std::vector<LockHolder>> find_lock_holders(const std::vector<std::filesystem::path>& paths,
+                                                       WorkPool& pool);
+
+// Ends the process and waits up to `timeout` for it to be gone. On POSIX it
+// gets SIGTERM first and SIGKILL once half the timeout has passed.
+bool end_lock_holder(const LockHolder& holder, std::chrono::milliseconds timeout, std::error_code& ec);
+
+} // namespace exterminate
@@ -0,0 +1,358 @@
+#include "native_delete.hpp"
+
+#include "dir_handle.hpp"
+#include "io_throttle.hpp"
+#include "latency_histogram.hpp"
+#include "progress.hpp"
+#include "shred.hpp"
+#include "startup_profile.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <vector>
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #define NOMINMAX
+  #include <windows.h>
+#endif
+
+namespace exterminate {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// A directory is removed by whichever task drops its counter to zero: one
+// count for its own enumeration plus one per child directory still pending.
+// Its handle stays open until then so children can be opened and removed
+// relative to it.
+struct DirNode {
+    DirHandle handle;
+    NativeName name;
+    std::shared_ptr<DirNode> parent;
+    std::atomic<size_t> remaining{1};
+    PathGuard::Cursor guard;
+    // Only kept up when progress is counted.
+    size_t depth = 0;
+    std::atomic<std::uint64_t> entries_below{0};
+};
+
+struct TreeContext {
+    TreeContext(WorkPool& owner, const TreeDeleteOptions& delete_options, fs::path base_path)
+        : pool(owner), options(delete_options), base(std::move(base_path)) {}
+
+    WorkPool& pool;
+    const TreeDeleteOptions& options;
+    fs::path base;
+    TaskGroup group;
+    std::atomic<size_t> removed{0};
+    std::atomic<std::uint64_t> bytes{0};
+    std::atomic<size_t> failures{0};
+};
+
+fs::path strip_trailing_separator(const fs::path& path) {
+    if (path.has_filename() || !path.has_parent_path()) return path;
+    return path.parent_path();
+}
+
+DirHandle open_parent_directory(const fs::path& path, std::error_code& ec) {
+    fs::path parent = path.parent_path();
+    if (parent.empty()) parent = fs::path(".");
+    return DirHandle::open(parent, ec);
+}
+
+template <typename Remove>
+bool timed_remove(const TreeContext& context, Remove&& remove) {
+    if (!context.options.latency) {
+        const bool removed = remove();
+        if (removed) note_mutation();
+        return removed;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const bool removed = remove();
+    context.options.latency->record(std::chrono::steady_clock::now() - start);
+    if (removed) note_mutation();
+    return removed;
+}
+
+// Failures are rare, so paths are only rebuilt from the node chain when one
+// has to be reported.
+fs::path path_of(const TreeContext& context, const DirNode& node) {
+    std::vector<const NativeName*> names;
+    for (const DirNode* current = &node; current->parent; current = current->parent.get()) {
+        names.push_back(&current->name);
+    }
+
+    fs::path out = context.base;
+    for (auto it = names.rbegin(); it != names.rend(); ++it) {
+        out /= **it;
+    }
+    return out;
+}
+
+// Sizes come with the enumeration on Windows. Elsewhere they cost a stat, so
+// they are only looked up when bytes are counted or limited.
+std::uint64_t removal_size(const TreeContext& context, const DirHandle& directory, const DirEntry& entry) {
+    if (entry.size_known) return entry.size;
+    const IoThrottle* throttle = context.options.throttle;
+    if (!context.options.count_bytes && !(throttle && throttle->limits_bytes())) return 0;
+
+    std::uint64_t size = 0;
+    std::int64_t modified = 0;
+    std::error_code ec;
+    return directory.entry_status(entry.name, size, modified, ec) ? size : 0;
+}
+
+void report_failure(const TreeContext& context, fs::path path, bool directory, const std::error_code& ec) {
+    if (!context.options.failures) return;
+    context.options.failures->add(DeleteFailure{std::move(path), directory, ec});
+}
+
+void finish_directory(TreeContext& context, std::shared_ptr<DirNode> node) {
+    DeleteProgress* progress = context.options.progress;
+    while (node->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        node->handle.close();
+
+        std::shared_ptr<DirNode> parent = std::move(node->parent);
+        if (!parent) break;
+
+        if (progress) {
+            const std::uint64_t below = node->entries_below.load(std::memory_order_relaxed);
+            progress->finish_subtree(node->depth, below);
+            parent->entries_below.fetch_add(below, std::memory_order_relaxed);
+        }
+
+        std::error_code ec;
+        if (context.options.throttle) context.options.throttle->acquire(1, 0);
+        if (timed_remove(context, [&] { return parent->handle.remove_directory(node->name, ec); })) {
+            context.removed.fetch_add(1, std::memory_order_relaxed);
+            if (context.options.progress) context.options.progress->add_removed(1, 0);
+        } else {
+            context.failures.fetch_add(1, std::memory_order_relaxed);
+            if (!is_directory_not_empty(ec)) report_failure(context, path_of(context, *parent) / node->name, true, ec);
+        }
+        node = std::move(parent);
+    }
+}
+
+// Holds a count on its directory, as a pending child directory does, so the
+// handle stays open until the file is gone.
+void shred_file(TreeContext& context, const std::shared_ptr<DirNode>& node, const DirEntry& entry) {
+    std::error_code ec;
+    if (context.options.shred->overwrite(node->handle, entry.name, ec)) {
+        const std::uint64_t size = removal_size(context, node->handle, entry);
+        if (context.options.throttle) context.options.throttle->acquire(1, size);
+        if (timed_remove(context, [&] { return node->handle.remove_file(entry.name, ec); })) {
+            context.removed.fetch_add(1, std::memory_order_relaxed);
+            context.bytes.fetch_add(size, std::memory_order_relaxed);
+            if (context.options.progress) context.options.progress->add_removed(1, size);
+        }
+    }
+    if (ec) {
+        context.failures.fetch_add(1, std::memory_order_relaxed);
+        report_failure(context, path_of(context, *node) / entry.name, false, ec);
+    }
+    finish_directory(context, node);
+}
+
+void process_directory(TreeContext& context, const std::shared_ptr<DirNode>& node) {
+    std::error_code ec;
+    node->handle = node->parent->handle.open_child(node->name, ec);
+
+    size_t removed = 0;
+    size_t failures = 0;
+    if (!ec) {
+        DirReader reader(node->handle);
+        std::vector<DirEntry> batch;
+        const PathGuard* guard = node->guard.empty() ? nullptr : context.options.guard;
+        PathGuard::Cursor child_guard;
+        DeleteProgress* progress = context.options.progress;
+        while (reader.next_batch(batch, ec)) {
+            const size_t removed_before = removed;
+            std::uint64_t bytes = 0;
+            size_t directories = 0;
+            for (auto& entry : batch) {
+                if (guard && guard->protects(node->guard, entry.name, entry.directory ? &child_guard : nullptr)) {
+                    ++failures;
+                    report_failure(context, path_of(context, *node) / entry.name, entry.directory,
+                                   protected_entry_error());
+                    continue;
+                }
+
+                if (entry.directory) {
+                    auto child = std::make_shared<DirNode>();
+                    child->name = std::move(entry.name);
+                    child->parent = node;
+                    if (guard) child->guard = std::move(child_guard);
+                    child->depth = node->depth + 1;
+                    node->remaining.fetch_add(1, std::memory_order_relaxed);
+                    ++directories;
+                    context.pool.submit(context.group, [&context, child] { process_directory(context, child); });
+                    continue;
+                }
+
+                if (context.options.shred) {
+                    node->remaining.fetch_add(1, std::memory_order_relaxed);
+                    context.pool.submit(context.group, [&context, node, file = std::move(entry)] {
+                        shred_file(context, node, file);
+                    });
+                    continue;
+                }
+
+                std::error_code remove_ec;
+                const std::uint64_t size = removal_size(context, node->handle, entry);
+                if (context.options.throttle) context.options.throttle->acquire(1, size);
+                if (timed_remove(context, [&] { return node->handle.remove_file(entry.name, remove_ec); })) {
+                    ++removed;
+                    bytes += size;
+                } else {
+                    ++failures;
+                    report_failure(context, path_of(context, *node) / entry.name, false, remove_ec);
+                }
+            }
+            if (bytes > 0) context.bytes.fetch_add(bytes, std::memory_order_relaxed);
+            if (progress) {
+                progress->add_listed(batch.size());
+                node->entries_below.fetch_add(batch.size(), std::memory_order_relaxed);
+                if (directories > 0) progress->add_directories_found(node->depth + 1, directories);
+                progress->add_removed(removed - removed_before, bytes);
+            }
+            if (ec) break;
+        }
+    }
+    if (ec) {
+        ++failures;
+        report_failure(context, path_of(context, *node), true, ec);
+    }
+    if (context.options.progress) context.options.progress->finish_listing(node->depth);
+
+    context.removed.fetch_add(removed, std::memory_order_relaxed);
+    context.failures.fetch_add(failures, std::memory_order_relaxed);
+    finish_directory(context, node);
+}
+
+} // namespace
+
+void count_failure_class(std::vector<FailureClass>& classes, const std::error_code& error, size_t count) {
+    for (auto& known : classes) {
+        if (known.error == error) {
+            known.count += count;
+            return;
+        }
+    }
+    classes.push_back(FailureClass{error, count});
+}
+
+// Threads share a slot only past kSlots of them, so its lock is normally
+// uncontended.
+DeleteFailureLog::Slot& DeleteFailureLog::local() {
+    static std::atomic<size_t> next_slot{0};
+    thread_local const size_t slot = next_slot.fetch_add(1, std::memory_order_relaxed) % kSlots;
+    return slots_[slot];
+}
+
+void DeleteFailureLog::add(DeleteFailure failure) {
+    Slot& slot = local();
+    std::lock_guard<std::mutex> lock(slot.mutex);
+    if (slot.failures.size() < kSlotCapacity) {
+        slot.failures.push_back(std::move(failure));
+    } else {
+        count_failure_class(slot.dropped, failure.error);
+    }
+}
+
+std::vector<DeleteFailure> DeleteFailureLog::take() {
+    std::vector<DeleteFailure> out;
+    for (auto& slot : slots_) {
+        std::lock_guard<std::mutex> lock(slot.mutex);
+        if (out.empty()) {
+            out = std::move(slot.failures);
+        } else {
+            out.insert(out.end(), std::make_move_iterator(slot.failures.begin()),
+                       std::make_move_iterator(slot.failures.end()));
+        }
+        slot.failures.clear();
+    }
+    return out;
+}
+
+std::vector<FailureClass> DeleteFailureLog::take_dropped() {
+    std::vector<FailureClass> out;
+    for (auto& slot : slots_) {
+        std::lock_guard<std::mutex> lock(slot.mutex);
+        for (const auto& dropped : slot.dropped) {
+            count_failure_class(out, dropped.error, dropped.count);
+        }
+        slot.dropped.clear();
+    }
+    return out;
+}
+
+bool is_access_denied(const std::error_code& ec) {
+#ifdef _WIN32
+    if (ec.category() == std::system_category() && ec.value() == ERROR_ACCESS_DENIED) return true;
+#endif
+    return ec == std::errc::permission_denied || ec == std::errc::operation_not_permitted;
+}
+
+bool is_directory_not_empty(const std::error_code& ec) {
+#ifdef _WIN32
+    if (ec.category() == std::system_category() && ec.value() == ERROR_DIR_NOT_EMPTY) return true;
+#endif
+    return ec == std::errc::directory_not_empty || ec == std::errc::file_exists;
+}
+
+NativeDeleteStats delete_tree_parallel(const fs::path& root, WorkPool& pool, const TreeDeleteOptions& options) {
+    static std::once_flag handle_limit_once;
+    std::call_once(handle_limit_once, raise_open_handle_limit);
+
+    NativeDeleteStats stats;
+    const fs::path target = strip_trailing_separator(root);
+
+    // The anchor is the target's parent: it only holds the handle the target
+    // is removed relative to and is never removed itself.
+    auto anchor = std::make_shared<DirNode>();
+    std::error_code ec;
+    anchor->handle = open_parent_directory(target, ec);
+    if (ec) {
+        stats.failures = 1;
+        if (options.failures) options.failures->add(DeleteFailure{target, true, ec});
+        return stats;
+    }
+
+    auto top = std::make_shared<DirNode>();
+    top->name = target.filename().native();
+    top->parent = anchor;
+    if (options.guard) top->guard = options.guard_cursor;
+    anchor->remaining.fetch_add(1, std::memory_order_relaxed);
+
+    TreeContext context(pool, options, target.parent_path());
+    if (options.progress) options.progress->add_directories_found(0, 1);
+    pool.submit(context.group, [&context, top] { process_directory(context, top); });
+    pool.wait(context.group);
+
+    stats.entries_removed = context.removed.load();
+    stats.bytes_removed = context.bytes.load();
+    stats.failures = context.failures.load();
+    return stats;
+}
+
+bool delete_file_native(const fs::path& path, std::error_code& ec, const Shredder* shred) {
+    const fs::path target = strip_trailing_separator(path);
+    const DirHandle parent = open_parent_directory(target, ec);
+    if (ec) return false;
+    const NativeName name = target.filename().native();
+    if (shred && !shred->overwrite(parent, name, ec)) return false;
+    if (!parent.remove_file(name, ec)) return false;
+    note_mutation();
+    return true;
+}
+
+} // namespace exterminate
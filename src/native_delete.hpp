@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <system_error>
+#include <vector>
+
+#include "path_guard.hpp"
+#include "work_pool.hpp"
+
+namespace exterminate {
+
+class DeleteProgress;
+class IoThrottle;
+class LatencyHistogram;
+class Shredder;
+
+struct NativeDeleteStats {
+    size_t entries_removed = 0;
+    // Sizes of the files removed, as far as they were known.
+    std::uint64_t bytes_removed = 0;
+    // Set once a tool that does not report sizes removed part of the target.
+    bool bytes_unknown = false;
+    size_t failures = 0;
+};
+
+// An entry an engine could not remove. For a directory this is either its
+// enumeration or its own removal; directories that only failed because a
+// child survived are not reported.
+struct DeleteFailure {
+    std::filesystem::path path;
+    bool directory = false;
+    std::error_code error;
+};
+
+// How many failures had one error.
+struct FailureClass {
+    std::error_code error;
+    size_t count = 0;
+};
+
+// Adds `count` failures with `error` to the matching class, or a new one.
+void count_failure_class(std::vector<FailureClass>& classes, const std::error_code& error, size_t count = 1);
+
+// Safe to add to from any number of threads. Each thread appends to its own
+// slot, so workers do not wait on each other; take() merges the slots. A
+// slot keeps the first kSlotCapacity failures in full and only counts the
+// rest by error, so a tree where everything fails stays bounded.
+class DeleteFailureLog {
+public:
+    static constexpr size_t kSlotCapacity = 1024;
+
+    void add(DeleteFailure failure);
+    std::vector<DeleteFailure> take();
+    // The failures take() did not return, by error.
+    std::vector<FailureClass> take_dropped();
+
+private:
+    struct alignas(64) Slot {
+        std::mutex mutex;
+        std::vector<DeleteFailure> failures;
+        std::vector<FailureClass> dropped;
+    };
+
+    static constexpr size_t kSlots = 16;
+
+    Slot& local();
+
+    std::array<Slot, kSlots> slots_{};
+};
+
+bool is_access_denied(const std::error_code& ec);
+bool is_directory_not_empty(const std::error_code& ec);
+
+struct TreeDeleteOptions {
+    // When set, the duration of every unlink and rmdir is recorded here.
+    LatencyHistogram* latency = nullptr;
+    // When set, every entry that could not be removed is reported here.
+    DeleteFailureLog* failures = nullptr;
+    // When set, entries the guard protects are kept and reported with
+    // protected_entry_error(). `guard_cursor` is where it stands at the root.
+    const PathGuard* guard = nullptr;
+    PathGuard::Cursor guard_cursor;
+    // When set, every unlink and rmdir waits for its tokens first.
+    IoThrottle* throttle = nullptr;
+    // When set, removals and listings are counted here as they happen.
+    DeleteProgress* progress = nullptr;
+    // Look up the size of every file removed where the enumeration does not
+    // report it (everywhere but Windows), at the cost of a stat each.
+    bool count_bytes = false;
+    // When set, every file is overwritten before it is removed, each in its
+    // own task so several are in flight at once.
+    const Shredder* shred = nullptr;
+};
+
+NativeDeleteStats delete_tree_parallel(const std::filesystem::path& root, WorkPool& pool,
+                                       const TreeDeleteOptions& options = {});
+// With `shred`, the contents are overwritten first; a file that could not be
+// overwritten is kept.
+bool delete_file_native(const std::filesystem::path& path, std::error_code& ec, const Shredder* shred = nullptr);
+
+} // namespace exterminate
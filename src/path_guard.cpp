@@ -0,0 +1,397 @@
+#include "path_guard.hpp"
+
+#include "paths.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+#ifdef _WIN32
+  #include <cwctype>
+#endif
+
+namespace exterminate {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using Char = NativeName::value_type;
+
+#ifdef _WIN32
+constexpr Char kSeparator = L'\\';
+const NativeName kShareRoot = L"\\\\";
+#else
+constexpr Char kSeparator = '/';
+const NativeName kFilesystemRoot = "/";
+#endif
+
+enum class PatternKind {
+    Relative,
+    Absolute,
+    Floating,
+};
+
+bool has_wildcard(const NativeName& component) {
+    return component.find_first_of(NativeName{Char('*'), Char('?')}) != NativeName::npos;
+}
+
+bool is_any_depth(const NativeName& component) {
+    return component.size() == 2 && component[0] == Char('*') && component[1] == Char('*');
+}
+
+// The root is its own first component ("/", "c:" or "\\" for a share), so
+// patterns and paths are matched from the same place. "." is dropped and
+// ".." is resolved lexically.
+PatternKind split_components(NativeName text, std::vector<NativeName>& out) {
+    out.clear();
+    size_t pos = 0;
+    PatternKind kind = PatternKind::Relative;
+
+#ifdef _WIN32
+    std::replace(text.begin(), text.end(), L'/', L'\\');
+    if (text.rfind(L"\\\\?\\UNC\\", 0) == 0) {
+        text.erase(2, 6);
+    } else if (text.rfind(L"\\\\?\\", 0) == 0) {
+        text.erase(0, 4);
+    }
+
+    if (text.rfind(kShareRoot, 0) == 0) {
+        out.push_back(kShareRoot);
+        pos = 2;
+        kind = PatternKind::Absolute;
+    } else if (text.size() >= 2 && text[1] == L':' && (text.size() == 2 || text[2] == L'\\')) {
+        out.push_back(fold_name_case(text.substr(0, 2)));
+        pos = 2;
+        kind = PatternKind::Absolute;
+    }
+#else
+    if (!text.empty() && text[0] == '/') {
+        out.push_back(kFilesystemRoot);
+        pos = 1;
+        kind = PatternKind::Absolute;
+    }
+#endif
+
+    const size_t rooted = out.size();
+    while (pos <= text.size()) {
+        size_t end = text.find(kSeparator, pos);
+        if (end == NativeName::npos) end = text.size();
+        NativeName component = text.substr(pos, end - pos);
+        pos = end + 1;
+
+        if (component.empty() || component == NativeName{Char('.')}) continue;
+        if (component == NativeName{Char('.'), Char('.')}) {
+            if (out.size() > rooted) out.pop_back();
+            continue;
+        }
+        out.push_back(fold_name_case(std::move(component)));
+    }
+
+    if (kind == PatternKind::Relative && !out.empty() && is_any_depth(out.front())) kind = PatternKind::Floating;
+    return kind;
+}
+
+#ifdef _WIN32
+std::string expand_pattern(const std::string& pattern) {
+    return expand_environment_variables(pattern);
+}
+#else
+// $NAME and ${NAME}. An unset variable is left as written, which leaves the
+// pattern relative so it is skipped rather than widened.
+std::string expand_pattern(const std::string& pattern) {
+    std::string out;
+    size_t pos = 0;
+    while (pos < pattern.size()) {
+        const size_t dollar = pattern.find('$', pos);
+        if (dollar == std::string::npos) break;
+        out.append(pattern, pos, dollar - pos);
+
+        const bool braced = dollar + 1 < pattern.size() && pattern[dollar + 1] == '{';
+        size_t name_start = dollar + (braced ? 2 : 1);
+        size_t name_end = name_start;
+        while (name_end < pattern.size() &&
+               (std::isalnum(static_cast<unsigned char>(pattern[name_end])) || pattern[name_end] == '_')) {
+            ++name_end;
+        }
+        size_t next = name_end;
+        if (braced) {
+            if (name_end >= pattern.size() || pattern[name_end] != '}') name_end = name_start;
+            next = name_end + 1;
+        }
+
+        const char* value = name_end > name_start ? std::getenv(pattern.substr(name_start, name_end - name_start).c_str())
+                                                  : nullptr;
+        if (value && *value) {
+            out += value;
+            pos = next;
+        } else {
+            out.push_back('$');
+            pos = dollar + 1;
+        }
+    }
+    out.append(pattern, pos, std::string::npos);
+    return out;
+}
+#endif
+
+class ProtectedEntryCategory : public std::error_category {
+public:
+    const char* name() const noexcept override { return "exterminate.protected"; }
+    std::string message(int) const override { return "protected path"; }
+};
+
+const ProtectedEntryCategory& protected_entry_category() {
+    static const ProtectedEntryCategory category;
+    return category;
+}
+
+} // namespace
+
+bool glob_match_name(const NativeName& pattern, const NativeName& text) {
+    size_t p = 0;
+    size_t t = 0;
+    size_t star = NativeName::npos;
+    size_t resume = 0;
+    while (t < text.size()) {
+        if (p < pattern.size() && (pattern[p] == Char('?') || pattern[p] == text[t])) {
+            ++p;
+            ++t;
+        } else if (p < pattern.size() && pattern[p] == Char('*')) {
+            star = p++;
+            resume = t;
+        } else if (star != NativeName::npos) {
+            p = star + 1;
+            t = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == Char('*')) ++p;
+    return p == pattern.size();
+}
+
+NativeName fold_name_case(NativeName text) {
+#ifdef _WIN32
+    for (auto& c : text) c = static_cast<Char>(std::towlower(c));
+#endif
+    return text;
+}
+
+std::shared_ptr<const PathGuard> PathGuard::compile(const std::vector<std::string>& patterns,
+                                                    std::vector<size_t>& out_rejected) {
+    auto guard = std::make_shared<PathGuard>();
+    guard->add_node(false, false, 0);
+
+    std::vector<NativeName> components;
+    for (size_t i = 0; i < patterns.size(); ++i) {
+        const std::string expanded = expand_pattern(patterns[i]);
+        if (split_components(fs::path(expanded).native(), components) == PatternKind::Relative) {
+            out_rejected.push_back(i);
+            continue;
+        }
+        guard->patterns_.push_back(expanded);
+        guard->insert(components, guard->patterns_.size() - 1);
+    }
+
+    guard->add_state(guard->start_, 0);
+    return guard;
+}
+
+std::uint32_t PathGuard::add_node(bool loops, bool floating, size_t origin) {
+    Node node;
+    node.loops = loops;
+    node.floating = floating;
+    node.origin = origin;
+    nodes_.push_back(std::move(node));
+    return static_cast<std::uint32_t>(nodes_.size() - 1);
+}
+
+void PathGuard::insert(const std::vector<NativeName>& components, size_t pattern) {
+    std::uint32_t current = 0;
+    for (const auto& component : components) {
+        const bool floating = nodes_[current].floating;
+        if (is_any_depth(component)) {
+            if (nodes_[current].loops) continue;
+            if (nodes_[current].any_depth == kNoNode) {
+                const std::uint32_t child = add_node(true, true, pattern);
+                nodes_[current].any_depth = child;
+            }
+            current = nodes_[current].any_depth;
+            continue;
+        }
+
+        if (has_wildcard(component)) {
+            auto& globs = nodes_[current].globs;
+            const auto existing = std::find_if(globs.begin(), globs.end(),
+                                               [&](const auto& glob) { return glob.first == component; });
+            if (existing != globs.end()) {
+                current = existing->second;
+                continue;
+            }
+            const std::uint32_t child = add_node(false, floating, pattern);
+            nodes_[current].globs.emplace_back(component, child);
+            current = child;
+            continue;
+        }
+
+        const auto existing = nodes_[current].literals.find(component);
+        if (existing != nodes_[current].literals.end()) {
+            current = existing->second;
+            continue;
+        }
+        const std::uint32_t child = add_node(false, floating, pattern);
+        nodes_[current].literals.emplace(component, child);
+        current = child;
+    }
+
+    if (nodes_[current].pattern < 0) nodes_[current].pattern = static_cast<int>(pattern);
+}
+
+// Entering a node also enters the "**" below it, which can match nothing.
+void PathGuard::add_state(Cursor& cursor, std::uint32_t state) const {
+    while (state != kNoNode) {
+        if (std::find(cursor.begin(), cursor.end(), state) != cursor.end()) return;
+        cursor.push_back(state);
+        state = nodes_[state].any_depth;
+    }
+}
+
+void PathGuard::step(const Cursor& from, const NativeName& component, Cursor& out) const {
+    out.clear();
+    for (const std::uint32_t state : from) {
+        const Node& node = nodes_[state];
+        if (node.loops) add_state(out, state);
+
+        const auto literal = node.literals.find(component);
+        if (literal != node.literals.end()) add_state(out, literal->second);
+
+        for (const auto& [glob, child] : node.globs) {
+            if (glob_match_name(glob, component)) add_state(out, child);
+        }
+    }
+}
+
+bool PathGuard::allows(const fs::path& path, Cursor& out_inside, std::string& out_reason) const {
+    out_inside.clear();
+
+    std::vector<NativeName> components;
+    split_components(path.native(), components);
+
+    Cursor current = start_;
+    Cursor next;
+    for (const auto& component : components) {
+        step(current, component, next);
+        current.swap(next);
+        if (current.empty()) return true;
+    }
+
+    for (const std::uint32_t state : current) {
+        if (nodes_[state].pattern >= 0) {
+            out_reason = "is protected by \"" + patterns_[static_cast<size_t>(nodes_[state].pattern)] + "\"";
+            return false;
+        }
+    }
+    for (const std::uint32_t state : current) {
+        if (!nodes_[state].floating) {
+            out_reason = "contains \"" + patterns_[nodes_[state].origin] + "\", which is protected";
+            return false;
+        }
+    }
+
+    out_inside = std::move(current);
+    return true;
+}
+
+PathGuard::Cursor PathGuard::cursor_for(const fs::path& path) const {
+    std::vector<NativeName> components;
+    split_components(path.native(), components);
+
+    Cursor current = start_;
+    Cursor next;
+    for (const auto& component : components) {
+        step(current, component, next);
+        current.swap(next);
+        if (current.empty()) break;
+    }
+    return current;
+}
+
+bool PathGuard::above_protected(const Cursor& cursor) const {
+    return std::any_of(cursor.begin(), cursor.end(), [this](std::uint32_t state) { return !nodes_[state].floating; });
+}
+
+bool PathGuard::protects(const Cursor& parent, const NativeName& name, Cursor* out_child) const {
+    Cursor next;
+    if (!parent.empty()) {
+#ifdef _WIN32
+        step(parent, fold_name_case(name), next);
+#else
+        step(parent, name, next);
+#endif
+    }
+
+    for (const std::uint32_t state : next) {
+        if (nodes_[state].pattern >= 0) return true;
+    }
+    if (out_child) *out_child = std::move(next);
+    return false;
+}
+
+std::error_code protected_entry_error() {
+    return std::error_code(1, protected_entry_category());
+}
+
+bool is_protected_entry(const std::error_code& ec) {
+    return ec.category() == protected_entry_category();
+}
+
+std::vector<std::string> builtin_protected_paths() {
+#ifdef _WIN32
+    return {
+        "?:\\",
+        "\\\\*\\*",
+        "%SystemRoot%",
+        "%SystemRoot%\\System32",
+        "%SystemRoot%\\SysWOW64",
+        "%SystemRoot%\\WinSxS",
+        "%ProgramFiles%",
+        "%ProgramFiles(x86)%",
+        "%ProgramData%",
+        "%SystemDrive%\\Users\\*",
+        "%USERPROFILE%",
+    };
+#else
+    return {
+        "/",
+        "/bin",
+        "/boot",
+        "/dev/**",
+        "/etc",
+        "/home/*",
+        "/lib",
+        "/lib32",
+        "/lib64",
+        "/opt",
+        "/proc/**",
+        "/root",
+        "/run",
+        "/sbin",
+        "/srv",
+        "/sys/**",
+        "/usr/*",
+        "/var/*",
+        "/mnt/*",
+        "/media/*/*",
+        "/run/media/*/*",
+        "/Applications",
+        "/Library",
+        "/System/**",
+        "/Users/*",
+        "/Volumes/*",
+        "$HOME",
+    };
+#endif
+}
+
+} // namespace exterminate
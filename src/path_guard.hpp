@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "dir_handle.hpp"
+
+namespace exterminate {
+
+// Deny-list of paths and globs that are never deleted, compiled into a trie
+// of path components. "*" and "?" match within one component and a "**"
+// component matches any number of them; matching ignores case on Windows.
+// A pattern protects what it matches and every directory above it, so only
+// patterns containing "**" can match inside a target that is allowed.
+class PathGuard {
+public:
+    // The trie states still alive after a prefix of a path. Empty once no
+    // pattern can match anything below that prefix, which makes the check
+    // free for the rest of the subtree.
+    using Cursor = std::vector<std::uint32_t>;
+
+    // Environment variables are expanded ($NAME on POSIX). Patterns that are
+    // not absolute and do not start with "**" are skipped; their indices are
+    // returned in out_rejected.
+    static std::shared_ptr<const PathGuard> compile(const std::vector<std::string>& patterns,
+                                                    std::vector<size_t>& out_rejected);
+
+    // False when the absolute path is protected or deleting it would remove a
+    // protected path; out_reason then names the pattern. Otherwise out_inside
+    // is the cursor for the entries below the path.
+    bool allows(const std::filesystem::path& path, Cursor& out_inside, std::string& out_reason) const;
+
+    // True when the entry `name` below a directory at `parent` is protected.
+    // Otherwise out_child, when given, receives the cursor for its entries.
+    bool protects(const Cursor& parent, const NativeName& name, Cursor* out_child) const;
+
+    // The cursor for the entries below an absolute path, without refusing
+    // anything. For walks that only remove some of what they visit.
+    Cursor cursor_for(const std::filesystem::path& path) const;
+    // True when a directory at `cursor` lies above a protected path, so it
+    // must not be removed even if it ends up empty.
+    bool above_protected(const Cursor& cursor) const;
+
+private:
+    static constexpr std::uint32_t kNoNode = 0xffffffffu;
+
+    struct Node {
+        std::unordered_map<NativeName, std::uint32_t> literals;
+        std::vector<std::pair<NativeName, std::uint32_t>> globs;
+        // The "**" component directly below this one.
+        std::uint32_t any_depth = kNoNode;
+        bool loops = false;
+        // Below a "**", so it can match at any depth inside a target.
+        bool floating = false;
+        // Set on the node a pattern ends at.
+        int pattern = -1;
+        // The first pattern that passes through this node.
+        size_t origin = 0;
+    };
+
+    std::uint32_t add_node(bool loops, bool floating, size_t origin);
+    void insert(const std::vector<NativeName>& components, size_t pattern);
+    void add_state(Cursor& cursor, std::uint32_t state) const;
+    void step(const Cursor& from, const NativeName& component, Cursor& out) const;
+
+    std::vector<Node> nodes_;
+    std::vector<std::string> patterns_;
+    Cursor start_;
+};
+
+// '*' matches any run within one name and '?' one character. Both sides
+// must already be case-folded with fold_name_case.
+bool glob_match_name(const NativeName& pattern, const NativeName& name);
+// Lower-cases on Windows, where names compare case-insensitively.
+NativeName fold_name_case(NativeName name);
+
+// Reported for an entry the guard kept. Such entries are neither repaired
+// nor retried.
+std::error_code protected_entry_error();
+bool is_protected_entry(const std::error_code& ec);
+
+// Protected regardless of the config: filesystem, drive and share roots,
+// system directories and user profile roots.
+std::vector<std::string> builtin_protected_paths();
+
+} // namespace exterminate
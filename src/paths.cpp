@@ -3,13 +3,14 @@
 #include <algorithm>
 #include <array>
 #include <cctype>
-#include <fstream>
 #include <string>
 
 #ifdef _WIN32
   #define WIN32_LEAN_AND_MEAN
   #define NOMINMAX
   #include <windows.h>
+#else
+  #include <unistd.h>
 #endif
 
 namespace exterminate {
@@ -34,7 +35,10 @@ fs::path get_executable_path() {
     if (length == 0 || length >= buffer.size()) return fs::path();
     return fs::path(std::string(buffer.data(), length));
 #else
-    return fs::path();
+    std::array<char, 4096> buffer{};
+    const ssize_t length = ::readlink("/proc/self/exe", buffer.data(), buffer.size());
+    if (length <= 0 || static_cast<size_t>(length) >= buffer.size()) return fs::path();
+    return fs::path(std::string(buffer.data(), static_cast<size_t>(length)));
 #endif
 }
 
@@ -60,6 +64,18 @@ std::string get_local_app_data() {
 #endif
 }
 
+fs::path get_state_directory() {
+#ifdef _WIN32
+    return fs::path(get_local_app_data()) / "Exterminate";
+#else
+    const char* state_home = std::getenv("XDG_STATE_HOME");
+    if (state_home && *state_home) return fs::path(state_home) / "exterminate";
+    const char* home = std::getenv("HOME");
+    if (home && *home) return fs::path(home) / ".local" / "state" / "exterminate";
+    return fs::temp_directory_path() / "exterminate";
+#endif
+}
+
 std::string expand_environment_variables(const std::string& value) {
 #ifdef _WIN32
     if (value.empty()) return value;
@@ -93,33 +109,6 @@ std::string normalize_path_token(std::string value) {
     return value;
 }
 
-bool files_identical(const fs::path& lhs, const fs::path& rhs) {
-    std::error_code ec;
-    if (!fs::exists(lhs, ec) || !fs::exists(rhs, ec) || ec) return false;
-    const auto lhs_size = fs::file_size(lhs, ec);
-    if (ec) return false;
-    const auto rhs_size = fs::file_size(rhs, ec);
-    if (ec || lhs_size != rhs_size) return false;
-
-    std::ifstream a(lhs, std::ios::binary);
-    std::ifstream b(rhs, std::ios::binary);
-    if (!a.is_open() || !b.is_open()) return false;
-
-    std::array<char, 8192> ab{};
-    std::array<char, 8192> bb{};
-    while (a && b) {
-        a.read(ab.data(), static_cast<std::streamsize>(ab.size()));
-        b.read(bb.data(), static_cast<std::streamsize>(bb.size()));
-        const auto ac = a.gcount();
-        const auto bc = b.gcount();
-        if (ac != bc) return false;
-        if (ac <= 0) break;
-        if (!std::equal(ab.begin(), ab.begin() + ac, bb.begin())) return false;
-    }
-
-    return true;
-}
-
 fs::path resolve_install_dir(const AppConfig& config) {
     const std::string expanded = expand_environment_variables(config.install_directory);
     std::error_code ec;
@@ -148,13 +137,19 @@ fs::path resolve_target_path(const std::string& input) {
         path = fs::current_path() / path;
     }
 
+    // Only the parent is resolved through links: a link or junction named as
+    // the target is deleted as the link, never as the directory it points to.
+    while (!path.has_filename() && path.has_relative_path()) path = path.parent_path();
+    const fs::path name = path.filename();
+    const bool plain_name = !name.empty() && name != "." && name != "..";
+
     std::error_code ec;
-    path = fs::weakly_canonical(path, ec);
-    if (!ec) return path;
+    const fs::path resolved = fs::weakly_canonical(plain_name ? path.parent_path() : path, ec);
+    if (!ec) return plain_name ? resolved / name : resolved;
 
     ec.clear();
     path = fs::absolute(path, ec);
-    return path;
+    return path.lexically_normal();
 }
 
 std::string to_verbatim_path(const fs::path& path) {
@@ -10,10 +10,11 @@ namespace exterminate {
 std::filesystem::path get_executable_path();
 std::string get_base_directory();
 std::string get_local_app_data();
+// Per-user directory for state kept between runs; may not exist yet.
+std::filesystem::path get_state_directory();
 
 std::string expand_environment_variables(const std::string& value);
 std::string normalize_path_token(std::string value);
-bool files_identical(const std::filesystem::path& lhs, const std::filesystem::path& rhs);
 
 std::filesystem::path resolve_install_dir(const AppConfig& config);
 std::filesystem::path resolve_wrapper_bin_dir(const AppConfig& config);
@@ -0,0 +1,139 @@
+#include "windows_env.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+  #include <sys/syscall.h>
+#endif
+
+namespace exterminate {
+
+bool is_running_as_admin() {
+    return ::geteuid() == 0;
+}
+
+int relaunch_as_admin(const std::vector<std::string>&) {
+    std::cerr << "error: automatic elevation is not supported on this platform; re-run with sudo.\n";
+    return 1;
+}
+
+bool is_standalone_console() {
+    return false;
+}
+
+bool has_console_window() {
+    return ::isatty(STDIN_FILENO) != 0;
+}
+
+bool enable_ansi_colors() {
+    return ::isatty(STDOUT_FILENO) != 0 || ::isatty(STDERR_FILENO) != 0;
+}
+
+void wait_for_key() {
+    std::cout << "\nPress any key to close...\n";
+    std::cin.get();
+}
+
+int run_hidden_process(const std::string& file_name, const std::vector<std::string>& args) {
+    std::vector<char*> argv;
+    argv.reserve(args.size() + 2);
+    argv.push_back(const_cast<char*>(file_name.c_str()));
+    for (const auto& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    const pid_t child = ::fork();
+    if (child < 0) return -1;
+    if (child == 0) {
+        const int null_fd = ::open("/dev/null", O_RDWR);
+        if (null_fd >= 0) {
+            ::dup2(null_fd, STDIN_FILENO);
+            ::dup2(null_fd, STDOUT_FILENO);
+            ::dup2(null_fd, STDERR_FILENO);
+        }
+        ::execvp(argv[0], argv.data());
+        ::_exit(127);
+    }
+
+    int status = 0;
+    if (::waitpid(child, &status, 0) < 0) return -1;
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    return -1;
+}
+
+bool spawn_detached_process(const std::string& file_name, const std::vector<std::string>& args) {
+    std::vector<char*> argv;
+    argv.reserve(args.size() + 2);
+    argv.push_back(const_cast<char*>(file_name.c_str()));
+    for (const auto& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    // Double fork: the intermediate child exits at once, so the worker is
+    // reparented to init and never lingers as a zombie of this process.
+    const pid_t child = ::fork();
+    if (child < 0) return false;
+    if (child == 0) {
+        ::setsid();
+        const pid_t worker = ::fork();
+        if (worker != 0) ::_exit(worker < 0 ? 1 : 0);
+
+        const int null_fd = ::open("/dev/null", O_RDWR);
+        if (null_fd >= 0) {
+            ::dup2(null_fd, STDIN_FILENO);
+            ::dup2(null_fd, STDOUT_FILENO);
+            ::dup2(null_fd, STDERR_FILENO);
+        }
+        ::execv(argv[0], argv.data());
+        ::_exit(127);
+    }
+
+    int status = 0;
+    if (::waitpid(child, &status, 0) < 0) return false;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+void enter_background_mode() {
+    ::setpriority(PRIO_PROCESS, 0, 19);
+#if defined(__linux__) && defined(SYS_ioprio_set)
+    constexpr int kIoprioWhoProcess = 1;
+    constexpr int kIoprioClassIdle = 3;
+    constexpr int kIoprioClassShift = 13;
+    ::syscall(SYS_ioprio_set, kIoprioWhoProcess, 0, kIoprioClassIdle << kIoprioClassShift);
+#endif
+}
+
+bool command_exists_on_path(const std::string& command_name) {
+    const char* path_env = std::getenv("PATH");
+    if (!path_env || !*path_env) return false;
+
+    std::istringstream path_stream(path_env);
+    std::string directory;
+    while (std::getline(path_stream, directory, ':')) {
+        if (directory.empty()) continue;
+        const auto candidate = std::filesystem::path(directory) / command_name;
+        if (::access(candidate.c_str(), X_OK) == 0) return true;
+    }
+    return false;
+}
+
+bool ensure_user_path_entry(const std::string&) {
+    return false;
+}
+
+bool remove_user_path_entry(const std::string&) {
+    return false;
+}
+
+void broadcast_environment_change() {}
+
+} // namespace exterminate
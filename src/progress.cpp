@@ -0,0 +1,201 @@
+#include "progress.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+  #include <io.h>
+#endif
+
+namespace exterminate {
+
+namespace {
+
+// Weight of the newest interval in the smoothed rate.
+constexpr double kRateSmoothing = 0.3;
+
+bool parse_descriptor(const std::string& text, int& out_fd) {
+    if (text.empty() || text.size() > 9) return false;
+    int value = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') return false;
+        value = value * 10 + (c - '0');
+    }
+    out_fd = value;
+    return true;
+}
+
+} // namespace
+
+DeleteProgress::Slot& DeleteProgress::local() {
+    static std::atomic<size_t> next_slot{0};
+    thread_local const size_t slot = next_slot.fetch_add(1, std::memory_order_relaxed) % kSlots;
+    return slots_[slot];
+}
+
+void DeleteProgress::add_removed(std::uint64_t entries, std::uint64_t bytes) {
+    Slot& slot = local();
+    if (entries > 0) slot.removed.fetch_add(entries, std::memory_order_relaxed);
+    if (bytes > 0) slot.bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void DeleteProgress::add_listed(std::uint64_t entries) {
+    if (entries > 0) local().listed.fetch_add(entries, std::memory_order_relaxed);
+}
+
+void DeleteProgress::add_directories_found(size_t depth, std::uint64_t directories) {
+    local().found[std::min(depth, kDepths - 1)].fetch_add(directories, std::memory_order_relaxed);
+}
+
+void DeleteProgress::finish_listing(size_t depth) {
+    local().opened[std::min(depth, kDepths - 1)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void DeleteProgress::finish_subtree(size_t depth, std::uint64_t entries) {
+    Slot& slot = local();
+    depth = std::min(depth, kDepths - 1);
+    slot.finished[depth].fetch_add(1, std::memory_order_relaxed);
+    if (entries > 0) slot.finished_entries[depth].fetch_add(entries, std::memory_order_relaxed);
+}
+
+DeleteProgress::Sample DeleteProgress::sample() const {
+    Sample out;
+    std::array<std::uint64_t, kDepths> found{};
+    std::array<std::uint64_t, kDepths> opened{};
+    for (const auto& slot : slots_) {
+        out.removed += slot.removed.load(std::memory_order_relaxed);
+        out.bytes += slot.bytes.load(std::memory_order_relaxed);
+        out.listed += slot.listed.load(std::memory_order_relaxed);
+        for (size_t depth = 0; depth < kDepths; ++depth) {
+            found[depth] += slot.found[depth].load(std::memory_order_relaxed);
+            opened[depth] += slot.opened[depth].load(std::memory_order_relaxed);
+            out.finished[depth] += slot.finished[depth].load(std::memory_order_relaxed);
+            out.finished_entries[depth] += slot.finished_entries[depth].load(std::memory_order_relaxed);
+        }
+    }
+    // The slots are read one after another, so a directory may already show
+    // as opened but not yet as found.
+    for (size_t depth = 0; depth < kDepths; ++depth) {
+        out.unlisted[depth] = found[depth] > opened[depth] ? found[depth] - opened[depth] : 0;
+    }
+    return out;
+}
+
+ProgressReporter::ProgressReporter(const DeleteProgress& progress, std::chrono::milliseconds interval, Sink sink)
+    : progress_(progress),
+      interval_(interval),
+      sink_(std::move(sink)),
+      started_(std::chrono::steady_clock::now()),
+      last_time_(started_),
+      thread_([this] { run(); }) {}
+
+ProgressReporter::~ProgressReporter() {
+    stop();
+}
+
+void ProgressReporter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) return;
+        stopping_ = true;
+    }
+    stop_cv_.notify_all();
+    thread_.join();
+    sink_(take_snapshot(std::chrono::steady_clock::now()), true);
+}
+
+void ProgressReporter::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_cv_.wait_for(lock, interval_, [this] { return stopping_; })) {
+        lock.unlock();
+        sink_(take_snapshot(std::chrono::steady_clock::now()), false);
+        lock.lock();
+    }
+}
+
+ProgressSnapshot ProgressReporter::take_snapshot(std::chrono::steady_clock::time_point now) {
+    const DeleteProgress::Sample sample = progress_.sample();
+
+    ProgressSnapshot out;
+    out.elapsed_seconds = std::chrono::duration<double>(now - started_).count();
+    out.removed = sample.removed;
+    out.bytes = sample.bytes;
+
+    // A depth nothing has finished at yet borrows the nearest deeper average
+    // and, failing that, the nearest shallower one.
+    double remaining = sample.listed > sample.removed ? static_cast<double>(sample.listed - sample.removed) : 0.0;
+    bool estimated = true;
+    for (size_t depth = 0; depth < DeleteProgress::kDepths; ++depth) {
+        if (sample.unlisted[depth] == 0) continue;
+        out.pending_directories += sample.unlisted[depth];
+
+        size_t basis = depth;
+        while (basis + 1 < DeleteProgress::kDepths && sample.finished[basis] == 0) ++basis;
+        if (sample.finished[basis] == 0) {
+            basis = depth;
+            while (basis > 0 && sample.finished[basis] == 0) --basis;
+        }
+        if (sample.finished[basis] == 0) {
+            estimated = false;
+            continue;
+        }
+        const double per_directory =
+            static_cast<double>(sample.finished_entries[basis]) / static_cast<double>(sample.finished[basis]);
+        remaining += per_directory * static_cast<double>(sample.unlisted[depth]);
+    }
+
+    const double interval = std::chrono::duration<double>(now - last_time_).count();
+    if (interval > 0) {
+        const double current = static_cast<double>(sample.removed - std::min(sample.removed, last_removed_)) / interval;
+        rate_ = last_time_ == started_ ? current : rate_ + kRateSmoothing * (current - rate_);
+    }
+    last_time_ = now;
+    last_removed_ = sample.removed;
+    out.rate = rate_;
+
+    if (estimated && rate_ > 0) out.eta_seconds = remaining / rate_;
+    return out;
+}
+
+std::string format_progress_event(const ProgressSnapshot& snapshot, bool final) {
+    char buffer[256];
+    std::snprintf(buffer, sizeof(buffer),
+                  "{\"event\":\"%s\",\"elapsed_s\":%.3f,\"removed\":%llu,\"bytes\":%llu,\"pending_dirs\":%llu,"
+                  "\"rate\":%.1f,\"eta_s\":",
+                  final ? "done" : "progress", snapshot.elapsed_seconds,
+                  static_cast<unsigned long long>(snapshot.removed), static_cast<unsigned long long>(snapshot.bytes),
+                  static_cast<unsigned long long>(snapshot.pending_directories), snapshot.rate);
+    std::string out = buffer;
+    if (snapshot.eta_seconds < 0 || final) {
+        out += "null";
+    } else {
+        std::snprintf(buffer, sizeof(buffer), "%.1f", snapshot.eta_seconds);
+        out += buffer;
+    }
+    out += "}\n";
+    return out;
+}
+
+std::FILE* open_progress_stream(const std::string& spec, std::string& out_error) {
+    std::FILE* stream = nullptr;
+    int fd = -1;
+    if (spec.rfind("fd:", 0) == 0) {
+        if (!parse_descriptor(spec.substr(3), fd)) {
+            out_error = "invalid descriptor for --progress-json: " + spec;
+            return nullptr;
+        }
+#ifdef _WIN32
+        stream = _fdopen(fd, "w");
+#else
+        stream = fdopen(fd, "w");
+#endif
+    } else {
+        stream = std::fopen(spec.c_str(), "w");
+    }
+
+    if (!stream) out_error = "failed to open progress stream " + spec + ": " + std::strerror(errno);
+    return stream;
+}
+
+} // namespace exterminate
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace exterminate {
+
+// Counters the engines bump as they go. Every thread adds to its own
+// cache-line aligned slot, so counting costs an uncontended relaxed add;
+// sample() sums the slots. Directories are counted per depth below the
+// target (deeper ones share the last), which is what the estimate of the
+// work left is built from.
+class DeleteProgress {
+public:
+    static constexpr size_t kDepths = 16;
+
+    struct Sample {
+        std::uint64_t removed = 0;
+        // Only files whose size came with the enumeration (Windows) or was
+        // looked up anyway are counted.
+        std::uint64_t bytes = 0;
+        std::uint64_t listed = 0;
+        // Found but not opened yet, so nothing below them is known.
+        std::array<std::uint64_t, kDepths> unlisted{};
+        // Directories whose whole subtree is gone, and the entries that were
+        // below them.
+        std::array<std::uint64_t, kDepths> finished{};
+        std::array<std::uint64_t, kDepths> finished_entries{};
+    };
+
+    void add_removed(std::uint64_t entries, std::uint64_t bytes);
+    // One batch of a directory's entries.
+    void add_listed(std::uint64_t entries);
+    void add_directories_found(size_t depth, std::uint64_t directories);
+    void finish_listing(size_t depth);
+    // `entries` counts everything that was below the directory.
+    void finish_subtree(size_t depth, std::uint64_t entries);
+
+    Sample sample() const;
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<std::uint64_t> removed{0};
+        std::atomic<std::uint64_t> bytes{0};
+        std::atomic<std::uint64_t> listed{0};
+        std::array<std::atomic<std::uint64_t>, kDepths> found{};
+        std::array<std::atomic<std::uint64_t>, kDepths> opened{};
+        std::array<std::atomic<std::uint64_t>, kDepths> finished{};
+        std::array<std::atomic<std::uint64_t>, kDepths> finished_entries{};
+    };
+
+    static constexpr size_t kSlots = 64;
+
+    Slot& local();
+
+    std::array<Slot, kSlots> slots_{};
+};
+
+struct ProgressSnapshot {
+    double elapsed_seconds = 0;
+    std::uint64_t removed = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t pending_directories = 0;
+    // Smoothed removals per second.
+    double rate = 0;
+    // Negative until there is enough to go on.
+    double eta_seconds = -1;
+};
+
+// Samples the counters on its own thread at a fixed interval and hands each
+// snapshot to the sink, then a final one from stop(). There is no pre-scan:
+// the entries still to go are the ones listed but not removed yet, plus, for
+// every directory not listed yet, the average subtree of the directories
+// already finished at its depth.
+class ProgressReporter {
+public:
+    using Sink = std::function<void(const ProgressSnapshot& snapshot, bool final)>;
+
+    ProgressReporter(const DeleteProgress& progress, std::chrono::milliseconds interval, Sink sink);
+    ~ProgressReporter();
+
+    ProgressReporter(const ProgressReporter&) = delete;
+    ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+    void stop();
+
+private:
+    void run();
+    ProgressSnapshot take_snapshot(std::chrono::steady_clock::time_point now);
+
+    const DeleteProgress& progress_;
+    std::chrono::milliseconds interval_;
+    Sink sink_;
+    std::chrono::steady_clock::time_point started_;
+    std::chrono::steady_clock::time_point last_time_;
+    std::uint64_t last_removed_ = 0;
+    double rate_ = 0;
+    std::mutex mutex_;
+    std::condition_variable stop_cv_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+// One NDJSON line: {"event":"progress"|"done", ...}.
+std::string format_progress_event(const ProgressSnapshot& snapshot, bool final);
+
+// "fd:N" for an inherited descriptor, otherwise a path (a FIFO or named pipe
+// works). Returns nullptr and sets out_error on failure.
+std::FILE* open_progress_stream(const std::string& spec, std::string& out_error);
+
+} // namespace exterminate
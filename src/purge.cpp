@@ -0,0 +1,322 @@
+#include "purge.hpp"
+
+#include "startup_profile.hpp"
+
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <system_error>
+
+namespace exterminate {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// A directory is finished by whichever task drops its counter to zero, like
+// in the parallel delete engine. `kept` counts the entries still in it; it
+// is only removed when that is zero and the purge removed something from it,
+// so directories that were empty to begin with stay.
+struct PurgeNode {
+    DirHandle handle;
+    NativeName name;
+    std::shared_ptr<PurgeNode> parent;
+    std::atomic<size_t> remaining{1};
+    std::atomic<size_t> kept{0};
+    std::atomic<bool> emptied{false};
+    PathGuard::Cursor guard;
+    bool removable = true;
+};
+
+struct PurgeContext {
+    PurgeContext(WorkPool& owner, const PurgeRules& purge_rules, const PurgeOptions& purge_options, fs::path root)
+        : pool(owner), rules(purge_rules), options(purge_options), base(std::move(root)) {}
+
+    WorkPool& pool;
+    const PurgeRules& rules;
+    const PurgeOptions& options;
+    fs::path base;
+    std::int64_t cutoff = 0;
+    TaskGroup group;
+    std::atomic<size_t> examined{0};
+    std::atomic<size_t> files_removed{0};
+    std::atomic<size_t> directories_removed{0};
+    std::atomic<std::uint64_t> bytes_removed{0};
+    std::atomic<size_t> failures{0};
+};
+
+fs::path path_of(const PurgeContext& context, const PurgeNode& node) {
+    std::vector<const NativeName*> names;
+    for (const PurgeNode* current = &node; current->parent; current = current->parent.get()) {
+        names.push_back(&current->name);
+    }
+
+    fs::path out = context.base;
+    for (auto it = names.rbegin(); it != names.rend(); ++it) {
+        out /= **it;
+    }
+    return out;
+}
+
+void report_failure(PurgeContext& context, fs::path path, bool directory, const std::error_code& ec) {
+    context.failures.fetch_add(1, std::memory_order_relaxed);
+    if (context.options.failures) context.options.failures->add(DeleteFailure{std::move(path), directory, ec});
+}
+
+bool matches_name(const PurgeRules& rules, const NativeName& name) {
+    if (rules.name_patterns.empty()) return true;
+#ifdef _WIN32
+    const NativeName folded = fold_name_case(name);
+#else
+    const NativeName& folded = name;
+#endif
+    for (const auto& pattern : rules.name_patterns) {
+        if (glob_match_name(pattern, folded)) return true;
+    }
+    return false;
+}
+
+// The name is checked first, so only files whose name matched are statted
+// (for the age and size rules and the byte count). On Windows size and
+// write time come with the enumeration and nothing is statted.
+bool purge_file(PurgeContext& context, PurgeNode& node, const DirEntry& entry) {
+    const PurgeRules& rules = context.rules;
+    if (!matches_name(rules, entry.name)) return false;
+
+    std::uint64_t size = entry.size;
+    std::int64_t modified = entry.modified;
+    if (!entry.size_known || !entry.modified_known) {
+        std::error_code ec;
+        if (!node.handle.entry_status(entry.name, size, modified, ec)) {
+            if (ec != std::errc::no_such_file_or_directory) {
+                report_failure(context, path_of(context, node) / entry.name, false, ec);
+            }
+            return ec == std::errc::no_such_file_or_directory;
+        }
+    }
+
+    if (rules.by_age && modified >= context.cutoff) return false;
+    if (rules.by_size && size <= rules.larger_than_bytes) return false;
+
+    if (context.options.throttle) context.options.throttle->acquire(1, size);
+    std::error_code ec;
+    if (!node.handle.remove_file(entry.name, ec)) {
+        if (ec == std::errc::no_such_file_or_directory) return true;
+        report_failure(context, path_of(context, node) / entry.name, false, ec);
+        return false;
+    }
+    note_mutation();
+    context.files_removed.fetch_add(1, std::memory_order_relaxed);
+    context.bytes_removed.fetch_add(size, std::memory_order_relaxed);
+    return true;
+}
+
+void finish_directory(PurgeContext& context, std::shared_ptr<PurgeNode> node) {
+    while (node->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        node->handle.close();
+
+        std::shared_ptr<PurgeNode> parent = std::move(node->parent);
+        if (!parent) break;
+
+        bool removed = false;
+        if (node->removable && node->emptied.load(std::memory_order_relaxed) &&
+            node->kept.load(std::memory_order_relaxed) == 0) {
+            std::error_code ec;
+            if (context.options.throttle) context.options.throttle->acquire(1, 0);
+            removed = parent->handle.remove_directory(node->name, ec);
+            if (removed) {
+                note_mutation();
+                context.directories_removed.fetch_add(1, std::memory_order_relaxed);
+            } else if (!is_directory_not_empty(ec)) {
+                report_failure(context, path_of(context, *parent) / node->name, true, ec);
+            }
+        }
+        if (removed) {
+            parent->emptied.store(true, std::memory_order_relaxed);
+        } else {
+            parent->kept.fetch_add(1, std::memory_order_relaxed);
+        }
+        node = std::move(parent);
+    }
+}
+
+void process_directory(PurgeContext& context, const std::shared_ptr<PurgeNode>& node) {
+    std::error_code ec;
+    if (node->parent) node->handle = node->parent->handle.open_child(node->name, ec);
+
+    size_t examined = 0;
+    size_t kept = 0;
+    bool emptied = false;
+    if (!ec) {
+        DirReader reader(node->handle);
+        std::vector<DirEntry> batch;
+        const PathGuard* guard = node->guard.empty() ? nullptr : context.options.guard;
+        PathGuard::Cursor child_guard;
+        while (reader.next_batch(batch, ec)) {
+            for (auto& entry : batch) {
+                if (guard && guard->protects(node->guard, entry.name, entry.directory ? &child_guard : nullptr)) {
+                    ++kept;
+                    continue;
+                }
+
+                if (entry.directory) {
+                    auto child = std::make_shared<PurgeNode>();
+                    child->name = std::move(entry.name);
+                    child->parent = node;
+                    if (guard) {
+                        child->removable = !guard->above_protected(child_guard);
+                        child->guard = std::move(child_guard);
+                    }
+                    node->remaining.fetch_add(1, std::memory_order_relaxed);
+                    context.pool.submit(context.group, [&context, child] { process_directory(context, child); });
+                    continue;
+                }
+
+                ++examined;
+                if (purge_file(context, *node, entry)) {
+                    emptied = true;
+                } else {
+                    ++kept;
+                }
+            }
+            if (ec) break;
+        }
+    }
+    if (ec) {
+        ++kept;
+        report_failure(context, path_of(context, *node), true, ec);
+    }
+
+    context.examined.fetch_add(examined, std::memory_order_relaxed);
+    if (kept > 0) node->kept.fetch_add(kept, std::memory_order_relaxed);
+    if (emptied) node->emptied.store(true, std::memory_order_relaxed);
+    finish_directory(context, node);
+}
+
+std::int64_t unix_now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+bool parse_number(const std::string& text, size_t& pos, std::uint64_t& out_value) {
+    const size_t start = pos;
+    out_value = 0;
+    while (pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos]))) {
+        if (out_value > (~std::uint64_t{0} - 9) / 10) return false;
+        out_value = out_value * 10 + static_cast<std::uint64_t>(text[pos] - '0');
+        ++pos;
+    }
+    return pos > start;
+}
+
+std::string lower_suffix(const std::string& text, size_t pos) {
+    std::string suffix;
+    for (size_t i = pos; i < text.size(); ++i) {
+        suffix.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(text[i]))));
+    }
+    return suffix;
+}
+
+} // namespace
+
+bool parse_purge_age(const std::string& text, std::int64_t& out_seconds) {
+    size_t pos = 0;
+    std::uint64_t value = 0;
+    if (!parse_number(text, pos, value)) return false;
+
+    const std::string unit = lower_suffix(text, pos);
+    std::uint64_t scale = 0;
+    if (unit.empty() || unit == "d") {
+        scale = 86400;
+    } else if (unit == "w") {
+        scale = 7 * 86400;
+    } else if (unit == "h") {
+        scale = 3600;
+    } else if (unit == "m") {
+        scale = 60;
+    } else if (unit == "s") {
+        scale = 1;
+    } else {
+        return false;
+    }
+
+    if (value > static_cast<std::uint64_t>(unix_now()) / scale + 1) return false;
+    out_seconds = static_cast<std::int64_t>(value * scale);
+    return true;
+}
+
+bool parse_purge_size(const std::string& text, std::uint64_t& out_bytes) {
+    size_t pos = 0;
+    std::uint64_t value = 0;
+    if (!parse_number(text, pos, value)) return false;
+
+    std::string unit = lower_suffix(text, pos);
+    if (unit.size() == 3 && unit[1] == 'i' && unit[2] == 'b') {
+        unit.resize(1);
+    } else if (unit.size() == 2 && unit[1] == 'b') {
+        unit.resize(1);
+    }
+
+    int shift = 0;
+    if (unit.empty() || unit == "b") {
+        shift = 0;
+    } else if (unit == "k") {
+        shift = 10;
+    } else if (unit == "m") {
+        shift = 20;
+    } else if (unit == "g") {
+        shift = 30;
+    } else if (unit == "t") {
+        shift = 40;
+    } else {
+        return false;
+    }
+
+    if (shift > 0 && value > (~std::uint64_t{0} >> shift)) return false;
+    out_bytes = value << shift;
+    return true;
+}
+
+void add_purge_patterns(const std::string& text, PurgeRules& rules) {
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find('|', start);
+        if (end == std::string::npos) end = text.size();
+        const std::string pattern = text.substr(start, end - start);
+        if (!pattern.empty()) rules.name_patterns.push_back(fold_name_case(fs::path(pattern).native()));
+        start = end + 1;
+    }
+}
+
+PurgeStats purge_tree(const fs::path& root, const PurgeRules& rules, WorkPool& pool, const PurgeOptions& options) {
+    static std::once_flag handle_limit_once;
+    std::call_once(handle_limit_once, raise_open_handle_limit);
+
+    PurgeStats stats;
+    PurgeContext context(pool, rules, options, root);
+    context.cutoff = unix_now() - rules.older_than_seconds;
+
+    auto top = std::make_shared<PurgeNode>();
+    std::error_code ec;
+    top->handle = DirHandle::open(root, ec);
+    if (ec) {
+        stats.failures = 1;
+        if (options.failures) options.failures->add(DeleteFailure{root, true, ec});
+        return stats;
+    }
+    if (options.guard) top->guard = options.guard->cursor_for(root);
+
+    pool.submit(context.group, [&context, top] { process_directory(context, top); });
+    pool.wait(context.group);
+
+    stats.files_examined = context.examined.load();
+    stats.files_removed = context.files_removed.load();
+    stats.directories_removed = context.directories_removed.load();
+    stats.bytes_removed = context.bytes_removed.load();
+    stats.failures = context.failures.load();
+    return stats;
+}
+
+} // namespace exterminate
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "dir_handle.hpp"
+#include "io_throttle.hpp"
+#include "native_delete.hpp"
+#include "path_guard.hpp"
+#include "work_pool.hpp"
+
+namespace exterminate {
+
+// Every rule that is set must hold for a file to be removed. Directories are
+// never matched themselves; they are removed once the purge has emptied them.
+struct PurgeRules {
+    bool by_age = false;
+    std::int64_t older_than_seconds = 0;
+    bool by_size = false;
+    std::uint64_t larger_than_bytes = 0;
+    // Any one may match the file name; folded with fold_name_case.
+    std::vector<NativeName> name_patterns;
+
+    bool empty() const { return !by_age && !by_size && name_patterns.empty(); }
+};
+
+// "14d", "12h", "30m", "90s" or "2w"; a bare number is days.
+bool parse_purge_age(const std::string& text, std::int64_t& out_seconds);
+// "1GiB", "500M", "64k" (binary units) or a bare byte count.
+bool parse_purge_size(const std::string& text, std::uint64_t& out_bytes);
+// "*.tmp|*.log".
+void add_purge_patterns(const std::string& text, PurgeRules& rules);
+
+struct PurgeStats {
+    size_t files_examined = 0;
+    size_t files_removed = 0;
+    size_t directories_removed = 0;
+    std::uint64_t bytes_removed = 0;
+    size_t failures = 0;
+};
+
+struct PurgeOptions {
+    // Protected entries are left alone together with everything below them.
+    const PathGuard* guard = nullptr;
+    DeleteFailureLog* failures = nullptr;
+    // When set, every unlink and rmdir waits for its tokens first.
+    IoThrottle* throttle = nullptr;
+};
+
+// One parallel pass over the directory `root`: every file is matched as it
+// is enumerated and removed straight away. The root itself is kept.
+PurgeStats purge_tree(const std::filesystem::path& root, const PurgeRules& rules, WorkPool& pool,
+                      const PurgeOptions& options = {});
+
+} // namespace exterminate
@@ -0,0 +1,154 @@
+#include "result_json.hpp"
+
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+namespace exterminate {
+
+namespace {
+
+std::string seconds_value(std::chrono::nanoseconds duration) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.6f", std::chrono::duration<double>(duration).count());
+    return buffer;
+}
+
+void write_stages(std::ostream& out, const std::vector<StageTiming>& stages) {
+    out << "[";
+    for (size_t i = 0; i < stages.size(); ++i) {
+        const StageTiming& timing = stages[i];
+        if (i > 0) out << ",";
+        out << "{\"stage\":\"" << json_escape(timing.stage) << "\",\"runs\":" << timing.runs
+            << ",\"duration_s\":" << seconds_value(timing.duration) << "}";
+    }
+    out << "]";
+}
+
+void write_error(std::ostream& out, const std::error_code& error) {
+    out << "\"error\":\"" << json_escape(describe_failure_error(error)) << "\",\"code\":";
+    if (error) {
+        out << error.value();
+    } else {
+        out << "null";
+    }
+}
+
+void write_failure_classes(std::ostream& out, const std::vector<FailureClass>& classes) {
+    out << "[";
+    for (size_t i = 0; i < classes.size(); ++i) {
+        if (i > 0) out << ",";
+        out << "{";
+        write_error(out, classes[i].error);
+        out << ",\"count\":" << classes[i].count << "}";
+    }
+    out << "]";
+}
+
+void write_holders(std::ostream& out, const std::vector<LockHolder>& holders) {
+    out << "[";
+    for (size_t i = 0; i < holders.size(); ++i) {
+        if (i > 0) out << ",";
+        out << "{\"pid\":" << holders[i].pid << ",\"name\":\"" << json_escape(holders[i].name) << "\"}";
+    }
+    out << "]";
+}
+
+size_t count_left(const std::vector<FailureClass>& classes) {
+    size_t left = 0;
+    for (const auto& failure_class : classes) {
+        left += failure_class.count;
+    }
+    return left;
+}
+
+// A sum an external tool contributed to is short by an unknown amount, so it
+// is written as null rather than as a number that reads as exact.
+void write_bytes(std::ostream& out, std::uint64_t bytes, bool known) {
+    if (known) {
+        out << bytes;
+    } else {
+        out << "null";
+    }
+}
+
+} // namespace
+
+void ResultJson::add(const DeleteResult& result) {
+    if (!result.success) {
+        ++failed_;
+    } else if (result.already_gone) {
+        ++already_gone_;
+    } else {
+        ++deleted_;
+    }
+    entries_removed_ += result.entries_removed;
+    bytes_freed_ += result.bytes_freed;
+    bytes_known_ = bytes_known_ && result.bytes_known;
+    for (const FailureClass& failure_class : result.failure_classes) {
+        count_failure_class(failure_classes_, failure_class.error, failure_class.count);
+    }
+
+    for (const StageTiming& timing : result.stages) {
+        auto it = std::find_if(stages_.begin(), stages_.end(),
+                               [&](const StageTiming& existing) { return existing.stage == timing.stage; });
+        if (it == stages_.end()) {
+            stages_.push_back(timing);
+        } else {
+            it->runs += timing.runs;
+            it->duration += timing.duration;
+        }
+    }
+    results_.push_back(result);
+}
+
+void ResultJson::write(std::ostream& out, std::chrono::nanoseconds wall) const {
+    out << "{\"targets\":[";
+    for (size_t i = 0; i < results_.size(); ++i) {
+        const DeleteResult& result = results_[i];
+        out << (i == 0 ? "\n" : ",\n");
+        out << "{\"path\":\"" << json_escape(result.target.string()) << "\""
+            << ",\"success\":" << (result.success ? "true" : "false")
+            << ",\"already_gone\":" << (result.already_gone ? "true" : "false") << ",\"message\":\""
+            << json_escape(result.message) << "\",\"entries_removed\":" << result.entries_removed << ",\"bytes_freed\":";
+        write_bytes(out, result.bytes_freed, result.bytes_known);
+        out << ",\"attempts\":" << result.attempts << ",\"final_stage\":";
+        if (result.final_stage.empty()) {
+            out << "null";
+        } else {
+            out << "\"" << json_escape(result.final_stage) << "\"";
+        }
+        out << ",\"duration_s\":" << seconds_value(result.duration) << ",\"stages\":";
+        write_stages(out, result.stages);
+        out << ",\"entries_left\":" << count_left(result.failure_classes) << ",\"failures\":[";
+        for (size_t j = 0; j < result.failures.size(); ++j) {
+            const FailedEntry& failure = result.failures[j];
+            if (j > 0) out << ",";
+            out << "{\"path\":\"" << json_escape(failure.path.string())
+                << "\",\"directory\":" << (failure.directory ? "true" : "false") << ",";
+            write_error(out, failure.error);
+            out << ",\"stage\":\"" << json_escape(failure.stage) << "\",\"holders\":";
+            write_holders(out, failure.holders);
+            out << "}";
+        }
+        out << "],\"failure_classes\":";
+        write_failure_classes(out, result.failure_classes);
+        out << ",\"ended_holders\":";
+        write_holders(out, result.ended_holders);
+        out << "}";
+    }
+    out << "\n],\n\"aggregate\":{\"targets\":" << results_.size() << ",\"deleted\":" << deleted_
+        << ",\"already_gone\":" << already_gone_ << ",\"failed\":" << failed_
+        << ",\"entries_removed\":" << entries_removed_ << ",\"bytes_freed\":";
+    write_bytes(out, bytes_freed_, bytes_known_);
+    out << ",\"duration_s\":" << seconds_value(wall) << ",\"stages\":";
+    write_stages(out, stages_);
+    out << ",\"entries_left\":" << count_left(failure_classes_) << ",\"failure_classes\":";
+    write_failure_classes(out, failure_classes_);
+    out << "}}\n";
+    out.flush();
+}
+
+} // namespace exterminate
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "delete_engine.hpp"
+
+namespace exterminate {
+
+// Collects the results of one run for --output json and writes them as a
+// single document: one record per target plus an aggregate whose stage
+// timings and failure classes are summed. Not thread-safe; results arrive through
+// the serialized result sinks.
+class ResultJson {
+public:
+    void add(const DeleteResult& result);
+    // `wall` is the run's elapsed time; targets deleted concurrently make the
+    // per-target durations add up to more than that.
+    void write(std::ostream& out, std::chrono::nanoseconds wall) const;
+
+private:
+    std::vector<DeleteResult> results_;
+    std::vector<StageTiming> stages_;
+    std::vector<FailureClass> failure_classes_;
+    size_t deleted_ = 0;
+    size_t already_gone_ = 0;
+    size_t failed_ = 0;
+    size_t entries_removed_ = 0;
+    std::uint64_t bytes_freed_ = 0;
+    bool bytes_known_ = true;
+};
+
+} // namespace exterminate
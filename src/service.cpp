@@ -0,0 +1,700 @@
+#include "service.hpp"
+
+#include "paths.hpp"
+#include "windows_env.hpp"
+#include "work_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #define NOMINMAX
+  #include <windows.h>
+#else
+  #include <cerrno>
+  #include <fcntl.h>
+  #include <poll.h>
+  #include <sys/socket.h>
+  #include <sys/stat.h>
+  #include <sys/un.h>
+  #include <unistd.h>
+#endif
+
+namespace exterminate {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// A multi-select launches one client per item within a few milliseconds of
+// each other; a batch is cut once no request arrived for the quiet period.
+constexpr std::chrono::milliseconds kCoalesceQuiet{25};
+constexpr std::chrono::milliseconds kCoalesceLimit{250};
+constexpr std::chrono::milliseconds kAcceptTick{1000};
+constexpr size_t kMaxRecordSize = 64 * 1024;
+
+#ifdef _WIN32
+using Channel = HANDLE;
+
+// Works on both overlapped (service) and synchronous (client) pipe handles.
+bool pipe_transfer(HANDLE pipe, void* buffer, DWORD size, bool write, DWORD& out_done) {
+    OVERLAPPED overlapped{};
+    overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!overlapped.hEvent) return false;
+
+    const BOOL started = write ? WriteFile(pipe, buffer, size, nullptr, &overlapped)
+                               : ReadFile(pipe, buffer, size, nullptr, &overlapped);
+    bool ok = started != FALSE || GetLastError() == ERROR_IO_PENDING;
+    if (ok) ok = GetOverlappedResult(pipe, &overlapped, &out_done, TRUE) != FALSE;
+    CloseHandle(overlapped.hEvent);
+    return ok;
+}
+
+bool channel_read(Channel channel, char* buffer, size_t size, size_t& out_read) {
+    DWORD done = 0;
+    if (!pipe_transfer(channel, buffer, static_cast<DWORD>(size), false, done)) {
+        out_read = 0;
+        return GetLastError() == ERROR_BROKEN_PIPE;
+    }
+    out_read = done;
+    return true;
+}
+
+bool channel_write(Channel channel, const std::string& data) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        DWORD done = 0;
+        const DWORD chunk = static_cast<DWORD>(std::min<size_t>(data.size() - offset, 64 * 1024));
+        if (!pipe_transfer(channel, const_cast<char*>(data.data() + offset), chunk, true, done) || done == 0) {
+            return false;
+        }
+        offset += done;
+    }
+    return true;
+}
+
+// Elevated and unelevated services are kept apart so a client never hands
+// its targets to a service running with different rights.
+std::wstring pipe_name() {
+    std::wstring name = L"\\\\.\\pipe\\exterminate-";
+    wchar_t user[256];
+    DWORD size = static_cast<DWORD>(sizeof(user) / sizeof(user[0]));
+    if (GetUserNameW(user, &size)) name += user;
+    DWORD session = 0;
+    if (ProcessIdToSessionId(GetCurrentProcessId(), &session)) name += L"-" + std::to_wstring(session);
+    if (is_running_as_admin()) name += L"-admin";
+    return name;
+}
+
+HANDLE create_pipe_instance(const std::wstring& name, bool first) {
+    DWORD open_mode = PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED;
+    if (first) open_mode |= FILE_FLAG_FIRST_PIPE_INSTANCE;
+    return CreateNamedPipeW(name.c_str(), open_mode,
+                            PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                            PIPE_UNLIMITED_INSTANCES, 64 * 1024, 64 * 1024, 0, nullptr);
+}
+#else
+using Channel = int;
+
+bool channel_read(Channel channel, char* buffer, size_t size, size_t& out_read) {
+    while (true) {
+        const ssize_t got = ::recv(channel, buffer, size, 0);
+        if (got >= 0) {
+            out_read = static_cast<size_t>(got);
+            return true;
+        }
+        if (errno != EINTR) return false;
+    }
+}
+
+bool channel_write(Channel channel, const std::string& data) {
+  #ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;
+  #else
+    const int flags = 0;
+  #endif
+    size_t offset = 0;
+    while (offset < data.size()) {
+        const ssize_t sent = ::send(channel, data.data() + offset, data.size() - offset, flags);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        offset += static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+int open_stream_socket() {
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+  #ifdef SO_NOSIGPIPE
+    const int on = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+  #endif
+    return fd;
+}
+
+bool make_socket_address(const fs::path& endpoint, sockaddr_un& out_address) {
+    std::memset(&out_address, 0, sizeof(out_address));
+    out_address.sun_family = AF_UNIX;
+    const std::string& native = endpoint.native();
+    if (native.empty() || native.size() >= sizeof(out_address.sun_path)) return false;
+    std::memcpy(out_address.sun_path, native.c_str(), native.size() + 1);
+    return true;
+}
+
+bool connect_socket(int fd, const sockaddr_un& address) {
+    while (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        if (errno != EINTR) return false;
+    }
+    return true;
+}
+
+// The endpoint directory is private, but a shared XDG_RUNTIME_DIR or state
+// directory is not guaranteed, so the peer has to be the same user.
+bool peer_is_same_user(int fd) {
+  #ifdef __linux__
+    ucred credentials{};
+    socklen_t length = sizeof(credentials);
+    if (::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0) return false;
+    return credentials.uid == ::geteuid();
+  #else
+    uid_t uid = 0;
+    gid_t gid = 0;
+    if (::getpeereid(fd, &uid, &gid) != 0) return false;
+    return uid == ::geteuid();
+  #endif
+}
+#endif
+
+void append_record(std::string& out, const std::string& record) {
+    out += record;
+    out.push_back('\0');
+}
+
+class RecordReader {
+public:
+    explicit RecordReader(Channel channel) : channel_(channel) {}
+
+    bool next(std::string& out_record) {
+        while (true) {
+            const size_t end = pending_.find('\0', scanned_);
+            if (end != std::string::npos) {
+                out_record.assign(pending_, 0, end);
+                pending_.erase(0, end + 1);
+                scanned_ = 0;
+                return true;
+            }
+            scanned_ = pending_.size();
+            if (pending_.size() > kMaxRecordSize) return false;
+
+            char buffer[4096];
+            size_t got = 0;
+            if (!channel_read(channel_, buffer, sizeof(buffer), got) || got == 0) return false;
+            pending_.append(buffer, got);
+        }
+    }
+
+private:
+    Channel channel_;
+    std::string pending_;
+    size_t scanned_ = 0;
+};
+
+// Collects targets from every connection and runs them as batches on one
+// warm pool. A target requested by several clients at once is deleted once
+// and its result handed to each of them. The config is reloaded for every
+// batch (a stat when unchanged); only the pool size is fixed at startup.
+class Coalescer {
+public:
+    Coalescer(std::string config_path, std::string base_directory, int worker_threads)
+        : config_path_(std::move(config_path)),
+          base_directory_(std::move(base_directory)),
+          pool_(resolve_worker_threads(worker_threads)),
+          thread_([this] { loop(); }) {}
+
+    ~Coalescer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+    Coalescer(const Coalescer&) = delete;
+    Coalescer& operator=(const Coalescer&) = delete;
+
+    // The config batches are deleted with, as of now.
+    std::string config_identity() const { return load_config(config_path_, base_directory_).identity; }
+
+    std::vector<DeleteResult> run(const std::vector<fs::path>& target_paths) {
+        auto request = std::make_shared<Request>();
+        request->results.resize(target_paths.size());
+        request->remaining = target_paths.size();
+        if (target_paths.empty()) return {};
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t slot = 0; slot < target_paths.size(); ++slot) {
+                pending_.push_back(Pending{target_paths[slot], request, slot});
+            }
+        }
+        cv_.notify_all();
+
+        std::unique_lock<std::mutex> lock(request->mutex);
+        request->done_cv.wait(lock, [&] { return request->remaining == 0; });
+        return std::move(request->results);
+    }
+
+private:
+    struct Request {
+        std::mutex mutex;
+        std::condition_variable done_cv;
+        std::vector<DeleteResult> results;
+        size_t remaining = 0;
+    };
+
+    struct Pending {
+        fs::path path;
+        std::shared_ptr<Request> request;
+        size_t slot = 0;
+    };
+
+    void loop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            cv_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+            if (pending_.empty()) return;
+
+            const auto first = std::chrono::steady_clock::now();
+            while (!stopping_ && std::chrono::steady_clock::now() - first < kCoalesceLimit) {
+                const size_t seen = pending_.size();
+                if (!cv_.wait_for(lock, kCoalesceQuiet, [&] { return stopping_ || pending_.size() != seen; })) break;
+            }
+
+            std::vector<Pending> batch;
+            batch.swap(pending_);
+            lock.unlock();
+            dispatch(batch);
+            lock.lock();
+        }
+    }
+
+    void dispatch(const std::vector<Pending>& batch) {
+        std::map<fs::path, size_t> unique_index;
+        std::vector<std::vector<const Pending*>> waiters;
+        std::vector<fs::path> targets;
+        for (const auto& pending : batch) {
+            const auto inserted = unique_index.emplace(pending.path, targets.size());
+            if (inserted.second) {
+                targets.push_back(pending.path);
+                waiters.emplace_back();
+            }
+            waiters[inserted.first->second].push_back(&pending);
+        }
+
+        const AppConfig config = load_config(config_path_, base_directory_);
+        DeleteBatch delete_batch(config, pool_, [&](size_t index, const DeleteResult& result) {
+            for (const Pending* waiter : waiters[index]) {
+                std::lock_guard<std::mutex> lock(waiter->request->mutex);
+                waiter->request->results[waiter->slot] = result;
+                if (--waiter->request->remaining == 0) waiter->request->done_cv.notify_all();
+            }
+        });
+        for (const auto& target : targets) {
+            delete_batch.add_target(target);
+        }
+        delete_batch.finish();
+    }
+
+    const std::string config_path_;
+    const std::string base_directory_;
+    WorkPool pool_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<Pending> pending_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+// Runs one thread per connection and tells the accept loop when nothing has
+// been connected for long enough to shut down.
+class ConnectionTracker {
+public:
+    ~ConnectionTracker() { join_all(); }
+
+    void start(std::function<void()> serve) {
+        auto done = std::make_shared<std::atomic<bool>>(false);
+        workers_.push_back(Worker{std::thread([serve = std::move(serve), done] {
+                                      serve();
+                                      done->store(true, std::memory_order_release);
+                                  }),
+                                  done});
+        last_busy_ = std::chrono::steady_clock::now();
+    }
+
+    bool idle_for(std::chrono::seconds timeout) {
+        prune();
+        const auto now = std::chrono::steady_clock::now();
+        if (!workers_.empty()) last_busy_ = now;
+        return timeout.count() > 0 && workers_.empty() && now - last_busy_ >= timeout;
+    }
+
+    void join_all() {
+        for (auto& worker : workers_) {
+            worker.thread.join();
+        }
+        workers_.clear();
+    }
+
+private:
+    struct Worker {
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> done;
+    };
+
+    void prune() {
+        for (auto it = workers_.begin(); it != workers_.end();) {
+            if (it->done->load(std::memory_order_acquire)) {
+                it->thread.join();
+                it = workers_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    std::vector<Worker> workers_;
+    std::chrono::steady_clock::time_point last_busy_ = std::chrono::steady_clock::now();
+};
+
+void serve_connection(Channel channel, Coalescer& coalescer) {
+    RecordReader reader(channel);
+    std::vector<fs::path> requested;
+    std::string record;
+    if (!reader.next(record)) return;
+    if (record.rfind("config ", 0) != 0 || record.substr(7) != coalescer.config_identity()) {
+        std::string reply;
+        append_record(reply, "mismatch");
+        channel_write(channel, reply);
+        return;
+    }
+
+    bool ended = false;
+    while (reader.next(record)) {
+        if (record == "end") {
+            ended = true;
+            break;
+        }
+        if (record.rfind("delete ", 0) != 0) {
+            std::string reply;
+            append_record(reply, "error unknown request");
+            channel_write(channel, reply);
+            return;
+        }
+        requested.push_back(fs::u8path(record.substr(7)));
+    }
+    if (!ended) return;
+
+    // Relative paths would resolve against the service's working directory,
+    // not the client's.
+    std::vector<DeleteResult> results(requested.size());
+    std::vector<fs::path> targets;
+    std::vector<size_t> slots;
+    for (size_t i = 0; i < requested.size(); ++i) {
+        if (requested[i].is_absolute()) {
+            targets.push_back(requested[i]);
+            slots.push_back(i);
+        } else {
+            results[i].message = "Failed to delete: " + requested[i].string() + " (not an absolute path)";
+        }
+    }
+
+    const std::vector<DeleteResult> deleted = coalescer.run(targets);
+    for (size_t i = 0; i < deleted.size(); ++i) {
+        results[slots[i]] = deleted[i];
+    }
+
+    std::string reply;
+    for (const auto& result : results) {
+        const char* status = !result.success ? "failed " : (result.already_gone ? "gone " : "ok ");
+        append_record(reply, status + result.message);
+    }
+    append_record(reply, "done");
+    channel_write(channel, reply);
+}
+
+} // namespace
+
+fs::path service_endpoint() {
+#ifdef _WIN32
+    return fs::path(pipe_name());
+#else
+    const char* runtime_dir = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime_dir && *runtime_dir) return fs::path(runtime_dir) / "exterminate.sock";
+    return get_state_directory() / "service.sock";
+#endif
+}
+
+int run_service(const std::string& config_path, const std::string& base_directory) {
+    const AppConfig config = load_config(config_path, base_directory);
+    const std::chrono::seconds idle_timeout(config.service_idle_timeout_seconds);
+    Coalescer coalescer(config_path, base_directory, config.worker_threads);
+    ConnectionTracker connections;
+
+#ifdef _WIN32
+    const std::wstring name = service_endpoint().wstring();
+    HANDLE instance = create_pipe_instance(name, true);
+    if (instance == INVALID_HANDLE_VALUE) return GetLastError() == ERROR_ACCESS_DENIED ? 0 : 1;
+
+    HANDLE connected_event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!connected_event) {
+        CloseHandle(instance);
+        return 1;
+    }
+
+    int exit_code = 0;
+    while (true) {
+        OVERLAPPED overlapped{};
+        overlapped.hEvent = connected_event;
+        ResetEvent(connected_event);
+
+        bool connected = ConnectNamedPipe(instance, &overlapped) != FALSE;
+        if (!connected) {
+            const DWORD error = GetLastError();
+            if (error == ERROR_PIPE_CONNECTED) {
+                connected = true;
+            } else if (error == ERROR_IO_PENDING) {
+                while (WaitForSingleObject(connected_event, static_cast<DWORD>(kAcceptTick.count())) == WAIT_TIMEOUT) {
+                    if (connections.idle_for(idle_timeout)) break;
+                }
+                DWORD unused = 0;
+                if (WaitForSingleObject(connected_event, 0) == WAIT_OBJECT_0) {
+                    connected = GetOverlappedResult(instance, &overlapped, &unused, FALSE) != FALSE;
+                } else {
+                    CancelIoEx(instance, &overlapped);
+                    GetOverlappedResult(instance, &overlapped, &unused, TRUE);
+                    break;
+                }
+            } else {
+                exit_code = 1;
+                break;
+            }
+        }
+
+        if (!connected) {
+            DisconnectNamedPipe(instance);
+            continue;
+        }
+
+        const HANDLE client = instance;
+        connections.start([client, &coalescer] {
+            serve_connection(client, coalescer);
+            FlushFileBuffers(client);
+            DisconnectNamedPipe(client);
+            CloseHandle(client);
+        });
+
+        instance = create_pipe_instance(name, false);
+        if (instance == INVALID_HANDLE_VALUE) {
+            exit_code = 1;
+            break;
+        }
+    }
+
+    if (instance != INVALID_HANDLE_VALUE) CloseHandle(instance);
+    CloseHandle(connected_event);
+    connections.join_all();
+    return exit_code;
+#else
+    const fs::path endpoint = service_endpoint();
+    sockaddr_un address{};
+    if (!make_socket_address(endpoint, address)) return 1;
+
+    std::error_code ec;
+    if (fs::create_directories(endpoint.parent_path(), ec)) {
+        fs::permissions(endpoint.parent_path(), fs::perms::owner_all, ec);
+    }
+
+    const int listener = open_stream_socket();
+    if (listener < 0) return 1;
+
+    if (::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        if (errno != EADDRINUSE) {
+            ::close(listener);
+            return 1;
+        }
+
+        // A socket file nobody answers on was left by a service that died.
+        const int probe = open_stream_socket();
+        const bool live = probe >= 0 && connect_socket(probe, address);
+        if (probe >= 0) ::close(probe);
+        if (live) {
+            ::close(listener);
+            return 0;
+        }
+        ::unlink(address.sun_path);
+        if (::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            ::close(listener);
+            return 1;
+        }
+    }
+    ::chmod(address.sun_path, S_IRUSR | S_IWUSR);
+
+    if (::listen(listener, SOMAXCONN) != 0) {
+        ::close(listener);
+        ::unlink(address.sun_path);
+        return 1;
+    }
+
+    int exit_code = 0;
+    while (!connections.idle_for(idle_timeout)) {
+        pollfd waiting{listener, POLLIN, 0};
+        const int ready = ::poll(&waiting, 1, static_cast<int>(kAcceptTick.count()));
+        if (ready < 0 && errno != EINTR) {
+            exit_code = 1;
+            break;
+        }
+        if (ready <= 0) continue;
+
+        const int client = ::accept(listener, nullptr, nullptr);
+        if (client < 0) continue;
+        ::fcntl(client, F_SETFD, FD_CLOEXEC);
+        if (!peer_is_same_user(client)) {
+            ::close(client);
+            continue;
+        }
+
+        connections.start([client, &coalescer] {
+            serve_connection(client, coalescer);
+            ::close(client);
+        });
+    }
+
+    ::close(listener);
+    ::unlink(address.sun_path);
+    connections.join_all();
+    return exit_code;
+#endif
+}
+
+bool spawn_service(const std::string& config_path) {
+    const fs::path self = get_executable_path();
+    if (self.empty()) return false;
+
+    std::vector<std::string> args{"--serve"};
+    if (!config_path.empty()) {
+        std::error_code ec;
+        const fs::path absolute = fs::absolute(config_path, ec);
+        args.push_back("--config");
+        args.push_back(ec ? config_path : absolute.string());
+    }
+    return spawn_detached_process(self.string(), args);
+}
+
+ServiceClient::~ServiceClient() {
+    close();
+}
+
+bool ServiceClient::connect() {
+    close();
+#ifdef _WIN32
+    const std::wstring name = service_endpoint().wstring();
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        HANDLE pipe = CreateFileW(name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+        if (pipe != INVALID_HANDLE_VALUE) {
+            handle_ = pipe;
+            return true;
+        }
+        if (GetLastError() != ERROR_PIPE_BUSY || !WaitNamedPipeW(name.c_str(), 2000)) return false;
+    }
+    return false;
+#else
+    sockaddr_un address{};
+    if (!make_socket_address(service_endpoint(), address)) return false;
+
+    const int fd = open_stream_socket();
+    if (fd < 0) return false;
+    if (!connect_socket(fd, address)) {
+        ::close(fd);
+        return false;
+    }
+    fd_ = fd;
+    return true;
+#endif
+}
+
+bool ServiceClient::connected() const {
+#ifdef _WIN32
+    return handle_ != nullptr;
+#else
+    return fd_ >= 0;
+#endif
+}
+
+bool ServiceClient::submit(const std::string& config_identity, const std::vector<fs::path>& target_paths,
+                           std::vector<DeleteResult>& out_results) {
+    out_results.clear();
+    if (!connected()) return false;
+#ifdef _WIN32
+    const Channel channel = static_cast<Channel>(handle_);
+#else
+    const Channel channel = fd_;
+#endif
+
+    std::string request;
+    append_record(request, "config " + config_identity);
+    for (const auto& target_path : target_paths) {
+        append_record(request, "delete " + target_path.u8string());
+    }
+    append_record(request, "end");
+    if (!channel_write(channel, request)) {
+        close();
+        return false;
+    }
+
+    RecordReader reader(channel);
+    std::string record;
+    std::vector<DeleteResult> results;
+    while (reader.next(record)) {
+        if (record == "done" || record == "mismatch") break;
+
+        DeleteResult result;
+        const size_t space = record.find(' ');
+        const std::string status = record.substr(0, space);
+        result.message = space == std::string::npos ? std::string() : record.substr(space + 1);
+        result.success = status == "ok" || status == "gone";
+        result.already_gone = status == "gone";
+        results.push_back(std::move(result));
+    }
+    close();
+
+    if (results.size() != target_paths.size() || record != "done") return false;
+    out_results = std::move(results);
+    return true;
+}
+
+void ServiceClient::close() {
+#ifdef _WIN32
+    if (handle_) CloseHandle(static_cast<HANDLE>(handle_));
+    handle_ = nullptr;
+#else
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+#endif
+}
+
+} // namespace exterminate
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "config.hpp"
+#include "delete_engine.hpp"
+
+namespace exterminate {
+
+// The resident service keeps a warm worker pool and the loaded config and
+// takes delete jobs over a per-user local endpoint: a Unix domain socket on
+// POSIX, a named pipe on Windows. Records are NUL-terminated so any path can
+// be sent:
+//
+//   client:  "config <identity>\0" "delete <absolute path>\0" ... "end\0"
+//   service: "ok <message>\0", "gone <message>\0" or "failed <message>\0"
+//            per target in request order, then "done\0"; or "mismatch\0"
+//
+// The identity is AppConfig::identity of the client's config. A service
+// whose own config differs, in protected paths or any other key, deletes
+// nothing and answers "mismatch", and the client deletes in-process.
+//
+// Requests arriving in a burst (one client per selected item) are coalesced
+// into a single batch on the shared pool.
+std::filesystem::path service_endpoint();
+
+// Serves until no client has been connected for serviceIdleTimeoutSeconds
+// (0 serves forever). Returns 0 when it stopped idle or another service
+// already owns the endpoint.
+int run_service(const std::string& config_path, const std::string& base_directory);
+
+// Starts a detached "exterminate --serve" for later invocations to use.
+bool spawn_service(const std::string& config_path);
+
+class ServiceClient {
+public:
+    ServiceClient() = default;
+    ~ServiceClient();
+
+    ServiceClient(const ServiceClient&) = delete;
+    ServiceClient& operator=(const ServiceClient&) = delete;
+
+    // Returns false without side effects when no service is listening.
+    bool connect();
+    bool connected() const;
+    // Results come back in the order of `target_paths`. Returns false if the
+    // service runs with another config than `config_identity`, or the
+    // connection broke before every result arrived.
+    bool submit(const std::string& config_identity, const std::vector<std::filesystem::path>& target_paths,
+                std::vector<DeleteResult>& out_results);
+
+private:
+    void close();
+
+#ifdef _WIN32
+    void* handle_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+} // namespace exterminate
@@ -0,0 +1,329 @@
+#include "shred.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <random>
+#include <vector>
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #define NOMINMAX
+  #include <windows.h>
+  #include <winioctl.h>
+#else
+  #include <cerrno>
+  #include <fcntl.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace exterminate {
+
+namespace {
+
+// Unbuffered writes start and end on multiples of this, which suits both
+// 512-byte and 4 KiB sectors.
+constexpr std::uint64_t kAlignment = 4096;
+constexpr std::align_val_t kBufferAlignment{kAlignment};
+
+struct Range {
+    std::uint64_t begin = 0;
+    std::uint64_t end = 0;
+};
+
+// The parts of a file a pass covers: everything but the holes.
+struct FileLayout {
+    std::uint64_t size = 0;
+    std::vector<Range> ranges;
+    bool hard_linked = false;
+};
+
+std::uint64_t align_down(std::uint64_t value) {
+    return value & ~(kAlignment - 1);
+}
+
+std::uint64_t align_up(std::uint64_t value) {
+    return align_down(value + kAlignment - 1);
+}
+
+// Widens each range to the alignment, but never past the end of the file,
+// and merges the ranges that then touch.
+std::vector<Range> aligned_ranges(const std::vector<Range>& ranges, std::uint64_t size) {
+    std::vector<Range> out;
+    for (const Range& range : ranges) {
+        const Range aligned{align_down(range.begin), std::min(align_up(range.end), size)};
+        if (!out.empty() && aligned.begin <= out.back().end) {
+            out.back().end = std::max(out.back().end, aligned.end);
+        } else {
+            out.push_back(aligned);
+        }
+    }
+    return out;
+}
+
+#ifdef _WIN32
+std::error_code last_error() {
+    return std::error_code(static_cast<int>(GetLastError()), std::system_category());
+}
+
+bool is_invalid_argument(const std::error_code& ec) {
+    if (ec.category() == std::system_category() && ec.value() == ERROR_INVALID_PARAMETER) return true;
+    return ec == std::errc::invalid_argument;
+}
+
+// Only sparse files are asked for their allocated ranges.
+bool read_layout(const FileHandle& file, FileLayout& layout, std::error_code& ec) {
+    const HANDLE handle = static_cast<HANDLE>(file.native_handle());
+    FILE_STANDARD_INFO standard{};
+    FILE_BASIC_INFO basic{};
+    if (!GetFileInformationByHandleEx(handle, FileStandardInfo, &standard, sizeof(standard)) ||
+        !GetFileInformationByHandleEx(handle, FileBasicInfo, &basic, sizeof(basic))) {
+        ec = last_error();
+        return false;
+    }
+    layout.size = static_cast<std::uint64_t>(standard.EndOfFile.QuadPart);
+    layout.hard_linked = standard.NumberOfLinks > 1;
+    if (layout.size == 0 || layout.hard_linked) return true;
+    if ((basic.FileAttributes & FILE_ATTRIBUTE_SPARSE_FILE) == 0) {
+        layout.ranges.push_back(Range{0, layout.size});
+        return true;
+    }
+
+    FILE_ALLOCATED_RANGE_BUFFER query{};
+    query.FileOffset.QuadPart = 0;
+    query.Length.QuadPart = static_cast<LONGLONG>(layout.size);
+    std::vector<FILE_ALLOCATED_RANGE_BUFFER> found(64);
+    for (;;) {
+        DWORD returned = 0;
+        const BOOL ok = DeviceIoControl(handle, FSCTL_QUERY_ALLOCATED_RANGES, &query, sizeof(query), found.data(),
+                                        static_cast<DWORD>(found.size() * sizeof(found[0])), &returned, nullptr);
+        if (!ok && GetLastError() != ERROR_MORE_DATA) {
+            ec = last_error();
+            return false;
+        }
+
+        const size_t count = returned / sizeof(found[0]);
+        for (size_t i = 0; i < count; ++i) {
+            const auto begin = static_cast<std::uint64_t>(found[i].FileOffset.QuadPart);
+            layout.ranges.push_back(Range{begin, begin + static_cast<std::uint64_t>(found[i].Length.QuadPart)});
+        }
+        if (ok || count == 0) return true;
+
+        const FILE_ALLOCATED_RANGE_BUFFER& last = found[count - 1];
+        query.FileOffset.QuadPart = last.FileOffset.QuadPart + last.Length.QuadPart;
+        query.Length.QuadPart = static_cast<LONGLONG>(layout.size) - query.FileOffset.QuadPart;
+    }
+}
+
+bool write_range(const FileHandle& file, const unsigned char* pattern, const Range& range, bool unbuffered,
+                 std::uint64_t& written, std::error_code& ec) {
+    const HANDLE handle = static_cast<HANDLE>(file.native_handle());
+    std::uint64_t offset = range.begin;
+    while (offset < range.end) {
+        size_t length = static_cast<size_t>(std::min<std::uint64_t>(Shredder::kBlockBytes, range.end - offset));
+        // Only the end of the file can be unaligned. It is written past the
+        // end and finish_pass() cuts the file back.
+        if (unbuffered) length = static_cast<size_t>(align_up(length));
+
+        OVERLAPPED position{};
+        position.Offset = static_cast<DWORD>(offset);
+        position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD done = 0;
+        if (!WriteFile(handle, pattern, static_cast<DWORD>(length), &done, &position)) {
+            ec = last_error();
+            return false;
+        }
+        if (done != length) {
+            ec = std::make_error_code(std::errc::io_error);
+            return false;
+        }
+        written += done;
+        offset += done;
+    }
+    return true;
+}
+
+bool finish_pass(const FileHandle& file, std::uint64_t size, bool unbuffered, std::error_code& ec) {
+    const HANDLE handle = static_cast<HANDLE>(file.native_handle());
+    if (unbuffered) {
+        FILE_END_OF_FILE_INFO end{};
+        end.EndOfFile.QuadPart = static_cast<LONGLONG>(size);
+        if (!SetFileInformationByHandle(handle, FileEndOfFileInfo, &end, sizeof(end))) {
+            ec = last_error();
+            return false;
+        }
+    }
+    if (!FlushFileBuffers(handle)) {
+        ec = last_error();
+        return false;
+    }
+    return true;
+}
+#else
+std::error_code errno_error() {
+    return std::error_code(errno, std::system_category());
+}
+
+bool is_invalid_argument(const std::error_code& ec) {
+    return ec == std::errc::invalid_argument;
+}
+
+bool read_layout(const FileHandle& file, FileLayout& layout, std::error_code& ec) {
+    const int fd = file.native_fd();
+    struct stat info {};
+    if (::fstat(fd, &info) != 0) {
+        ec = errno_error();
+        return false;
+    }
+    layout.size = static_cast<std::uint64_t>(info.st_size);
+    layout.hard_linked = info.st_nlink > 1;
+    if (layout.size == 0 || layout.hard_linked) return true;
+
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+    off_t offset = 0;
+    while (static_cast<std::uint64_t>(offset) < layout.size) {
+        const off_t data = ::lseek(fd, offset, SEEK_DATA);
+        if (data < 0) {
+            // ENXIO: only holes are left. Anything else means the filesystem
+            // cannot tell, so the whole file is covered.
+            if (errno != ENXIO) layout.ranges.assign(1, Range{0, layout.size});
+            return true;
+        }
+        off_t hole = ::lseek(fd, data, SEEK_HOLE);
+        if (hole < 0 || static_cast<std::uint64_t>(hole) > layout.size) hole = static_cast<off_t>(layout.size);
+        layout.ranges.push_back(Range{static_cast<std::uint64_t>(data), static_cast<std::uint64_t>(hole)});
+        offset = hole;
+    }
+#else
+    layout.ranges.push_back(Range{0, layout.size});
+#endif
+    return true;
+}
+
+#ifdef O_DIRECT
+bool set_direct(int fd, bool direct) {
+    const int flags = ::fcntl(fd, F_GETFL);
+    if (flags < 0) return false;
+    return ::fcntl(fd, F_SETFL, direct ? flags | O_DIRECT : flags & ~O_DIRECT) == 0;
+}
+#endif
+
+bool write_all(int fd, const unsigned char* data, std::uint64_t offset, size_t length, std::error_code& ec) {
+    while (length > 0) {
+        const ssize_t done = ::pwrite(fd, data, length, static_cast<off_t>(offset));
+        if (done < 0) {
+            if (errno == EINTR) continue;
+            ec = errno_error();
+            return false;
+        }
+        if (done == 0) {
+            ec = std::make_error_code(std::errc::io_error);
+            return false;
+        }
+        data += done;
+        offset += static_cast<std::uint64_t>(done);
+        length -= static_cast<size_t>(done);
+    }
+    return true;
+}
+
+bool write_range(const FileHandle& file, const unsigned char* pattern, const Range& range, bool unbuffered,
+                 std::uint64_t& written, std::error_code& ec) {
+    const int fd = file.native_fd();
+    std::uint64_t offset = range.begin;
+    while (offset < range.end) {
+        const auto length = static_cast<size_t>(std::min<std::uint64_t>(Shredder::kBlockBytes, range.end - offset));
+#ifdef O_DIRECT
+        // Only the end of the file can be unaligned. That piece goes through
+        // the cache; the flush at the end of the pass still covers it.
+        const bool unaligned = unbuffered && length % kAlignment != 0;
+        if (unaligned && !set_direct(fd, false)) {
+            ec = errno_error();
+            return false;
+        }
+        const bool ok = write_all(fd, pattern, offset, length, ec);
+        if (unaligned) set_direct(fd, true);
+        if (!ok) return false;
+#else
+        (void)unbuffered;
+        if (!write_all(fd, pattern, offset, length, ec)) return false;
+#endif
+        written += length;
+        offset += length;
+    }
+    return true;
+}
+
+bool finish_pass(const FileHandle& file, std::uint64_t, bool, std::error_code& ec) {
+#ifdef __linux__
+    const int result = ::fdatasync(file.native_fd());
+#else
+    const int result = ::fsync(file.native_fd());
+#endif
+    if (result != 0) {
+        ec = errno_error();
+        return false;
+    }
+    return true;
+}
+#endif
+
+bool overwrite_passes(const FileHandle& file, const FileLayout& layout, const unsigned char* pattern, int passes,
+                      bool unbuffered, std::uint64_t& written, std::error_code& ec) {
+    const std::vector<Range> ranges = unbuffered ? aligned_ranges(layout.ranges, layout.size) : layout.ranges;
+    for (int pass = 0; pass < passes; ++pass) {
+        const unsigned char* data = pattern + (pass % 2 == 0 ? 0 : Shredder::kBlockBytes);
+        for (const Range& range : ranges) {
+            if (!write_range(file, data, range, unbuffered, written, ec)) return false;
+        }
+        if (!finish_pass(file, layout.size, unbuffered, ec)) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+Shredder::Shredder(int passes) : passes_(std::max(1, std::min(passes, kMaxPasses))) {
+    pattern_ = static_cast<unsigned char*>(::operator new(2 * kBlockBytes, kBufferAlignment));
+    std::mt19937_64 random(std::random_device{}());
+    for (size_t i = 0; i < kBlockBytes; i += sizeof(std::uint64_t)) {
+        const std::uint64_t value = random();
+        const std::uint64_t complement = ~value;
+        std::memcpy(pattern_ + i, &value, sizeof(value));
+        std::memcpy(pattern_ + kBlockBytes + i, &complement, sizeof(complement));
+    }
+}
+
+Shredder::~Shredder() {
+    ::operator delete(pattern_, kBufferAlignment);
+}
+
+bool Shredder::overwrite(const DirHandle& directory, const NativeName& name, std::error_code& ec) const {
+    bool unbuffered = false;
+    FileHandle file = directory.open_file_for_overwrite(name, true, unbuffered, ec);
+    if (!file.valid()) return !ec;
+
+    FileLayout layout;
+    if (!read_layout(file, layout, ec)) return false;
+    if (layout.hard_linked) {
+        linked_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    if (layout.ranges.empty()) return true;
+
+    std::uint64_t written = 0;
+    bool done = overwrite_passes(file, layout, pattern_, passes_, unbuffered, written, ec);
+    // Some filesystems open files for unbuffered I/O but refuse the writes,
+    // e.g. with sectors larger than kAlignment. Those go through the cache.
+    if (!done && unbuffered && is_invalid_argument(ec)) {
+        file = directory.open_file_for_overwrite(name, false, unbuffered, ec);
+        done = file.valid() ? overwrite_passes(file, layout, pattern_, passes_, false, written, ec) : !ec;
+    }
+    bytes_.fetch_add(written, std::memory_order_relaxed);
+    if (!done) return false;
+    files_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+} // namespace exterminate
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+
+#include "dir_handle.hpp"
+
+namespace exterminate {
+
+// Overwrites file contents before they are removed (--shred). The pattern
+// is generated once and shared read-only by every worker. Each pass writes
+// it, or its complement on every second pass, over the allocated ranges of
+// a file in kBlockBytes writes. The writes bypass the cache where the
+// filesystem allows it, and each pass is flushed to the device before the
+// next one starts.
+class Shredder {
+public:
+    static constexpr size_t kBlockBytes = 1 << 20;
+    static constexpr int kMaxPasses = 35;
+
+    explicit Shredder(int passes);
+    ~Shredder();
+
+    Shredder(const Shredder&) = delete;
+    Shredder& operator=(const Shredder&) = delete;
+
+    int passes() const { return passes_; }
+
+    // Overwrites the file `name` in `directory`. Empty files and holes are
+    // skipped. Anything but a regular file is left alone and counts as done,
+    // and so is a file with other hard links, whose data is still in use
+    // elsewhere. Returns false with `ec` set when the contents could not be
+    // overwritten; the file must then be kept.
+    bool overwrite(const DirHandle& directory, const NativeName& name, std::error_code& ec) const;
+
+    std::uint64_t files_overwritten() const { return files_.load(std::memory_order_relaxed); }
+    // Across all passes.
+    std::uint64_t bytes_written() const { return bytes_.load(std::memory_order_relaxed); }
+    std::uint64_t hard_linked_files() const { return linked_.load(std::memory_order_relaxed); }
+
+private:
+    int passes_;
+    // kBlockBytes of the pattern followed by kBlockBytes of its complement.
+    unsigned char* pattern_ = nullptr;
+    mutable std::atomic<std::uint64_t> files_{0};
+    mutable std::atomic<std::uint64_t> bytes_{0};
+    mutable std::atomic<std::uint64_t> linked_{0};
+};
+
+} // namespace exterminate
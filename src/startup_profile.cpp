@@ -0,0 +1,59 @@
+#include "startup_profile.hpp"
+
+#include <cstdio>
+
+namespace exterminate {
+
+namespace {
+
+void print_phase(std::ostream& out, const char* name, std::chrono::steady_clock::duration duration,
+                 const char* suffix) {
+    char buffer[96];
+    const double micros = std::chrono::duration<double, std::micro>(duration).count();
+    std::snprintf(buffer, sizeof(buffer), "  %-18s %10.1f us%s\n", name, micros, suffix);
+    out << buffer;
+}
+
+} // namespace
+
+StartupProfile& StartupProfile::instance() {
+    static StartupProfile profile;
+    return profile;
+}
+
+StartupProfile::StartupProfile() : last_mark_(std::chrono::steady_clock::now()) {}
+
+void StartupProfile::mark(const char* name, bool excluded) {
+    const auto now = std::chrono::steady_clock::now();
+    if (phase_count_ < kMaxPhases) {
+        phases_[phase_count_++] = Phase{name, now - last_mark_, excluded};
+    }
+    last_mark_ = now;
+}
+
+void StartupProfile::note_mutation() {
+    std::chrono::steady_clock::rep expected = 0;
+    const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+    first_mutation_.compare_exchange_strong(expected, now, std::memory_order_relaxed);
+}
+
+void StartupProfile::print(std::ostream& out) const {
+    out << "Startup profile:\n";
+    std::chrono::steady_clock::duration total{};
+    for (size_t i = 0; i < phase_count_; ++i) {
+        const Phase& phase = phases_[i];
+        print_phase(out, phase.name, phase.duration, phase.excluded ? "  (not counted)" : "");
+        if (!phase.excluded) total += phase.duration;
+    }
+
+    const auto first_mutation = first_mutation_.load(std::memory_order_relaxed);
+    if (first_mutation != 0) {
+        const std::chrono::steady_clock::time_point at{std::chrono::steady_clock::duration(first_mutation)};
+        const auto to_mutation = at > last_mark_ ? at - last_mark_ : std::chrono::steady_clock::duration{};
+        print_phase(out, "first_mutation", to_mutation, "");
+        total += to_mutation;
+    }
+    print_phase(out, "total", total, "");
+}
+
+} // namespace exterminate
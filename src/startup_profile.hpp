@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+
+namespace exterminate {
+
+// Splits the time from entering run() to the first filesystem mutation into
+// named phases. Marks are always taken (one clock read each) because the
+// --profile-startup flag is only known after the CLI has been parsed; the
+// mutation hook and the report only do anything once profiling is enabled.
+class StartupProfile {
+public:
+    static StartupProfile& instance();
+
+    // Ends the current phase under `name`. Phases marked as excluded (the
+    // confirmation prompt) are listed but not counted in the total.
+    void mark(const char* name, bool excluded = false);
+    void enable() { enabled_.store(true, std::memory_order_relaxed); }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // Called by the delete engines after each successful removal; only the
+    // first call while profiling is kept.
+    void note_mutation();
+
+    // One "  <phase> <microseconds> us" line per phase, the time from the
+    // last mark to the first mutation as "first_mutation", then "total".
+    void print(std::ostream& out) const;
+
+private:
+    struct Phase {
+        const char* name = nullptr;
+        std::chrono::steady_clock::duration duration{};
+        bool excluded = false;
+    };
+
+    static constexpr size_t kMaxPhases = 16;
+
+    StartupProfile();
+
+    Phase phases_[kMaxPhases];
+    size_t phase_count_ = 0;
+    std::chrono::steady_clock::time_point last_mark_;
+    std::atomic<bool> enabled_{false};
+    std::atomic<std::chrono::steady_clock::rep> first_mutation_{0};
+};
+
+inline void note_mutation() {
+    StartupProfile& profile = StartupProfile::instance();
+    if (profile.enabled()) profile.note_mutation();
+}
+
+} // namespace exterminate
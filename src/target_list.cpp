@@ -0,0 +1,142 @@
+#include "target_list.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#ifdef _WIN32
+  #include <io.h>
+#else
+  #include <unistd.h>
+#endif
+
+namespace exterminate {
+
+namespace {
+
+constexpr size_t kReadBlockBytes = 1024 * 1024;
+constexpr size_t kMaxEntryBytes = 64 * 1024;
+
+long read_block(int fd, char* buffer, size_t size) {
+#ifdef _WIN32
+    return _read(fd, buffer, static_cast<unsigned int>(size));
+#else
+    return static_cast<long>(::read(fd, buffer, size));
+#endif
+}
+
+void strip_carriage_return(std::string& value) {
+    if (!value.empty() && value.back() == '\r') value.pop_back();
+}
+
+} // namespace
+
+TargetListReader::~TargetListReader() {
+    if (fd_ < 0 || !owns_fd_) return;
+#ifdef _WIN32
+    _close(fd_);
+#else
+    ::close(fd_);
+#endif
+}
+
+bool TargetListReader::open(const std::string& source, std::string& out_error) {
+    if (source == "-") {
+#ifdef _WIN32
+        _setmode(0, _O_BINARY);
+#endif
+        fd_ = 0;
+        owns_fd_ = false;
+    } else {
+#ifdef _WIN32
+        fd_ = _open(source.c_str(), _O_RDONLY | _O_BINARY);
+#else
+        fd_ = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+        owns_fd_ = true;
+        if (fd_ < 0) {
+            out_error = "could not open target list: " + source;
+            return false;
+        }
+    }
+
+    buffer_.resize(kReadBlockBytes);
+    return true;
+}
+
+bool TargetListReader::fill() {
+    begin_ = 0;
+    end_ = 0;
+    for (;;) {
+        const long count = read_block(fd_, buffer_.data(), buffer_.size());
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) {
+            if (count < 0) error_ = "failed while reading target list";
+            eof_ = true;
+            return false;
+        }
+        end_ = static_cast<size_t>(count);
+        return true;
+    }
+}
+
+void TargetListReader::detect_delimiter() {
+    const char* start = buffer_.data() + begin_;
+    const size_t available = end_ - begin_;
+    if (std::memchr(start, '\0', available)) {
+        delimiter_ = '\0';
+        delimiter_known_ = true;
+    } else if (std::memchr(start, '\n', available)) {
+        delimiter_ = '\n';
+        delimiter_known_ = true;
+    }
+}
+
+bool TargetListReader::next(std::string& out_path) {
+    if (fd_ < 0) return false;
+
+    for (;;) {
+        if (begin_ == end_ && (eof_ || !fill())) {
+            out_path.swap(partial_);
+            partial_.clear();
+            if (delimiter_ != '\0') strip_carriage_return(out_path);
+            return !out_path.empty();
+        }
+
+        if (!delimiter_known_) detect_delimiter();
+
+        const char* start = buffer_.data() + begin_;
+        const size_t available = end_ - begin_;
+        const auto* found = delimiter_known_ ? static_cast<const char*>(std::memchr(start, delimiter_, available))
+                                             : nullptr;
+        const size_t piece = found ? static_cast<size_t>(found - start) : available;
+        if (partial_.size() + piece > kMaxEntryBytes) {
+            error_ = "target list entry longer than " + std::to_string(kMaxEntryBytes) + " bytes";
+            partial_.clear();
+            begin_ = end_;
+            eof_ = true;
+            return false;
+        }
+
+        if (!found) {
+            partial_.append(start, available);
+            begin_ = end_;
+            continue;
+        }
+
+        begin_ += piece + 1;
+
+        if (partial_.empty()) {
+            out_path.assign(start, piece);
+        } else {
+            partial_.append(start, piece);
+            out_path.swap(partial_);
+            partial_.clear();
+        }
+
+        if (delimiter_ != '\0') strip_carriage_return(out_path);
+        if (!out_path.empty()) return true;
+    }
+}
+
+} // namespace exterminate
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace exterminate {
+
+// Reads a target list ("-" for stdin) in large blocks and yields one path at
+// a time, so memory stays bounded by the block size regardless of list length.
+// Reads return as soon as any data is available, so entries from a slow pipe
+// are handed out immediately. Entries are NUL-delimited if the first block
+// with a delimiter contains a NUL byte, otherwise newline-delimited (a
+// trailing '\r' is dropped). Empty entries are skipped. An entry longer than
+// 64 KiB, no path on any platform, ends the list with an error rather than
+// growing without bound on input that has no delimiter.
+class TargetListReader {
+public:
+    TargetListReader() = default;
+    ~TargetListReader();
+
+    TargetListReader(const TargetListReader&) = delete;
+    TargetListReader& operator=(const TargetListReader&) = delete;
+
+    bool open(const std::string& source, std::string& out_error);
+    bool next(std::string& out_path);
+    bool failed() const { return !error_.empty(); }
+    const std::string& error() const { return error_; }
+
+private:
+    bool fill();
+    void detect_delimiter();
+
+    int fd_ = -1;
+    bool owns_fd_ = false;
+    bool eof_ = false;
+    std::string error_;
+    bool delimiter_known_ = false;
+    char delimiter_ = '\n';
+    std::vector<char> buffer_;
+    size_t begin_ = 0;
+    size_t end_ = 0;
+    std::string partial_;
+};
+
+} // namespace exterminate
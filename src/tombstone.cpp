@@ -0,0 +1,311 @@
+#include "tombstone.hpp"
+
+#include "delete_engine.hpp"
+#include "paths.hpp"
+#include "startup_profile.hpp"
+#include "windows_env.hpp"
+#include "work_pool.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #define NOMINMAX
+  #include <windows.h>
+  #include <aclapi.h>
+#else
+  #include <cerrno>
+  #include <fcntl.h>
+  #include <sys/file.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace exterminate {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr const char* kTombstoneDirectoryName = ".exterminate-tombstones";
+constexpr int kMaxSweepRounds = 3;
+
+fs::path markers_directory() {
+    return get_state_directory() / "tombstones";
+}
+
+// One marker per tombstone entry, holding its full path, so a sweeper only
+// ever deletes what a run moved there. FNV-1a keeps marker names stable
+// across builds and runs.
+fs::path marker_path(const fs::path& entry) {
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const unsigned char c : entry.u8string()) {
+        hash = (hash ^ c) * 0x100000001b3ULL;
+    }
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+    return markers_directory() / buffer;
+}
+
+bool write_marker(const fs::path& entry) {
+    std::error_code ec;
+    fs::create_directories(markers_directory(), ec);
+    if (ec) return false;
+
+    std::ofstream out(marker_path(entry), std::ios::binary | std::ios::trunc);
+    out << entry.u8string();
+    return static_cast<bool>(out);
+}
+
+fs::path read_marker(const fs::path& marker) {
+    std::ifstream in(marker, std::ios::binary);
+    const std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return fs::u8path(text);
+}
+
+std::vector<fs::path> list_markers() {
+    std::vector<fs::path> markers;
+    std::error_code ec;
+    for (fs::directory_iterator it(markers_directory(), ec), end; !ec && it != end; it.increment(ec)) {
+        markers.push_back(it->path());
+    }
+    return markers;
+}
+
+std::string unique_suffix() {
+    thread_local std::mt19937_64 random(std::random_device{}());
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(random()));
+    return buffer;
+}
+
+bool path_present(const fs::path& path) {
+    std::error_code ec;
+    return fs::exists(fs::symlink_status(path, ec)) && !ec;
+}
+
+// A tombstone directory must be a real directory this user owns. Anyone who
+// can write to the parent could otherwise plant a link or a directory of
+// their own there and have the sweeper delete what it leads to.
+bool is_own_directory(const fs::path& path, std::error_code& ec) {
+#ifdef _WIN32
+    const HANDLE handle = CreateFileW(path.c_str(), READ_CONTROL | FILE_READ_ATTRIBUTES,
+                                      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                                      FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OPEN_REPARSE_POINT, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        ec = std::error_code(static_cast<int>(GetLastError()), std::system_category());
+        return false;
+    }
+
+    bool own = false;
+    FILE_BASIC_INFO basic{};
+    PSID owner = nullptr;
+    PSECURITY_DESCRIPTOR descriptor = nullptr;
+    if (GetFileInformationByHandleEx(handle, FileBasicInfo, &basic, sizeof(basic)) &&
+        (basic.FileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0 &&
+        (basic.FileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0 &&
+        GetSecurityInfo(handle, SE_FILE_OBJECT, OWNER_SECURITY_INFORMATION, &owner, nullptr, nullptr, nullptr,
+                        &descriptor) == ERROR_SUCCESS) {
+        // What this process creates is owned by its token's default owner,
+        // which is the Administrators group rather than the user when
+        // elevated.
+        HANDLE token = nullptr;
+        if (OpenProcessToken(GetCurrentProcess(), TOKEN_QUERY, &token)) {
+            unsigned char buffer[256];
+            DWORD size = 0;
+            if (GetTokenInformation(token, TokenOwner, buffer, sizeof(buffer), &size)) {
+                own = own || EqualSid(owner, reinterpret_cast<TOKEN_OWNER*>(buffer)->Owner);
+            }
+            if (GetTokenInformation(token, TokenUser, buffer, sizeof(buffer), &size)) {
+                own = own || EqualSid(owner, reinterpret_cast<TOKEN_USER*>(buffer)->User.Sid);
+            }
+            CloseHandle(token);
+        }
+        LocalFree(descriptor);
+    }
+    CloseHandle(handle);
+    return own;
+#else
+    struct stat info {};
+    if (::lstat(path.c_str(), &info) != 0) {
+        ec = std::error_code(errno, std::system_category());
+        return false;
+    }
+    return S_ISDIR(info.st_mode) && info.st_uid == ::geteuid();
+#endif
+}
+
+// Creates the tombstone directory, or accepts an existing one that passes
+// is_own_directory().
+bool make_tombstone_directory(const fs::path& path, std::error_code& ec) {
+#ifdef _WIN32
+    if (CreateDirectoryW(path.c_str(), nullptr)) {
+        SetFileAttributesW(path.c_str(), FILE_ATTRIBUTE_HIDDEN);
+    } else if (GetLastError() != ERROR_ALREADY_EXISTS) {
+        ec = std::error_code(static_cast<int>(GetLastError()), std::system_category());
+        return false;
+    }
+#else
+    if (::mkdir(path.c_str(), 0700) != 0 && errno != EEXIST) {
+        ec = std::error_code(errno, std::system_category());
+        return false;
+    }
+#endif
+    if (is_own_directory(path, ec)) return true;
+    if (!ec) ec = std::make_error_code(std::errc::operation_not_permitted);
+    return false;
+}
+
+// Held by a sweeper for as long as it runs, so tombstones are never swept
+// by two at once. The operating system releases it when the process exits.
+class SweepLock {
+public:
+    SweepLock() {
+        std::error_code ec;
+        const fs::path directory = get_state_directory();
+        fs::create_directories(directory, ec);
+        const fs::path path = directory / "sweep.lock";
+#ifdef _WIN32
+        handle_ = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+#else
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (fd_ >= 0 && ::flock(fd_, LOCK_EX | LOCK_NB) != 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+#endif
+    }
+
+    ~SweepLock() {
+#ifdef _WIN32
+        if (handle_ != INVALID_HANDLE_VALUE) CloseHandle(handle_);
+#else
+        if (fd_ >= 0) ::close(fd_);
+#endif
+    }
+
+    SweepLock(const SweepLock&) = delete;
+    SweepLock& operator=(const SweepLock&) = delete;
+
+    bool held() const {
+#ifdef _WIN32
+        return handle_ != INVALID_HANDLE_VALUE;
+#else
+        return fd_ >= 0;
+#endif
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE handle_ = INVALID_HANDLE_VALUE;
+#else
+    int fd_ = -1;
+#endif
+};
+
+} // namespace
+
+bool move_to_tombstone(const fs::path& target_path, std::error_code& ec) {
+    ec.clear();
+    fs::path target = target_path;
+    if (!target.has_filename() && target.has_parent_path()) target = target.parent_path();
+
+    const fs::path parent = target.parent_path();
+    if (!target.has_filename() || parent.empty() || parent == target ||
+        target.filename() == kTombstoneDirectoryName || parent.filename() == kTombstoneDirectoryName) {
+        ec = std::make_error_code(std::errc::invalid_argument);
+        return false;
+    }
+
+    const fs::path tombstones = parent / kTombstoneDirectoryName;
+    if (!make_tombstone_directory(tombstones, ec)) return false;
+
+    fs::path name = target.filename();
+    name += "." + unique_suffix();
+    const fs::path entry = tombstones / name;
+    if (!write_marker(entry)) {
+        ec = std::make_error_code(std::errc::io_error);
+        return false;
+    }
+
+    fs::rename(target, entry, ec);
+    if (ec) {
+        std::error_code ignored;
+        fs::remove(marker_path(entry), ignored);
+        fs::remove(tombstones, ignored);
+        return false;
+    }
+    note_mutation();
+
+    // A sweeper that found the entry missing just before the rename may have
+    // dropped the marker; writing it again keeps the tombstone findable.
+    write_marker(entry);
+    return true;
+}
+
+bool has_pending_tombstones() {
+    return !list_markers().empty();
+}
+
+bool spawn_tombstone_sweeper(const std::string& config_path) {
+    const fs::path self = get_executable_path();
+    if (self.empty()) return false;
+
+    std::vector<std::string> args{"--sweep-tombstones"};
+    if (!config_path.empty()) {
+        std::error_code ec;
+        const fs::path absolute = fs::absolute(config_path, ec);
+        args.push_back("--config");
+        args.push_back(ec ? config_path : absolute.string());
+    }
+    return spawn_detached_process(self.string(), args);
+}
+
+std::size_t sweep_tombstones(const AppConfig& config) {
+    // Another sweeper is already at it and picks up what this one was
+    // started for.
+    const SweepLock lock;
+    if (!lock.held()) return 0;
+
+    AppConfig sweep_config = config;
+    sweep_config.tombstone_delete = false;
+    WorkPool pool(resolve_worker_threads(config.worker_threads));
+
+    // Runs that tombstone while a sweep is going add markers of their own, so
+    // a few rounds pick those up as well.
+    std::size_t left = 0;
+    for (int round = 0; round < kMaxSweepRounds; ++round) {
+        left = 0;
+        for (const auto& marker : list_markers()) {
+            const fs::path entry = read_marker(marker);
+            const fs::path tombstones = entry.parent_path();
+            std::error_code ec;
+            // Markers only name entries of a tombstone directory. One that no
+            // longer is this user's own is left alone and forgotten.
+            const bool valid = entry.has_filename() && tombstones.filename() == kTombstoneDirectoryName &&
+                               is_own_directory(tombstones, ec);
+            if (valid && path_present(entry)) {
+                delete_target(entry, sweep_config, pool);
+                // Only succeeds once it is empty; a run may have just moved a
+                // new target in.
+                fs::remove(tombstones, ec);
+            }
+
+            if (!valid || !path_present(entry)) {
+                fs::remove(marker, ec);
+            } else {
+                ++left;
+            }
+        }
+        if (left == 0) break;
+    }
+    return left;
+}
+
+} // namespace exterminate
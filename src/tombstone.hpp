@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+#include "config.hpp"
+
+namespace exterminate {
+
+// Renames the target into a hidden ".exterminate-tombstones" directory next
+// to it. Being on the same volume, the rename is atomic and the target path
+// is free as soon as it returns. The directory must be a real directory
+// owned by this user. The new entry is recorded first so a sweeper can find
+// it even if this process dies right after. Returns false with the target
+// left in place when it cannot be renamed.
+bool move_to_tombstone(const std::filesystem::path& target_path, std::error_code& ec);
+
+bool has_pending_tombstones();
+
+// Starts a detached "exterminate --sweep-tombstones" worker.
+bool spawn_tombstone_sweeper(const std::string& config_path);
+
+// Deletes every recorded tombstone entry, and nothing else, with the normal
+// delete pipeline. Returns the number of entries that could not be removed.
+// Only one sweeper runs at a time; any other returns 0 straight away.
+std::size_t sweep_tombstones(const AppConfig& config);
+
+} // namespace exterminate
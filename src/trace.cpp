@@ -0,0 +1,91 @@
+#include "trace.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+
+namespace exterminate {
+
+namespace {
+
+long long to_microseconds(std::chrono::steady_clock::duration duration) {
+    return static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+}
+
+} // namespace
+
+std::string json_escape(const std::string& value) {
+    std::string out;
+    out.reserve(value.size() + 2);
+    for (const char c : value) {
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buffer[8];
+                    std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned>(c));
+                    out += buffer;
+                } else {
+                    out.push_back(c);
+                }
+        }
+    }
+    return out;
+}
+
+TraceRecorder::TraceRecorder() : origin_(std::chrono::steady_clock::now()) {}
+
+unsigned TraceRecorder::current_thread() {
+    static std::atomic<unsigned> next_id{1};
+    thread_local const unsigned id = next_id.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+void TraceRecorder::record(StageSpan span) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    spans_.push_back(std::move(span));
+}
+
+bool TraceRecorder::write(const std::string& path, std::string& out_error) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        out_error = "could not open trace file: " + path;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (size_t i = 0; i < spans_.size(); ++i) {
+        const StageSpan& span = spans_[i];
+        out << (i == 0 ? "\n" : ",\n");
+        out << "{\"name\":\"" << json_escape(span.stage) << "\",\"cat\":\"stage\",\"ph\":\"X\""
+            << ",\"ts\":" << to_microseconds(span.start - origin_) << ",\"dur\":" << to_microseconds(span.duration)
+            << ",\"pid\":1,\"tid\":" << span.thread << ",\"args\":{\"target\":\"" << json_escape(span.target)
+            << "\",\"attempt\":" << span.attempt << ",\"exit_code\":" << span.exit_code
+            << ",\"target_exists\":" << (span.target_exists ? "true" : "false") << "}}";
+    }
+    out << "\n]}\n";
+
+    out.flush();
+    if (!out) {
+        out_error = "failed while writing trace file: " + path;
+        return false;
+    }
+    return true;
+}
+
+} // namespace exterminate
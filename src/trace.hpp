@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace exterminate {
+
+// One delete stage run against one target. `exit_code` is the child's exit
+// code for external tools, 0/1 for in-process stages, and -1 when the stage
+// could not be started.
+struct StageSpan {
+    std::string stage;
+    std::string target;
+    int attempt = 0;
+    unsigned thread = 0;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::duration duration{};
+    int exit_code = 0;
+    bool target_exists = false;
+};
+
+// Collects spans from any thread and writes them as a Chrome trace-event
+// JSON file (loadable in chrome://tracing or Perfetto).
+class TraceRecorder {
+public:
+    TraceRecorder();
+
+    void record(StageSpan span);
+    bool write(const std::string& path, std::string& out_error) const;
+
+    // Small, stable id for the calling thread, used as the trace "tid".
+    static unsigned current_thread();
+
+private:
+    std::chrono::steady_clock::time_point origin_;
+    mutable std::mutex mutex_;
+    std::vector<StageSpan> spans_;
+};
+
+// Escapes a string for use inside a JSON string literal.
+std::string json_escape(const std::string& value);
+
+} // namespace exterminate
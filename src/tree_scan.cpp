@@ -0,0 +1,215 @@
+#include "tree_scan.hpp"
+
+#include "dir_handle.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <system_error>
+
+namespace exterminate {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Same completion scheme as the delete engine: a directory's subtree total is
+// final once its own enumeration and every child directory have finished.
+struct ScanNode {
+    DirHandle handle;
+    NativeName name;
+    std::shared_ptr<ScanNode> parent;
+    size_t depth = 0;
+    std::atomic<size_t> remaining{1};
+    std::atomic<std::uint64_t> bytes{0};
+    std::atomic<std::uint64_t> entries{0};
+};
+
+class LargestDirectories {
+public:
+    explicit LargestDirectories(size_t capacity) : capacity_(capacity) {}
+
+    void offer(const fs::path& root, const ScanNode& node, std::uint64_t bytes, std::uint64_t entries) {
+        if (capacity_ == 0) return;
+        if (full_.load(std::memory_order_relaxed) && bytes <= floor_.load(std::memory_order_relaxed)) return;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (items_.size() >= capacity_ && bytes <= items_.back().bytes) return;
+
+        DirectoryTotal item;
+        item.path = path_of(root, node);
+        item.bytes = bytes;
+        item.entries = entries;
+
+        const auto position = std::upper_bound(items_.begin(), items_.end(), item,
+                                               [](const DirectoryTotal& a, const DirectoryTotal& b) {
+                                                   return a.bytes > b.bytes;
+                                               });
+        items_.insert(position, std::move(item));
+        if (items_.size() > capacity_) items_.pop_back();
+
+        if (items_.size() >= capacity_) {
+            full_.store(true, std::memory_order_relaxed);
+            floor_.store(items_.back().bytes, std::memory_order_relaxed);
+        }
+    }
+
+    std::vector<DirectoryTotal> take() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return std::move(items_);
+    }
+
+private:
+    static fs::path path_of(const fs::path& root, const ScanNode& node) {
+        std::vector<const NativeName*> names;
+        for (const ScanNode* current = &node; current && current->parent; current = current->parent.get()) {
+            names.push_back(&current->name);
+        }
+
+        fs::path out = root;
+        for (auto it = names.rbegin(); it != names.rend(); ++it) {
+            out /= **it;
+        }
+        return out;
+    }
+
+    size_t capacity_;
+    std::mutex mutex_;
+    std::vector<DirectoryTotal> items_;
+    std::atomic<bool> full_{false};
+    std::atomic<std::uint64_t> floor_{0};
+};
+
+struct ScanContext {
+    ScanContext(WorkPool& owner, fs::path scan_root, size_t largest_count)
+        : pool(owner), root(std::move(scan_root)), largest(largest_count) {}
+
+    WorkPool& pool;
+    fs::path root;
+    TaskGroup group;
+    LargestDirectories largest;
+    std::atomic<std::uint64_t> files{0};
+    std::atomic<std::uint64_t> directories{0};
+    std::atomic<std::uint64_t> errors{0};
+    std::atomic<size_t> max_depth{0};
+};
+
+void note_depth(ScanContext& context, size_t depth) {
+    size_t current = context.max_depth.load(std::memory_order_relaxed);
+    while (depth > current && !context.max_depth.compare_exchange_weak(current, depth, std::memory_order_relaxed)) {
+    }
+}
+
+void finish_node(ScanContext& context, std::shared_ptr<ScanNode> node) {
+    while (node->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        node->handle.close();
+
+        const std::uint64_t bytes = node->bytes.load(std::memory_order_relaxed);
+        const std::uint64_t entries = node->entries.load(std::memory_order_relaxed);
+
+        std::shared_ptr<ScanNode> parent = node->parent;
+        if (!parent) break;
+
+        context.largest.offer(context.root, *node, bytes, entries);
+        parent->bytes.fetch_add(bytes, std::memory_order_relaxed);
+        parent->entries.fetch_add(entries + 1, std::memory_order_relaxed);
+        node = std::move(parent);
+    }
+}
+
+void scan_directory(ScanContext& context, const std::shared_ptr<ScanNode>& node) {
+    std::error_code ec;
+    if (!node->handle.valid()) {
+        node->handle = node->parent->handle.open_child(node->name, ec);
+    }
+    note_depth(context, node->depth);
+
+    std::uint64_t files = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t errors = 0;
+    if (!ec) {
+        DirReader reader(node->handle);
+        std::vector<DirEntry> batch;
+        while (reader.next_batch(batch, ec)) {
+            for (auto& entry : batch) {
+                if (entry.directory) {
+                    auto child = std::make_shared<ScanNode>();
+                    child->name = std::move(entry.name);
+                    child->parent = node;
+                    child->depth = node->depth + 1;
+                    node->remaining.fetch_add(1, std::memory_order_relaxed);
+                    context.directories.fetch_add(1, std::memory_order_relaxed);
+                    context.pool.submit(context.group, [&context, child] { scan_directory(context, child); });
+                    continue;
+                }
+
+                ++files;
+                if (entry.size_known) {
+                    bytes += entry.size;
+                    continue;
+                }
+
+                std::uint64_t size = 0;
+                std::error_code size_ec;
+                if (node->handle.entry_size(entry.name, size, size_ec)) {
+                    bytes += size;
+                } else {
+                    ++errors;
+                }
+            }
+            if (ec) break;
+        }
+    }
+    if (ec) ++errors;
+
+    context.files.fetch_add(files, std::memory_order_relaxed);
+    context.errors.fetch_add(errors, std::memory_order_relaxed);
+    node->bytes.fetch_add(bytes, std::memory_order_relaxed);
+    node->entries.fetch_add(files, std::memory_order_relaxed);
+    finish_node(context, node);
+}
+
+} // namespace
+
+ScanStats scan_tree(const fs::path& root, WorkPool& pool, size_t largest_count) {
+    ScanStats stats;
+
+    std::error_code ec;
+    const fs::file_status status = fs::symlink_status(root, ec);
+    if (ec || !fs::exists(status)) {
+        stats.errors = 1;
+        return stats;
+    }
+
+    if (!fs::is_directory(status)) {
+        stats.files = 1;
+        if (fs::is_regular_file(status)) {
+            const auto size = fs::file_size(root, ec);
+            if (!ec) stats.bytes = size;
+        }
+        return stats;
+    }
+
+    auto top = std::make_shared<ScanNode>();
+    top->handle = DirHandle::open(root, ec);
+    if (ec) {
+        stats.errors = 1;
+        return stats;
+    }
+
+    ScanContext context(pool, root, largest_count);
+    context.directories.store(1);
+    pool.submit(context.group, [&context, top] { scan_directory(context, top); });
+    pool.wait(context.group);
+
+    stats.files = context.files.load();
+    stats.directories = context.directories.load();
+    stats.bytes = top->bytes.load();
+    stats.max_depth = context.max_depth.load();
+    stats.errors = context.errors.load();
+    stats.largest_directories = context.largest.take();
+    return stats;
+}
+
+} // namespace exterminate
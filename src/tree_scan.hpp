@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "work_pool.hpp"
+
+namespace exterminate {
+
+struct DirectoryTotal {
+    std::filesystem::path path;
+    std::uint64_t bytes = 0;
+    std::uint64_t entries = 0;
+};
+
+struct ScanStats {
+    std::uint64_t files = 0;
+    std::uint64_t directories = 0;
+    std::uint64_t bytes = 0;
+    std::size_t max_depth = 0;
+    std::uint64_t errors = 0;
+    std::vector<DirectoryTotal> largest_directories;
+};
+
+// Walks the target with the same handle-relative traversal the parallel
+// delete engine uses, removing nothing. Largest directories are ranked by
+// the total size of their subtree.
+ScanStats scan_tree(const std::filesystem::path& root, WorkPool& pool, std::size_t largest_count = 10);
+
+} // namespace exterminate
@@ -0,0 +1,535 @@
+#include "uring_delete.hpp"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+  #define EXTERMINATE_HAS_URING 1
+#else
+  #define EXTERMINATE_HAS_URING 0
+#endif
+
+#if EXTERMINATE_HAS_URING
+  #include "dir_handle.hpp"
+  #include "latency_histogram.hpp"
+  #include "progress.hpp"
+  #include "startup_profile.hpp"
+
+  #include <algorithm>
+  #include <cerrno>
+  #include <chrono>
+  #include <cstdint>
+  #include <cstring>
+  #include <deque>
+  #include <memory>
+  #include <mutex>
+  #include <vector>
+
+  #include <fcntl.h>
+  #include <linux/io_uring.h>
+  #include <sys/mman.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+
+namespace exterminate {
+
+namespace fs = std::filesystem;
+
+#if EXTERMINATE_HAS_URING
+
+namespace {
+
+constexpr unsigned kRingEntries = 512;
+constexpr size_t kPendingLowWater = 4096;
+
+class Ring {
+public:
+    Ring() = default;
+    ~Ring() { close(); }
+
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    bool open(unsigned entries) {
+        io_uring_params params{};
+        fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (fd_ < 0) return false;
+
+        sq_ring_bytes_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_bytes_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            sq_ring_bytes_ = std::max(sq_ring_bytes_, cq_ring_bytes_);
+            cq_ring_bytes_ = sq_ring_bytes_;
+        }
+
+        sq_ring_ = ::mmap(nullptr, sq_ring_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          fd_, IORING_OFF_SQ_RING);
+        if (sq_ring_ == MAP_FAILED) {
+            sq_ring_ = nullptr;
+            return false;
+        }
+
+        if (single_mmap) {
+            cq_ring_ = sq_ring_;
+        } else {
+            cq_ring_ = ::mmap(nullptr, cq_ring_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                              fd_, IORING_OFF_CQ_RING);
+            if (cq_ring_ == MAP_FAILED) {
+                cq_ring_ = nullptr;
+                return false;
+            }
+        }
+
+        sqe_bytes_ = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, sqe_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            fd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) return false;
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        auto* sq = static_cast<char*>(sq_ring_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        sq_entries_ = params.sq_entries;
+
+        auto* cq = static_cast<char*>(cq_ring_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        cq_entries_ = params.cq_entries;
+
+        local_tail_ = *sq_tail_;
+        return true;
+    }
+
+    bool supports(unsigned opcode) const {
+        const size_t op_count = 256;
+        std::vector<unsigned char> storage(sizeof(io_uring_probe) + op_count * sizeof(io_uring_probe_op));
+        auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+        if (::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PROBE, probe, op_count) < 0) return false;
+        if (probe->last_op < opcode) return false;
+        return (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) != 0;
+    }
+
+    unsigned free_slots() const {
+        const unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        return sq_entries_ - (local_tail_ - head);
+    }
+
+    unsigned completion_capacity() const { return cq_entries_; }
+    unsigned unsubmitted() const { return unsubmitted_; }
+
+    void push_unlinkat(int directory_fd, const char* name, int flags, std::uint64_t user_data) {
+        const unsigned index = local_tail_ & sq_mask_;
+        io_uring_sqe& sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_UNLINKAT;
+        sqe.fd = directory_fd;
+        sqe.addr = reinterpret_cast<std::uint64_t>(name);
+        sqe.unlink_flags = static_cast<__u32>(flags);
+        sqe.user_data = user_data;
+
+        sq_array_[index] = index;
+        ++local_tail_;
+        ++unsubmitted_;
+        __atomic_store_n(sq_tail_, local_tail_, __ATOMIC_RELEASE);
+    }
+
+    // Returns the number of entries submitted, or -errno.
+    int enter(unsigned wait_for) {
+        const unsigned flags = wait_for > 0 ? IORING_ENTER_GETEVENTS : 0;
+        const long submitted = ::syscall(__NR_io_uring_enter, fd_, unsubmitted_, wait_for, flags, nullptr, 0);
+        if (submitted < 0) return -errno;
+        unsubmitted_ -= static_cast<unsigned>(submitted);
+        return static_cast<int>(submitted);
+    }
+
+    // Takes back the entries the kernel has not consumed yet, oldest first,
+    // and rewinds the tail over them. Returns how many entries the kernel did
+    // consume that enter() never reported as submitted; they will complete.
+    template <typename Fn>
+    unsigned reclaim_unsubmitted(Fn&& on_entry) {
+        const unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        const unsigned unconsumed = local_tail_ - head;
+        for (unsigned position = head; position != local_tail_; ++position) {
+            on_entry(sqes_[sq_array_[position & sq_mask_]].user_data);
+        }
+        local_tail_ = head;
+        __atomic_store_n(sq_tail_, local_tail_, __ATOMIC_RELEASE);
+
+        const unsigned consumed = unsubmitted_ > unconsumed ? unsubmitted_ - unconsumed : 0;
+        unsubmitted_ = 0;
+        return consumed;
+    }
+
+    template <typename Fn>
+    unsigned reap(Fn&& on_completion) {
+        unsigned head = *cq_head_;
+        const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        unsigned count = 0;
+        while (head != tail) {
+            const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+            on_completion(cqe.user_data, cqe.res);
+            ++head;
+            ++count;
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        return count;
+    }
+
+private:
+    void close() {
+        if (sqes_) ::munmap(sqes_, sqe_bytes_);
+        if (cq_ring_ && cq_ring_ != sq_ring_) ::munmap(cq_ring_, cq_ring_bytes_);
+        if (sq_ring_) ::munmap(sq_ring_, sq_ring_bytes_);
+        if (fd_ >= 0) ::close(fd_);
+        sqes_ = nullptr;
+        sq_ring_ = nullptr;
+        cq_ring_ = nullptr;
+        fd_ = -1;
+    }
+
+    int fd_ = -1;
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    size_t sq_ring_bytes_ = 0;
+    size_t cq_ring_bytes_ = 0;
+    size_t sqe_bytes_ = 0;
+
+    io_uring_sqe* sqes_ = nullptr;
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned local_tail_ = 0;
+    unsigned unsubmitted_ = 0;
+
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    unsigned cq_entries_ = 0;
+};
+
+struct UringDir {
+    DirHandle handle;
+    NativeName name;
+    UringDir* parent = nullptr;
+    size_t remaining = 1;
+    PathGuard::Cursor guard;
+    // Only kept up when progress is counted.
+    size_t depth = 0;
+    std::uint64_t entries_below = 0;
+};
+
+// One queued unlinkat. `removes` is set when the op is the rmdir of that
+// directory, which is only queued once all of its children have completed.
+struct UnlinkOp {
+    UringDir* directory = nullptr;
+    NativeName name;
+    int flags = 0;
+    UringDir* removes = nullptr;
+    std::uint64_t size = 0;
+    std::chrono::steady_clock::time_point submitted;
+};
+
+class UringTreeDelete {
+public:
+    UringTreeDelete(Ring& ring, const TreeDeleteOptions& options) : ring_(ring), options_(options) {}
+
+    NativeDeleteStats run(const fs::path& target) {
+        std::error_code ec;
+        base_ = target.parent_path();
+        fs::path parent_path = base_;
+        if (parent_path.empty()) parent_path = fs::path(".");
+
+        auto anchor = std::make_unique<UringDir>();
+        anchor->handle = DirHandle::open(parent_path, ec);
+        if (ec) {
+            stats_.failures = 1;
+            report_failure(target, true, ec);
+            return stats_;
+        }
+
+        auto* top = new UringDir();
+        top->name = target.filename().native();
+        top->parent = anchor.get();
+        if (options_.guard) top->guard = options_.guard_cursor;
+        ++anchor->remaining;
+        to_scan_.push_back(top);
+        if (options_.progress) options_.progress->add_directories_found(0, 1);
+
+        for (;;) {
+            while (pending_.size() < kPendingLowWater && has_scan_work()) {
+                scan_batch();
+            }
+            fill_submission_queue();
+
+            if (ring_.unsubmitted() == 0 && inflight_ == 0) {
+                if (pending_.empty() && !has_scan_work()) break;
+                continue;
+            }
+
+            const bool can_make_progress_without_waiting = has_scan_work() && pending_.size() < kPendingLowWater;
+            const int submitted = ring_.enter(can_make_progress_without_waiting || inflight_ == 0 ? 0 : 1);
+            if (submitted >= 0) {
+                inflight_ += static_cast<size_t>(submitted);
+            } else if (submitted != -EINTR && submitted != -EAGAIN && submitted != -EBUSY) {
+                broken_ = true;
+            }
+
+            ring_.reap([this](std::uint64_t user_data, int result) {
+                --inflight_;
+                complete(reinterpret_cast<UnlinkOp*>(user_data), result);
+            });
+
+            if (broken_) {
+                recover_from_broken_ring();
+                drain_synchronously();
+                break;
+            }
+        }
+
+        return stats_;
+    }
+
+private:
+    bool has_scan_work() const { return scanning_ != nullptr || !to_scan_.empty(); }
+
+    fs::path path_of(const UringDir* directory) const {
+        std::vector<const NativeName*> names;
+        for (const UringDir* current = directory; current->parent; current = current->parent) {
+            names.push_back(&current->name);
+        }
+
+        fs::path out = base_;
+        for (auto it = names.rbegin(); it != names.rend(); ++it) {
+            out /= **it;
+        }
+        return out;
+    }
+
+    void report_failure(fs::path path, bool directory, const std::error_code& ec) {
+        if (options_.failures) options_.failures->add(DeleteFailure{std::move(path), directory, ec});
+    }
+
+    void queue_op(UringDir* directory, NativeName name, int flags, UringDir* removes, std::uint64_t size = 0) {
+        auto* op = new UnlinkOp();
+        op->directory = directory;
+        op->name = std::move(name);
+        op->flags = flags;
+        op->removes = removes;
+        op->size = size;
+        pending_.push_back(op);
+    }
+
+    void scan_batch() {
+        if (!scanning_) {
+            scanning_ = to_scan_.back();
+            to_scan_.pop_back();
+
+            std::error_code ec;
+            scanning_->handle = scanning_->parent->handle.open_child(scanning_->name, ec);
+            if (ec) {
+                ++stats_.failures;
+                report_failure(path_of(scanning_), true, ec);
+                if (options_.progress) options_.progress->finish_listing(scanning_->depth);
+                UringDir* failed = scanning_;
+                scanning_ = nullptr;
+                finish_directory(failed);
+                return;
+            }
+            reader_ = std::make_unique<DirReader>(scanning_->handle);
+        }
+
+        std::error_code ec;
+        const bool more = reader_->next_batch(batch_, ec);
+        const PathGuard* guard = scanning_->guard.empty() ? nullptr : options_.guard;
+        PathGuard::Cursor child_guard;
+        size_t directories = 0;
+        for (auto& entry : batch_) {
+            if (guard && guard->protects(scanning_->guard, entry.name, entry.directory ? &child_guard : nullptr)) {
+                ++stats_.failures;
+                report_failure(path_of(scanning_) / entry.name, entry.directory, protected_entry_error());
+                continue;
+            }
+
+            ++scanning_->remaining;
+            if (entry.directory) {
+                auto* child = new UringDir();
+                child->name = std::move(entry.name);
+                child->parent = scanning_;
+                if (guard) child->guard = std::move(child_guard);
+                child->depth = scanning_->depth + 1;
+                to_scan_.push_back(child);
+                ++directories;
+            } else {
+                std::uint64_t size = entry.size;
+                if (!entry.size_known && options_.count_bytes) {
+                    std::int64_t modified = 0;
+                    std::error_code stat_ec;
+                    if (!scanning_->handle.entry_status(entry.name, size, modified, stat_ec)) size = 0;
+                }
+                queue_op(scanning_, std::move(entry.name), 0, nullptr, size);
+            }
+        }
+
+        if (options_.progress) {
+            options_.progress->add_listed(batch_.size());
+            scanning_->entries_below += batch_.size();
+            if (directories > 0) options_.progress->add_directories_found(scanning_->depth + 1, directories);
+        }
+
+        if (!more || ec) {
+            if (ec) {
+                ++stats_.failures;
+                report_failure(path_of(scanning_), true, ec);
+            }
+            if (options_.progress) options_.progress->finish_listing(scanning_->depth);
+            reader_.reset();
+            UringDir* done = scanning_;
+            scanning_ = nullptr;
+            finish_directory(done);
+        }
+    }
+
+    void fill_submission_queue() {
+        if (broken_) return;
+        unsigned slots = ring_.free_slots();
+        const size_t capacity = ring_.completion_capacity();
+        while (!pending_.empty() && slots > 0 && inflight_ + ring_.unsubmitted() < capacity) {
+            UnlinkOp* op = pending_.front();
+            pending_.pop_front();
+            if (options_.latency) op->submitted = std::chrono::steady_clock::now();
+            ring_.push_unlinkat(op->directory->handle.native_fd(), op->name.c_str(), op->flags,
+                                reinterpret_cast<std::uint64_t>(op));
+            --slots;
+        }
+    }
+
+    // Once enter() has failed for good, the queued entries go back to
+    // pending_ and the ones already in the kernel are waited out, so every op
+    // completes, is reported and frees its directory for the rmdir.
+    void recover_from_broken_ring() {
+        std::vector<UnlinkOp*> reclaimed;
+        inflight_ += ring_.reclaim_unsubmitted(
+            [&reclaimed](std::uint64_t user_data) { reclaimed.push_back(reinterpret_cast<UnlinkOp*>(user_data)); });
+        pending_.insert(pending_.begin(), reclaimed.begin(), reclaimed.end());
+
+        // Submissions never exceed the completion queue, so no completion is
+        // dropped and this ends. If the ring cannot even wait, poll it.
+        while (inflight_ > 0) {
+            const int waited = ring_.enter(1);
+            const unsigned reaped = ring_.reap([this](std::uint64_t user_data, int result) {
+                --inflight_;
+                complete(reinterpret_cast<UnlinkOp*>(user_data), result);
+            });
+            if (waited < 0 && reaped == 0) ::usleep(1000);
+        }
+    }
+
+    void drain_synchronously() {
+        while (!pending_.empty() || has_scan_work()) {
+            while (!pending_.empty()) {
+                UnlinkOp* op = pending_.front();
+                pending_.pop_front();
+                if (options_.latency) op->submitted = std::chrono::steady_clock::now();
+                const int result = ::unlinkat(op->directory->handle.native_fd(), op->name.c_str(), op->flags);
+                complete(op, result == 0 ? 0 : -errno);
+            }
+            if (has_scan_work()) scan_batch();
+        }
+    }
+
+    void complete(UnlinkOp* op, int result) {
+        if (options_.latency) options_.latency->record(std::chrono::steady_clock::now() - op->submitted);
+        if (result < 0) {
+            ++stats_.failures;
+            const std::error_code ec(-result, std::system_category());
+            if (!op->removes || !is_directory_not_empty(ec)) {
+                report_failure(path_of(op->directory) / op->name, op->removes != nullptr, ec);
+            }
+        } else {
+            ++stats_.entries_removed;
+            stats_.bytes_removed += op->size;
+            note_mutation();
+            if (options_.progress) options_.progress->add_removed(1, op->size);
+        }
+
+        UringDir* directory = op->directory;
+        delete op->removes;
+        delete op;
+        finish_directory(directory);
+    }
+
+    void finish_directory(UringDir* directory) {
+        if (--directory->remaining > 0) return;
+        if (!directory->parent) return;
+
+        directory->handle.close();
+        if (options_.progress) {
+            options_.progress->finish_subtree(directory->depth, directory->entries_below);
+            directory->parent->entries_below += directory->entries_below;
+        }
+        queue_op(directory->parent, directory->name, AT_REMOVEDIR, directory);
+    }
+
+    Ring& ring_;
+    const TreeDeleteOptions& options_;
+    fs::path base_;
+    NativeDeleteStats stats_;
+    std::vector<UringDir*> to_scan_;
+    UringDir* scanning_ = nullptr;
+    std::unique_ptr<DirReader> reader_;
+    std::vector<DirEntry> batch_;
+    std::deque<UnlinkOp*> pending_;
+    size_t inflight_ = 0;
+    bool broken_ = false;
+};
+
+bool probe_uring() {
+    Ring ring;
+    return ring.open(8) && ring.supports(IORING_OP_UNLINKAT);
+}
+
+} // namespace
+
+bool uring_delete_available() {
+    static const bool available = probe_uring();
+    return available;
+}
+
+bool delete_tree_uring(const fs::path& root, NativeDeleteStats& out_stats, const TreeDeleteOptions& options) {
+    out_stats = NativeDeleteStats{};
+    if (!uring_delete_available()) return false;
+
+    Ring ring;
+    if (!ring.open(kRingEntries)) return false;
+
+    fs::path target = root;
+    if (!target.has_filename() && target.has_parent_path()) target = target.parent_path();
+
+    static std::once_flag handle_limit_once;
+    std::call_once(handle_limit_once, raise_open_handle_limit);
+
+    UringTreeDelete deleter(ring, options);
+    out_stats = deleter.run(target);
+    return true;
+}
+
+#else
+
+bool uring_delete_available() {
+    return false;
+}
+
+bool delete_tree_uring(const fs::path&, NativeDeleteStats& out_stats, const TreeDeleteOptions&) {
+    out_stats = NativeDeleteStats{};
+    return false;
+}
+
+#endif
+
+} // namespace exterminate
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <filesystem>
+
+#include "native_delete.hpp"
+
+namespace exterminate {
+
+bool uring_delete_available();
+
+// Returns false without touching the tree when io_uring or IORING_OP_UNLINKAT
+// is unavailable, so the caller can fall back to another engine.
+// Per-entry latency is measured from submission to completion.
+bool delete_tree_uring(const std::filesystem::path& root, NativeDeleteStats& out_stats,
+                       const TreeDeleteOptions& options = {});
+
+} // namespace exterminate
@@ -235,6 +235,40 @@ int run_hidden_process(const std::string& file_name, const std::vector<std::stri
     return static_cast<int>(exit_code);
 }
 
+bool spawn_detached_process(const std::string& file_name, const std::vector<std::string>& args) {
+    std::string command_line = quote_argument(file_name);
+    for (const auto& arg : args) {
+        command_line.push_back(' ');
+        command_line += quote_argument(arg);
+    }
+
+    STARTUPINFOA startup{};
+    PROCESS_INFORMATION process{};
+    startup.cb = sizeof(startup);
+
+    std::vector<char> mutable_cmd(command_line.begin(), command_line.end());
+    mutable_cmd.push_back('\0');
+
+    // Breaking away from the job keeps the worker alive when the caller's
+    // job (a console or context-menu host) is closed; not every job allows it.
+    const DWORD flags = DETACHED_PROCESS | CREATE_NEW_PROCESS_GROUP;
+    BOOL started = CreateProcessA(nullptr, mutable_cmd.data(), nullptr, nullptr, FALSE,
+                                  flags | CREATE_BREAKAWAY_FROM_JOB, nullptr, nullptr, &startup, &process);
+    if (!started) {
+        started = CreateProcessA(nullptr, mutable_cmd.data(), nullptr, nullptr, FALSE, flags, nullptr, nullptr,
+                                 &startup, &process);
+    }
+    if (!started) return false;
+
+    CloseHandle(process.hProcess);
+    CloseHandle(process.hThread);
+    return true;
+}
+
+void enter_background_mode() {
+    SetPriorityClass(GetCurrentProcess(), PROCESS_MODE_BACKGROUND_BEGIN);
+}
+
 bool command_exists_on_path(const std::string& command_name) {
     const char* path_env = std::getenv("PATH");
     if (!path_env || !*path_env) return false;
@@ -14,6 +14,12 @@ bool enable_ansi_colors();
 void wait_for_key();
 
 int run_hidden_process(const std::string& file_name, const std::vector<std::string>& args);
+// Starts a process that outlives this one, without a console or inherited
+// standard handles, and does not wait for it.
+bool spawn_detached_process(const std::string& file_name, const std::vector<std::string>& args);
+// Lowers CPU and I/O priority of the calling process. On Linux priorities are
+// per thread, so call it before starting any worker threads.
+void enter_background_mode();
 bool command_exists_on_path(const std::string& command_name);
 
 bool ensure_user_path_entry(const std::string& entry);
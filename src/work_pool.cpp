@@ -0,0 +1,162 @@
+#include "work_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+namespace exterminate {
+
+namespace {
+
+thread_local const WorkPool* current_pool = nullptr;
+thread_local size_t current_index = 0;
+
+constexpr int kMaxWorkerThreads = 64;
+
+} // namespace
+
+WorkPool::WorkPool(int thread_count) {
+    const size_t count = static_cast<size_t>(std::clamp(thread_count, 1, kMaxWorkerThreads));
+
+    // One queue per worker plus a shared injection queue for outside threads.
+    for (size_t i = 0; i <= count; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+
+    threads_.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        threads_.emplace_back([this, i] { worker_loop(i); });
+    }
+}
+
+WorkPool::~WorkPool() {
+    stopping_.store(true);
+    wake_sleepers(true);
+    for (auto& thread : threads_) {
+        if (thread.joinable()) thread.join();
+    }
+}
+
+size_t WorkPool::local_queue_index() const {
+    if (current_pool == this) return current_index;
+    return threads_.size();
+}
+
+void WorkPool::submit(TaskGroup& group, std::function<void()> task) {
+    group.pending_.fetch_add(1, std::memory_order_relaxed);
+
+    Queue& queue = *queues_[local_queue_index()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(Task{&group, std::move(task)});
+    }
+
+    queued_.fetch_add(1);
+    if (sleeping_.load() > 0) wake_sleepers(false);
+}
+
+bool WorkPool::try_take(size_t home, Task& out) {
+    if (queued_.load() == 0) return false;
+
+    {
+        Queue& own = *queues_[home];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            out = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued_.fetch_sub(1);
+            return true;
+        }
+    }
+
+    const size_t count = queues_.size();
+    for (size_t offset = 1; offset < count; ++offset) {
+        Queue& victim = *queues_[(home + offset) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            out = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued_.fetch_sub(1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void WorkPool::run_task(Task& task) {
+    TaskGroup* group = task.group;
+    try {
+        task.run();
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(group->error_mutex_);
+        if (!group->error_) group->error_ = std::current_exception();
+    }
+    task.run = nullptr;
+
+    if (group->pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        wake_sleepers(true);
+    }
+}
+
+void WorkPool::worker_loop(size_t index) {
+    current_pool = this;
+    current_index = index;
+
+    Task task;
+    while (!stopping_.load()) {
+        if (try_take(index, task)) {
+            run_task(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleeping_.fetch_add(1);
+        sleep_cv_.wait(lock, [this] { return stopping_.load() || queued_.load() > 0; });
+        sleeping_.fetch_sub(1);
+    }
+}
+
+void WorkPool::wait(TaskGroup& group) {
+    const size_t home = local_queue_index();
+
+    Task task;
+    while (!group.done()) {
+        if (try_take(home, task)) {
+            run_task(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleeping_.fetch_add(1);
+        sleep_cv_.wait_for(lock, std::chrono::milliseconds(50), [&] {
+            return group.done() || queued_.load() > 0;
+        });
+        sleeping_.fetch_sub(1);
+    }
+
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(group.error_mutex_);
+        error = std::exchange(group.error_, nullptr);
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+void WorkPool::wake_sleepers(bool all) {
+    { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+    if (all) {
+        sleep_cv_.notify_all();
+    } else {
+        sleep_cv_.notify_one();
+    }
+}
+
+int resolve_worker_threads(int configured) {
+    if (configured > 0) return std::min(configured, kMaxWorkerThreads);
+    const unsigned int hardware = std::thread::hardware_concurrency();
+    if (hardware == 0) return 4;
+    return std::min(static_cast<int>(hardware), kMaxWorkerThreads);
+}
+
+} // namespace exterminate
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace exterminate {
+
+class TaskGroup {
+public:
+    TaskGroup() = default;
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    bool done() const { return pending_.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class WorkPool;
+    std::atomic<size_t> pending_{0};
+    // The first exception one of the group's tasks threw.
+    std::mutex error_mutex_;
+    std::exception_ptr error_;
+};
+
+// Work-stealing pool: each worker pops its own queue LIFO and steals from the
+// others FIFO. Threads blocked in wait() run queued tasks instead of sleeping,
+// so tasks may submit and wait on nested groups without deadlocking. A task
+// that throws does not stop the rest of its group; wait() rethrows the first
+// exception once every task of the group has run.
+class WorkPool {
+public:
+    explicit WorkPool(int thread_count);
+    ~WorkPool();
+
+    WorkPool(const WorkPool&) = delete;
+    WorkPool& operator=(const WorkPool&) = delete;
+
+    int thread_count() const { return static_cast<int>(threads_.size()); }
+
+    void submit(TaskGroup& group, std::function<void()> task);
+    void wait(TaskGroup& group);
+
+private:
+    struct Task {
+        TaskGroup* group = nullptr;
+        std::function<void()> run;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    size_t local_queue_index() const;
+    bool try_take(size_t home, Task& out);
+    void run_task(Task& task);
+    void worker_loop(size_t index);
+    void wake_sleepers(bool all);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    std::atomic<size_t> queued_{0};
+    std::atomic<size_t> sleeping_{0};
+    std::atomic<bool> stopping_{false};
+};
+
+int resolve_worker_threads(int configured);
+
+} // namespace exterminate
@@ -0,0 +1,134 @@
+// Round-trips requests through a real service on a private endpoint: result
+// order and status, coalescing of a path named by two clients at once,
+// rejection of relative paths and of clients with another config.
+
+#include "config.hpp"
+#include "service.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+using namespace exterminate;
+
+namespace {
+
+int failures = 0;
+
+void expect(bool condition, const std::string& what) {
+    if (condition) return;
+    ++failures;
+    std::cerr << "FAILED: " << what << "\n";
+}
+
+void make_tree(const fs::path& root) {
+    fs::create_directories(root / "sub");
+    std::ofstream(root / "file.txt") << "data";
+    std::ofstream(root / "sub" / "nested.txt") << "data";
+}
+
+// The service may still be binding its socket when the first client comes.
+bool submit(const std::string& identity, const std::vector<fs::path>& targets, std::vector<DeleteResult>& out_results) {
+    ServiceClient client;
+    for (int attempt = 0; attempt < 100 && !client.connect(); ++attempt) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    if (!client.connected()) return false;
+    return client.submit(identity, targets, out_results);
+}
+
+} // namespace
+
+int main() {
+    const fs::path root = fs::temp_directory_path() / ("exterminate-service-test-" + std::to_string(::getpid()));
+    fs::remove_all(root);
+    const fs::path runtime = root / "runtime";
+    const fs::path work = root / "work";
+    fs::create_directories(runtime);
+    fs::permissions(runtime, fs::perms::owner_all);
+    fs::create_directories(work);
+    ::setenv("XDG_RUNTIME_DIR", runtime.c_str(), 1);
+
+    const fs::path config_path = root / "config.json";
+    std::ofstream(config_path) << "{\"serviceIdleTimeoutSeconds\": 1, \"retries\": 0, \"protectedPaths\": [\""
+                               << (work / "locked").string() << "\"]}";
+    const std::string base_directory = root.string();
+    const std::string identity = load_config(config_path.string(), base_directory).identity;
+
+    int service_exit = -1;
+    std::thread service([&] { service_exit = run_service(config_path.string(), base_directory); });
+
+    {
+        make_tree(work / "present");
+        make_tree(work / "locked");
+        std::vector<DeleteResult> results;
+        const bool answered = submit(identity, {work / "present", work / "missing", work / "locked"}, results);
+        expect(answered && results.size() == 3, "ordered request is answered with one result per target");
+        if (answered && results.size() == 3) {
+            expect(results[0].success && !results[0].already_gone, "present target is reported ok");
+            expect(results[1].success && results[1].already_gone, "missing target is reported gone");
+            expect(!results[2].success, "protected target is reported failed");
+        }
+        expect(!fs::exists(work / "present"), "present target is deleted");
+        expect(fs::exists(work / "locked" / "file.txt"), "protected target is kept");
+    }
+
+    {
+        make_tree(work / "shared");
+        std::atomic<bool> go{false};
+        std::vector<DeleteResult> results[2];
+        bool answered[2] = {false, false};
+        std::vector<std::thread> clients;
+        for (int i = 0; i < 2; ++i) {
+            clients.emplace_back([&, i] {
+                while (!go.load()) std::this_thread::yield();
+                answered[i] = submit(identity, {work / "shared"}, results[i]);
+            });
+        }
+        go.store(true);
+        for (auto& client : clients) client.join();
+
+        // Deleted once in one batch, both clients get that delete's result;
+        // a second delete would have answered "gone".
+        for (int i = 0; i < 2; ++i) {
+            expect(answered[i] && results[i].size() == 1, "each concurrent client gets a result");
+            if (answered[i] && results[i].size() == 1) {
+                expect(results[i][0].success && !results[i][0].already_gone, "shared target is deleted once");
+            }
+        }
+        expect(!fs::exists(work / "shared"), "shared target is deleted");
+    }
+
+    {
+        std::vector<DeleteResult> results;
+        const bool answered = submit(identity, {fs::path("relative") / "path"}, results);
+        expect(answered && results.size() == 1, "relative request is answered");
+        if (answered && results.size() == 1) {
+            expect(!results[0].success && results[0].message.find("not an absolute path") != std::string::npos,
+                   "relative path is rejected");
+        }
+    }
+
+    {
+        make_tree(work / "other");
+        std::vector<DeleteResult> results;
+        expect(!submit(identity + "-other", {work / "other"}, results), "client with another config is refused");
+        expect(fs::exists(work / "other" / "file.txt"), "refused request deletes nothing");
+    }
+
+    service.join();
+    expect(service_exit == 0, "service stops cleanly once idle");
+
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    if (failures == 0) std::cout << "service protocol: all checks passed\n";
+    return failures == 0 ? 0 : 1;
+}